@@ -0,0 +1,80 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <symengine/symengine_rcp.h>
+
+#include "Tinned.hpp"
+
+using namespace Tinned;
+
+// Average wall time (in milliseconds) of calling `fun` for `repeat` times
+template<typename Function>
+double get_wall_time(const unsigned int repeat, Function fun)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int i=0; i<repeat; ++i) fun();
+    std::chrono::duration<double, std::milli> elapsed
+        = std::chrono::steady_clock::now()-start;
+    return elapsed.count()/repeat;
+}
+
+// Benchmark of canonicalizing and merging contraction maps of the 4th-order
+// XC energy and 3rd-order XC potential derivatives. No reference timings are
+// recorded, so that it should be run before and after a change of the
+// contraction maps on the same machine to compare them.
+int main()
+{
+    const unsigned int repeat = 10;
+
+    auto a = make_perturbation(std::string("a"));
+    auto b = make_perturbation(std::string("b"));
+    auto c = make_perturbation(std::string("c"));
+    auto d = make_perturbation(std::string("d"));
+    auto dependencies = PertDependency({
+        std::make_pair(a, 99),
+        std::make_pair(b, 99),
+        std::make_pair(c, 99),
+        std::make_pair(d, 99)
+    });
+    auto D = make_1el_density(std::string("D"));
+    auto weight = make_nonel_function(std::string("weight"), dependencies);
+    auto Omega = make_1el_operator(std::string("Omega"), dependencies);
+    auto Exc = make_xc_energy(std::string("GGA"), D, Omega, weight);
+    auto Vxc = make_xc_potential(std::string("GGA"), D, Omega, weight);
+
+    SymEngine::RCP<const ExchCorrEnergy> Exc_abcd;
+    std::cout << "Differentiating Exc^{abcd} (ms): "
+              << get_wall_time(repeat, [&]() {
+                     Exc_abcd = SymEngine::rcp_dynamic_cast<const ExchCorrEnergy>(
+                         Exc->diff(a)->diff(b)->diff(c)->diff(d)
+                     );
+                 })
+              << "\n";
+    auto energy = Exc_abcd->get_energy();
+    std::cout << "Canonicalizing Exc^{abcd} (ms): "
+              << get_wall_time(repeat, [&]() { canonicalize_xc_energy(energy); })
+              << "\n";
+    std::cout << "Merging maps of Exc^{abcd} (ms): "
+              << get_wall_time(repeat, [&]() {
+                     auto energy_map = Exc_abcd->get_energy_map();
+                     merge_energy_map(energy_map, Exc_abcd->get_energy_map());
+                 })
+              << "\n";
+
+    auto Vxc_abc = SymEngine::rcp_dynamic_cast<const ExchCorrPotential>(
+        Vxc->diff(a)->diff(b)->diff(c)
+    );
+    auto potential = Vxc_abc->get_potential();
+    std::cout << "Canonicalizing Vxc^{abc} (ms): "
+              << get_wall_time(repeat, [&]() { canonicalize_xc_potential(potential); })
+              << "\n";
+    std::cout << "Merging maps of Vxc^{abc} (ms): "
+              << get_wall_time(repeat, [&]() {
+                     auto potential_map = Vxc_abc->get_potential_map();
+                     merge_potential_map(potential_map, Vxc_abc->get_potential_map());
+                 })
+              << "\n";
+
+    return 0;
+}
@@ -7,6 +7,15 @@
 
    This file is the header file of Tinned library.
 
+   2026-10-18, Bin Gao:
+   * add frequency placeholders and their numerical binding
+   * add grid execution plans of XC contractions and tables of generalized
+     density vectors
+   * add layouts of components of perturbation-strength derivatives
+   * add permutational symmetry of response tensors
+   * add schedules of response equations to solve
+   * add manifest visitor listing leaves requested by evaluators
+
    2024-05-08, Bin Gao:
    * add more visitors for response theory
 
@@ -28,6 +37,9 @@
 #include "Tinned/Perturbation.hpp"
 #include "Tinned/PertDependency.hpp"
 #include "Tinned/PertTuple.hpp"
+#include "Tinned/ComponentLayout.hpp"
+#include "Tinned/ResponseSymmetry.hpp"
+#include "Tinned/FrequencyBinding.hpp"
 #include "Tinned/PerturbedParameter.hpp"
 #include "Tinned/ZeroOperator.hpp"
 #include "Tinned/ConjugateTranspose.hpp"
@@ -39,6 +51,8 @@
 #include "Tinned/ExchCorrContraction.hpp"
 #include "Tinned/ExchCorrEnergy.hpp"
 #include "Tinned/ExchCorrPotential.hpp"
+#include "Tinned/DensityVectorTable.hpp"
+#include "Tinned/XcGridPlan.hpp"
 #include "Tinned/NonElecFunction.hpp"
 #include "Tinned/TemporumOperator.hpp"
 #include "Tinned/TemporumOverlap.hpp"
@@ -51,7 +65,9 @@
 #include "Tinned/KeepVisitor.hpp"
 #include "Tinned/ReplaceVisitor.hpp"
 #include "Tinned/FindAllVisitor.hpp"
+#include "Tinned/ManifestVisitor.hpp"
 #include "Tinned/EliminationVisitor.hpp"
+#include "Tinned/ResponseSchedule.hpp"
 #include "Tinned/TemporumCleaner.hpp"
 #include "Tinned/LaTeXifyVisitor.hpp"
 #include "Tinned/StringifyVisitor.hpp"
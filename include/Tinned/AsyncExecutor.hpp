@@ -0,0 +1,172 @@
+/* Tinned: a set of nonnumerical routines for computational chemistry
+   Copyright 2023-2024 Bin Gao
+
+   This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+   This file is the header file of a bounded executor of tasks used by
+   asynchronous evaluators.
+
+   2026-10-18, Bin Gao:
+   * first version
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Tinned
+{
+    class AsyncExecutor;
+
+    // Task of a directed acyclic graph, which becomes ready when all tasks
+    // it depends on have finished
+    class AsyncTask
+    {
+        friend class AsyncExecutor;
+
+        protected:
+            // Number of unfinished tasks this task depends on
+            std::atomic<std::size_t> num_pending_;
+            // If the task has been run
+            std::atomic<bool> finished_;
+            // Tasks depending on this task
+            std::vector<std::shared_ptr<AsyncTask>> parents_;
+
+            // Run the task, which should not throw
+            virtual void run() noexcept = 0;
+
+        public:
+            explicit AsyncTask(): num_pending_(0), finished_(false) {}
+
+            AsyncTask(const AsyncTask&) = delete;
+            AsyncTask& operator=(const AsyncTask&) = delete;
+
+            // Let `parent` depend on this task, which should be called
+            // before any of them is submitted
+            inline void add_parent(const std::shared_ptr<AsyncTask>& parent)
+            {
+                ++parent->num_pending_;
+                parents_.push_back(parent);
+            }
+
+            // A finished task implies that all tasks it depends on have
+            // finished as well
+            inline bool is_finished() const noexcept
+            {
+                return finished_.load();
+            }
+
+            virtual ~AsyncTask() = default;
+    };
+
+    // Node of a value, either a leaf holding the handle returned by a leaf
+    // callback, or a continuation computing the value from the nodes it
+    // depends on
+    template<typename T>
+    class AsyncNode: public AsyncTask
+    {
+        protected:
+            std::promise<T> promise_;
+            std::shared_future<T> future_;
+            std::function<T()> compute_;
+
+            void run() noexcept override
+            {
+                if (compute_) {
+                    try {
+                        promise_.set_value(compute_());
+                    }
+                    catch (...) {
+                        promise_.set_exception(std::current_exception());
+                    }
+                    // Release nodes captured by the continuation
+                    compute_ = nullptr;
+                }
+                else {
+                    future_.wait();
+                }
+            }
+
+        public:
+            // Leaf node
+            explicit AsyncNode(const std::shared_future<T>& future):
+                AsyncTask(), future_(future) {}
+
+            // Continuation, which is run only when the nodes it depends on
+            // are ready, so that their values can be got without blocking
+            explicit AsyncNode(const std::function<T()>& compute):
+                AsyncTask(), future_(promise_.get_future().share()), compute_(compute) {}
+
+            inline const std::shared_future<T>& get_future() const noexcept
+            {
+                return future_;
+            }
+
+            ~AsyncNode() = default;
+    };
+
+    // Make a continuation of `dependencies`
+    template<typename T>
+    inline std::shared_ptr<AsyncNode<T>> make_async_node(
+        const std::vector<std::shared_ptr<AsyncTask>>& dependencies,
+        const std::function<T()>& compute
+    )
+    {
+        auto node = std::make_shared<AsyncNode<T>>(compute);
+        for (const auto& task: dependencies) task->add_parent(node);
+        return node;
+    }
+
+    // Executor of tasks by a fixed number of threads. Ready tasks are taken
+    // from a work queue, and a finished task queues tasks depending on it
+    // once all their dependencies have finished. No thread blocks on
+    // unfinished continuations, but a thread running a leaf task waits for
+    // the handle of the leaf, so that at most `numThreads` handles are
+    // waited for at the same time.
+    class AsyncExecutor
+    {
+        protected:
+            std::vector<std::thread> threads_;
+            std::deque<std::shared_ptr<AsyncTask>> tasks_;
+            std::mutex mutex_;
+            std::condition_variable task_ready_;
+            std::condition_variable idle_;
+            std::size_t num_running_;
+            bool stop_;
+
+            void run_tasks();
+
+        public:
+            explicit AsyncExecutor(const unsigned int numThreads);
+
+            AsyncExecutor(const AsyncExecutor&) = delete;
+            AsyncExecutor& operator=(const AsyncExecutor&) = delete;
+
+            // Submit tasks without unfinished dependencies
+            void submit(const std::vector<std::shared_ptr<AsyncTask>>& tasks);
+
+            // Wait until all submitted tasks and their continuations have
+            // finished
+            void wait();
+
+            inline std::size_t get_num_threads() const noexcept
+            {
+                return threads_.size();
+            }
+
+            // Remaining tasks are finished before threads are joined
+            ~AsyncExecutor();
+    };
+}
@@ -0,0 +1,313 @@
+/* Tinned: a set of nonnumerical routines for computational chemistry
+   Copyright 2023-2024 Bin Gao
+
+   This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+   This file is the header file of asynchronous function evaluator.
+
+   2026-10-18, Bin Gao:
+   * first version
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include <symengine/basic.h>
+#include <symengine/add.h>
+#include <symengine/constants.h>
+#include <symengine/dict.h>
+#include <symengine/functions.h>
+#include <symengine/mul.h>
+#include <symengine/number.h>
+#include <symengine/matrices/trace.h>
+#include <symengine/symengine_casts.h>
+#include <symengine/symengine_exception.h>
+#include <symengine/symengine_rcp.h>
+#include <symengine/visitor.h>
+
+#include "Tinned/TwoElecEnergy.hpp"
+#include "Tinned/ExchCorrEnergy.hpp"
+#include "Tinned/NonElecFunction.hpp"
+#include "Tinned/AsyncExecutor.hpp"
+#include "Tinned/StringifyVisitor.hpp"
+#include "Tinned/AsyncOperatorEvaluator.hpp"
+
+namespace Tinned
+{
+    // Asynchronous variant of `FunctionEvaluator`, see `AsyncOperatorEvaluator`
+    // for the requirements on callbacks. Continuations are run by the
+    // executor of the operator evaluator, so that both evaluators share the
+    // same bounded number of threads, and each traversal keeps its storage in
+    // the operator evaluator.
+    //
+    // Unlike `FunctionEvaluator`, frequency bindings and component layouts
+    // are not supported, and traces of products are evaluated by
+    // `eval_trace()` of the product, without `eval_trace_product()`.
+    template<typename FunctionType, typename OperatorType>
+    class AsyncFunctionEvaluator: public SymEngine::BaseVisitor<AsyncFunctionEvaluator<FunctionType, OperatorType>>
+    {
+        public:
+            typedef std::shared_future<FunctionType> FutureFunction;
+            typedef typename AsyncOperatorEvaluator<OperatorType>::FutureOperator FutureOperator;
+            typedef AsyncNode<FunctionType> FunctionNode;
+
+        protected:
+            // Each symbol adds its derivative to the end of the vector, and
+            // its parent checks the validity of derivative and may remove it
+            // when the child symbol has been evaluated.
+            std::vector<SymEngine::multiset_basic> derivatives_;
+            std::shared_ptr<FunctionNode> result_;
+            std::shared_ptr<AsyncOperatorEvaluator<OperatorType>> oper_evaluator_;
+
+            virtual FutureFunction eval_nonel_function(const NonElecFunction& x)
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncFunctionEvaluator::eval_nonel_function() is not implemented"
+                );
+            }
+
+            virtual FutureFunction eval_2el_energy(const TwoElecEnergy& x)
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncFunctionEvaluator::eval_2el_energy() is not implemented"
+                );
+            }
+
+            virtual FutureFunction eval_xc_energy(const ExchCorrEnergy& x)
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncFunctionEvaluator::eval_xc_energy() is not implemented"
+                );
+            }
+
+            // return the trace of `A`
+            virtual FunctionType eval_trace(const OperatorType& A)
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncFunctionEvaluator::eval_trace() is not implemented"
+                );
+            }
+
+            // `f` = `f` + `g`
+            virtual void eval_fun_addition(FunctionType& f, const FunctionType& g)
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncFunctionEvaluator::eval_fun_addition() is not implemented"
+                );
+            }
+
+            // `f` = `scalar` * `f`
+            virtual void eval_fun_scale(
+                const SymEngine::RCP<const SymEngine::Number>& scalar,
+                FunctionType& f
+            )
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncFunctionEvaluator::eval_fun_scale() is not implemented"
+                );
+            }
+
+            // Make a leaf node from the handle returned by a leaf callback
+            inline std::shared_ptr<FunctionNode> make_leaf(const FutureFunction& value)
+            {
+                auto node = std::make_shared<FunctionNode>(value);
+                oper_evaluator_->traversal_->leaves.push_back(node);
+                return node;
+            }
+
+            // Method called by objects to process their argument(s), which
+            // does not clear the derivatives of visited symbols
+            inline std::shared_ptr<FunctionNode> apply_(
+                const SymEngine::RCP<const SymEngine::Basic>& x
+            )
+            {
+                x->accept(*this);
+                return result_;
+            }
+
+        public:
+            explicit AsyncFunctionEvaluator(
+                const std::shared_ptr<AsyncOperatorEvaluator<OperatorType>>& operEvaluator
+            ): oper_evaluator_(operEvaluator) {}
+
+            // Traverse `x` and return a handle of its value, leaf
+            // computations and their combination may still be running
+            inline FutureFunction apply(const SymEngine::RCP<const SymEngine::Basic>& x)
+            {
+                oper_evaluator_->begin_traversal_();
+                derivatives_.clear();
+                auto node = apply_(x);
+                oper_evaluator_->end_traversal_({node});
+                return node->get_future();
+            }
+
+            // Traverse all expressions in `x` into one graph of nodes, whose
+            // leaves are submitted together
+            inline std::vector<FutureFunction> apply(const SymEngine::vec_basic& x)
+            {
+                oper_evaluator_->begin_traversal_();
+                std::vector<std::shared_ptr<AsyncTask>> nodes;
+                std::vector<FutureFunction> values;
+                nodes.reserve(x.size());
+                values.reserve(x.size());
+                for (const auto& expr: x) {
+                    derivatives_.clear();
+                    auto node = apply_(expr);
+                    nodes.push_back(node);
+                    values.push_back(node->get_future());
+                }
+                oper_evaluator_->end_traversal_(nodes);
+                return values;
+            }
+
+            // Continuations use callbacks of the evaluator
+            virtual ~AsyncFunctionEvaluator()
+            {
+                oper_evaluator_->executor_->wait();
+            }
+
+            void bvisit(const SymEngine::Basic& x)
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncFunctionEvaluator::bvisit() not implemented for " + stringify(x)
+                );
+            }
+
+            void bvisit(const SymEngine::Add& x)
+            {
+                auto args = x.get_args();
+                std::vector<std::shared_ptr<AsyncTask>> nodes;
+                std::vector<FutureFunction> terms;
+                nodes.reserve(args.size());
+                terms.reserve(args.size());
+                for (std::size_t i=0; i<args.size(); ++i) {
+                    auto node = apply_(args[i]);
+                    nodes.push_back(node);
+                    terms.push_back(node->get_future());
+                    if (i==0) continue;
+                    // Arguments of `Add` should have the same derivative
+                    if (SymEngine::unified_eq(
+                        derivatives_.back(), derivatives_[derivatives_.size()-2]
+                    )) {
+                        // We keep only the derivative of the first argument,
+                        // which represents the derivative of `Add`
+                        derivatives_.pop_back();
+                    }
+                    else {
+                        throw SymEngine::NotImplementedError(
+                            "AsyncFunctionEvaluator::bvisit() got invalid Add "
+                            + stringify(x)
+                        );
+                    }
+                }
+                result_ = make_async_node<FunctionType>(
+                    nodes,
+                    [this, terms]() -> FunctionType {
+                        FunctionType sum = terms[0].get();
+                        for (std::size_t i=1; i<terms.size(); ++i)
+                            this->eval_fun_addition(sum, terms[i].get());
+                        return sum;
+                    }
+                );
+            }
+
+            void bvisit(const SymEngine::Mul& x)
+            {
+                SymEngine::RCP<const SymEngine::Number> scalar = SymEngine::one;
+                unsigned int num_non_numbers = 0;
+                std::shared_ptr<FunctionNode> value;
+                for (auto const& arg: x.get_args()) {
+                    if (SymEngine::is_a_Number(*arg)) {
+                        scalar = SymEngine::mulnum(
+                            scalar,
+                            SymEngine::rcp_dynamic_cast<const SymEngine::Number>(arg)
+                        );
+                    }
+                    else {
+                        ++num_non_numbers;
+                        if (num_non_numbers>1) {
+                            throw SymEngine::NotImplementedError(
+                                "AsyncFunctionEvaluator::bvisit() not implemented for the argument "
+                                + stringify(arg)
+                                + " of the multiplication "
+                                + stringify(x)
+                            );
+                        }
+                        else {
+                            value = apply_(arg);
+                        }
+                    }
+                }
+                if (SymEngine::neq(*scalar, *SymEngine::one)) {
+                    auto p_scalar = oper_evaluator_->keep_scalar(scalar);
+                    auto f = value->get_future();
+                    result_ = make_async_node<FunctionType>(
+                        {value},
+                        [this, f, p_scalar]() -> FunctionType {
+                            FunctionType val = f.get();
+                            this->eval_fun_scale(*p_scalar, val);
+                            return val;
+                        }
+                    );
+                }
+                else {
+                    result_ = value;
+                }
+            }
+
+            void bvisit(const SymEngine::FunctionSymbol& x)
+            {
+                if (SymEngine::is_a_sub<const NonElecFunction>(x)) {
+                    auto& op = SymEngine::down_cast<const NonElecFunction&>(x);
+                    derivatives_.push_back(op.get_derivatives());
+                    result_ = make_leaf(eval_nonel_function(op));
+                }
+                else if (SymEngine::is_a_sub<const TwoElecEnergy>(x)) {
+                    auto& op = SymEngine::down_cast<const TwoElecEnergy&>(x);
+                    auto op_derivatives = op.get_derivatives();
+                    auto inner_derivatives = op.get_inner_state()->get_derivatives();
+                    op_derivatives.insert(
+                        inner_derivatives.begin(), inner_derivatives.end()
+                    );
+                    auto outer_derivatives = op.get_outer_state()->get_derivatives();
+                    op_derivatives.insert(
+                        outer_derivatives.begin(), outer_derivatives.end()
+                    );
+                    derivatives_.push_back(op_derivatives);
+                    result_ = make_leaf(eval_2el_energy(op));
+                }
+                else if (SymEngine::is_a_sub<const ExchCorrEnergy>(x)) {
+                    auto& op = SymEngine::down_cast<const ExchCorrEnergy&>(x);
+                    derivatives_.push_back(op.get_derivatives());
+                    result_ = make_leaf(eval_xc_energy(op));
+                }
+                else {
+                    throw SymEngine::NotImplementedError(
+                        "AsyncFunctionEvaluator::bvisit() not implemented for FunctionSymbol "
+                        + stringify(x)
+                    );
+                }
+            }
+
+            void bvisit(const SymEngine::Trace& x)
+            {
+                // Operator nodes are submitted together with function nodes
+                auto arg = oper_evaluator_->traverse_(x.get_args()[0]);
+                auto oper_derivatives = oper_evaluator_->get_derivatives();
+                derivatives_.insert(
+                    derivatives_.end(), oper_derivatives.begin(), oper_derivatives.end()
+                );
+                auto A = arg->get_future();
+                result_ = make_async_node<FunctionType>({arg}, [this, A]() -> FunctionType {
+                    return this->eval_trace(A.get());
+                });
+            }
+    };
+}
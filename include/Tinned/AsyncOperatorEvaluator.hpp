@@ -0,0 +1,525 @@
+/* Tinned: a set of nonnumerical routines for computational chemistry
+   Copyright 2023-2024 Bin Gao
+
+   This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+   This file is the header file of asynchronous operator evaluator.
+
+   2026-10-18, Bin Gao:
+   * first version
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <symengine/basic.h>
+#include <symengine/constants.h>
+#include <symengine/dict.h>
+#include <symengine/number.h>
+#include <symengine/matrices/conjugate_matrix.h>
+#include <symengine/matrices/matrix_add.h>
+#include <symengine/matrices/matrix_mul.h>
+#include <symengine/matrices/matrix_symbol.h>
+#include <symengine/matrices/transpose.h>
+#include <symengine/symengine_casts.h>
+#include <symengine/symengine_exception.h>
+#include <symengine/symengine_rcp.h>
+#include <symengine/visitor.h>
+
+#include "Tinned/PerturbedParameter.hpp"
+#include "Tinned/ConjugateTranspose.hpp"
+#include "Tinned/OneElecDensity.hpp"
+#include "Tinned/OneElecOperator.hpp"
+#include "Tinned/TwoElecOperator.hpp"
+#include "Tinned/ExchCorrPotential.hpp"
+#include "Tinned/TemporumOperator.hpp"
+#include "Tinned/TemporumOverlap.hpp"
+
+#include "Tinned/AsyncExecutor.hpp"
+#include "Tinned/StringifyVisitor.hpp"
+
+namespace Tinned
+{
+    // Helper function to wrap an already computed value into a ready future,
+    // can be used by leaf callbacks that do not dispatch their work
+    template<typename T>
+    inline std::shared_future<T> make_ready_future(const T& value)
+    {
+        std::promise<T> promise;
+        promise.set_value(value);
+        return promise.get_future().share();
+    }
+
+    // Storage of one traversal of asynchronous evaluators. Scalars are used
+    // by continuations running in other threads, and they are released by
+    // the traversing thread only after all roots of the traversal have
+    // finished, so that other threads never touch reference counts of
+    // SymEngine objects.
+    struct AsyncTraversal
+    {
+        // Scalars used by continuations, a deque keeps their addresses
+        std::deque<SymEngine::RCP<const SymEngine::Number>> scalars;
+        // Leaf nodes, which are submitted after the traversal so that the
+        // graph of nodes is complete before any of them runs
+        std::vector<std::shared_ptr<AsyncTask>> leaves;
+        // Nodes of values returned to the caller, which depend on all other
+        // nodes of the traversal
+        std::vector<std::shared_ptr<AsyncTask>> roots;
+
+        inline bool is_finished() const noexcept
+        {
+            for (const auto& root: roots) if (!root->is_finished()) return false;
+            return true;
+        }
+    };
+
+    template<typename FunctionType, typename OperatorType> class AsyncFunctionEvaluator;
+
+    // Asynchronous variant of `OperatorEvaluator`. Leaf callbacks return
+    // future-like handles so that the host program can dispatch, for example,
+    // Fock builds or XC grid passes to other compute processes, and the
+    // combination of operators (addition, multiplication, scale, ...) is
+    // chained as continuations of these handles. `apply()` therefore returns
+    // as soon as the whole expression has been traversed, and many leaf
+    // computations can be in flight at the same time.
+    //
+    // Continuations are run by an `AsyncExecutor` with a fixed number of
+    // threads, only after the values they depend on are ready. Combination
+    // callbacks are synchronous and they may run concurrently in different
+    // threads, so they should be thread-safe. Each call of `apply()` builds
+    // its own graph of nodes, so that expressions of earlier calls may still
+    // be in flight. `apply()` itself should be called by one thread, and the
+    // evaluator must outlive all the futures it returns.
+    //
+    // Unlike `OperatorEvaluator`, frequency bindings, evaluation plans, the
+    // fused callbacks `eval_oper_gemm()` and `eval_oper_axpy()`, and
+    // component layouts are not supported. Scalars must be numbers, and leaf
+    // callbacks of `TemporumOperator` objects use their own frequencies.
+    template<typename OperatorType>
+    class AsyncOperatorEvaluator: public SymEngine::BaseVisitor<AsyncOperatorEvaluator<OperatorType>>
+    {
+        // Function evaluator traverses operators within its own expression
+        template<typename FunctionType, typename T> friend class AsyncFunctionEvaluator;
+
+        public:
+            typedef std::shared_future<OperatorType> FutureOperator;
+            typedef AsyncNode<OperatorType> OperatorNode;
+
+        protected:
+            // Executor of continuations, shared with function evaluators
+            std::shared_ptr<AsyncExecutor> executor_;
+            // Each symbol adds its derivative to the end of the vector, and
+            // its parent checks the validity of derivative and may remove it
+            // when the child symbol has been evaluated.
+            std::vector<SymEngine::multiset_basic> derivatives_;
+            std::shared_ptr<OperatorNode> result_;
+            // Storage of the traversal being built, and of earlier
+            // traversals whose continuations may still be running
+            std::shared_ptr<AsyncTraversal> traversal_;
+            std::vector<std::shared_ptr<AsyncTraversal>> pending_traversals_;
+
+            virtual FutureOperator eval_pert_parameter(const PerturbedParameter& x)
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncOperatorEvaluator::eval_pert_parameter() is not implemented"
+                );
+            }
+
+            virtual FutureOperator eval_1el_density(const OneElecDensity& x)
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncOperatorEvaluator::eval_1el_density() is not implemented"
+                );
+            }
+
+            virtual FutureOperator eval_1el_operator(const OneElecOperator& x)
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncOperatorEvaluator::eval_1el_operator() is not implemented"
+                );
+            }
+
+            virtual FutureOperator eval_2el_operator(const TwoElecOperator& x)
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncOperatorEvaluator::eval_2el_operator() is not implemented"
+                );
+            }
+
+            virtual FutureOperator eval_xc_potential(const ExchCorrPotential& x)
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncOperatorEvaluator::eval_xc_potential() is not implemented"
+                );
+            }
+
+            virtual FutureOperator eval_temporum_operator(const TemporumOperator& x)
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncOperatorEvaluator::eval_temporum_operator() is not implemented"
+                );
+            }
+
+            virtual FutureOperator eval_temporum_overlap(const TemporumOverlap& x)
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncOperatorEvaluator::eval_temporum_overlap() is not implemented"
+                );
+            }
+
+            // return A^{\dagger}
+            virtual OperatorType eval_hermitian_transpose(const OperatorType& A)
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncOperatorEvaluator::eval_hermitian_transpose() is not implemented"
+                );
+            }
+
+            // return A^{*}
+            virtual OperatorType eval_conjugate_matrix(const OperatorType& A)
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncOperatorEvaluator::eval_conjugate_matrix() is not implemented"
+                );
+            }
+
+            // return A^{T}
+            virtual OperatorType eval_transpose(const OperatorType& A)
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncOperatorEvaluator::eval_transpose() is not implemented"
+                );
+            }
+
+            // A = A + B
+            virtual void eval_oper_addition(OperatorType& A, const OperatorType& B)
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncOperatorEvaluator::eval_oper_addition() is not implemented"
+                );
+            }
+
+            // return A * B
+            virtual OperatorType eval_oper_multiplication(
+                const OperatorType& A, const OperatorType& B
+            )
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncOperatorEvaluator::eval_oper_multiplication() is not implemented"
+                );
+            }
+
+            // A = scalar * A
+            virtual void eval_oper_scale(
+                const SymEngine::RCP<const SymEngine::Number>& scalar,
+                OperatorType& A
+            )
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncOperatorEvaluator::eval_oper_scale() is not implemented"
+                );
+            }
+
+            // Update the derivative of a multiplication
+            inline void update_mul_derivative() noexcept
+            {
+                auto derivative = derivatives_.back();
+                derivatives_.pop_back();
+                // The derivative of a multiplication is the union of
+                // derivatives of all its factors
+                derivatives_.back().insert(derivative.begin(), derivative.end());
+            }
+
+            // Make a leaf node from the handle returned by a leaf callback
+            inline std::shared_ptr<OperatorNode> make_leaf(const FutureOperator& value)
+            {
+                auto node = std::make_shared<OperatorNode>(value);
+                traversal_->leaves.push_back(node);
+                return node;
+            }
+
+            // Keep a scalar alive for continuations of the traversal
+            inline const SymEngine::RCP<const SymEngine::Number>* keep_scalar(
+                const SymEngine::RCP<const SymEngine::Number>& scalar
+            )
+            {
+                traversal_->scalars.push_back(scalar);
+                return &traversal_->scalars.back();
+            }
+
+            // Start a traversal, and release the storage of earlier
+            // traversals that have finished
+            inline void begin_traversal_()
+            {
+                pending_traversals_.erase(
+                    std::remove_if(
+                        pending_traversals_.begin(),
+                        pending_traversals_.end(),
+                        [](const std::shared_ptr<AsyncTraversal>& traversal) -> bool {
+                            return traversal->is_finished();
+                        }
+                    ),
+                    pending_traversals_.end()
+                );
+                traversal_ = std::make_shared<AsyncTraversal>();
+            }
+
+            // Submit leaf nodes of the traversal, whose storage is kept until
+            // `roots` have finished
+            inline void end_traversal_(const std::vector<std::shared_ptr<AsyncTask>>& roots)
+            {
+                traversal_->roots = roots;
+                auto leaves = std::move(traversal_->leaves);
+                pending_traversals_.push_back(std::move(traversal_));
+                executor_->submit(leaves);
+            }
+
+            // Traverse an operator, whose derivatives are not mixed with
+            // those of previous traversals
+            inline std::shared_ptr<OperatorNode> traverse_(
+                const SymEngine::RCP<const SymEngine::Basic>& x
+            )
+            {
+                derivatives_.clear();
+                return apply_(x);
+            }
+
+            // Method called by objects to process their argument(s), which
+            // does not clear the derivatives of visited symbols
+            inline std::shared_ptr<OperatorNode> apply_(
+                const SymEngine::RCP<const SymEngine::Basic>& x
+            )
+            {
+                x->accept(*this);
+                return result_;
+            }
+
+        public:
+            // Continuations are run by `numThreads` threads
+            explicit AsyncOperatorEvaluator(
+                const unsigned int numThreads = std::thread::hardware_concurrency()
+            ): executor_(std::make_shared<AsyncExecutor>(numThreads)) {}
+
+            // Traverse `x` and return a handle of its value, leaf
+            // computations and their combination may still be running
+            inline FutureOperator apply(const SymEngine::RCP<const SymEngine::Basic>& x)
+            {
+                begin_traversal_();
+                auto node = traverse_(x);
+                end_traversal_({node});
+                return node->get_future();
+            }
+
+            // Traverse all expressions in `x` into one graph of nodes, whose
+            // leaves are submitted together
+            inline std::vector<FutureOperator> apply(const SymEngine::vec_basic& x)
+            {
+                begin_traversal_();
+                std::vector<std::shared_ptr<AsyncTask>> nodes;
+                std::vector<FutureOperator> values;
+                nodes.reserve(x.size());
+                values.reserve(x.size());
+                for (const auto& expr: x) {
+                    auto node = traverse_(expr);
+                    nodes.push_back(node);
+                    values.push_back(node->get_future());
+                }
+                end_traversal_(nodes);
+                return values;
+            }
+
+            inline std::vector<SymEngine::multiset_basic> get_derivatives() const
+            {
+                return derivatives_;
+            }
+
+            // Scalars of pending traversals are released only after their
+            // continuations have finished
+            virtual ~AsyncOperatorEvaluator()
+            {
+                executor_->wait();
+            }
+
+            void bvisit(const SymEngine::Basic& x)
+            {
+                throw SymEngine::NotImplementedError(
+                    "AsyncOperatorEvaluator::bvisit() not implemented for " + stringify(x)
+                );
+            }
+
+            void bvisit(const SymEngine::MatrixSymbol& x)
+            {
+                if (SymEngine::is_a_sub<const PerturbedParameter>(x)) {
+                    auto& op = SymEngine::down_cast<const PerturbedParameter&>(x);
+                    derivatives_.push_back(op.get_derivatives());
+                    result_ = make_leaf(eval_pert_parameter(op));
+                }
+                else if (SymEngine::is_a_sub<const ConjugateTranspose>(x)) {
+                    auto& op = SymEngine::down_cast<const ConjugateTranspose&>(x);
+                    auto arg = apply_(op.get_arg());
+                    auto A = arg->get_future();
+                    result_ = make_async_node<OperatorType>({arg}, [this, A]() -> OperatorType {
+                        return this->eval_hermitian_transpose(A.get());
+                    });
+                }
+                else if (SymEngine::is_a_sub<const OneElecDensity>(x)) {
+                    auto& op = SymEngine::down_cast<const OneElecDensity&>(x);
+                    derivatives_.push_back(op.get_derivatives());
+                    result_ = make_leaf(eval_1el_density(op));
+                }
+                else if (SymEngine::is_a_sub<const OneElecOperator>(x)) {
+                    auto& op = SymEngine::down_cast<const OneElecOperator&>(x);
+                    derivatives_.push_back(op.get_derivatives());
+                    result_ = make_leaf(eval_1el_operator(op));
+                }
+                else if (SymEngine::is_a_sub<const TwoElecOperator>(x)) {
+                    auto& op = SymEngine::down_cast<const TwoElecOperator&>(x);
+                    auto op_derivatives = op.get_derivatives();
+                    auto state_derivatives = op.get_state()->get_derivatives();
+                    op_derivatives.insert(
+                        state_derivatives.begin(), state_derivatives.end()
+                    );
+                    derivatives_.push_back(op_derivatives);
+                    result_ = make_leaf(eval_2el_operator(op));
+                }
+                else if (SymEngine::is_a_sub<const ExchCorrPotential>(x)) {
+                    auto& op = SymEngine::down_cast<const ExchCorrPotential&>(x);
+                    derivatives_.push_back(op.get_derivatives());
+                    result_ = make_leaf(eval_xc_potential(op));
+                }
+                else if (SymEngine::is_a_sub<const TemporumOperator>(x)) {
+                    auto& op = SymEngine::down_cast<const TemporumOperator&>(x);
+                    derivatives_.push_back(op.get_derivatives());
+                    result_ = make_leaf(eval_temporum_operator(op));
+                }
+                else if (SymEngine::is_a_sub<const TemporumOverlap>(x)) {
+                    auto& op = SymEngine::down_cast<const TemporumOverlap&>(x);
+                    derivatives_.push_back(op.get_derivatives());
+                    result_ = make_leaf(eval_temporum_overlap(op));
+                }
+                else {
+                    throw SymEngine::NotImplementedError(
+                        "AsyncOperatorEvaluator::bvisit() not implemented for MatrixSymbol "
+                        + stringify(x)
+                    );
+                }
+            }
+
+            void bvisit(const SymEngine::ConjugateMatrix& x)
+            {
+                auto arg = apply_(x.get_arg());
+                auto A = arg->get_future();
+                result_ = make_async_node<OperatorType>({arg}, [this, A]() -> OperatorType {
+                    return this->eval_conjugate_matrix(A.get());
+                });
+            }
+
+            void bvisit(const SymEngine::Transpose& x)
+            {
+                auto arg = apply_(x.get_arg());
+                auto A = arg->get_future();
+                result_ = make_async_node<OperatorType>({arg}, [this, A]() -> OperatorType {
+                    return this->eval_transpose(A.get());
+                });
+            }
+
+            void bvisit(const SymEngine::MatrixAdd& x)
+            {
+                // All terms are dispatched before any of them is waited for,
+                // and a single continuation accumulates them in order
+                auto args = x.get_args();
+                std::vector<std::shared_ptr<AsyncTask>> nodes;
+                std::vector<FutureOperator> terms;
+                nodes.reserve(args.size());
+                terms.reserve(args.size());
+                for (std::size_t i=0; i<args.size(); ++i) {
+                    auto node = apply_(args[i]);
+                    nodes.push_back(node);
+                    terms.push_back(node->get_future());
+                    if (i==0) continue;
+                    // Arguments of `MatrixAdd` should have the same derivative
+                    if (SymEngine::unified_eq(
+                        derivatives_.back(), derivatives_[derivatives_.size()-2]
+                    )) {
+                        // We keep only the derivative of the first argument,
+                        // which represents the derivative of `MatrixAdd`
+                        derivatives_.pop_back();
+                    }
+                    else {
+                        throw SymEngine::NotImplementedError(
+                            "AsyncOperatorEvaluator::bvisit() got invalid MatrixAdd "
+                            + stringify(x)
+                        );
+                    }
+                }
+                // Continuations hold futures instead of nodes, so that nodes
+                // are released once they have finished
+                result_ = make_async_node<OperatorType>(
+                    nodes,
+                    [this, terms]() -> OperatorType {
+                        OperatorType sum = terms[0].get();
+                        for (std::size_t i=1; i<terms.size(); ++i)
+                            this->eval_oper_addition(sum, terms[i].get());
+                        return sum;
+                    }
+                );
+            }
+
+            void bvisit(const SymEngine::MatrixMul& x)
+            {
+                SymEngine::RCP<const SymEngine::Number> scalar = SymEngine::one;
+                auto x_scalar = x.get_scalar();
+                if (SymEngine::neq(*x_scalar, *SymEngine::one)) {
+                    if (SymEngine::is_a_Number(*x_scalar)) {
+                        scalar = SymEngine::rcp_dynamic_cast<const SymEngine::Number>(x_scalar);
+                    }
+                    else {
+                        throw SymEngine::NotImplementedError(
+                            "AsyncOperatorEvaluator::bvisit() not implemented for scalar "
+                            + stringify(x_scalar)
+                        );
+                    }
+                }
+                auto factors = x.get_factors();
+                std::vector<std::shared_ptr<AsyncTask>> nodes;
+                std::vector<FutureOperator> values;
+                nodes.reserve(factors.size());
+                values.reserve(factors.size());
+                for (std::size_t i=0; i<factors.size(); ++i) {
+                    auto node = apply_(factors[i]);
+                    // Nothing to combine, so we simply forward the node
+                    if (factors.size()==1 && scalar->is_one()) {
+                        result_ = node;
+                        return;
+                    }
+                    nodes.push_back(node);
+                    values.push_back(node->get_future());
+                    if (i>0) update_mul_derivative();
+                }
+                auto p_scalar = keep_scalar(scalar);
+                result_ = make_async_node<OperatorType>(
+                    nodes,
+                    [this, values, p_scalar]() -> OperatorType {
+                        OperatorType product = values.size()==1
+                            ? values[0].get()
+                            : this->eval_oper_multiplication(values[0].get(), values[1].get());
+                        for (std::size_t i=2; i<values.size(); ++i)
+                            product = this->eval_oper_multiplication(product, values[i].get());
+                        if (!(*p_scalar)->is_one()) this->eval_oper_scale(*p_scalar, product);
+                        return product;
+                    }
+                );
+            }
+    };
+}
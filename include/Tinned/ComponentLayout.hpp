@@ -0,0 +1,93 @@
+/* Tinned: a set of nonnumerical routines for computational chemistry
+   Copyright 2023-2024 Bin Gao
+
+   This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+   This file is the header file of layouts of components of
+   perturbation-strength derivatives.
+
+   2026-10-18, Bin Gao:
+   * first version
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+#include <symengine/basic.h>
+#include <symengine/dict.h>
+#include <symengine/symengine_rcp.h>
+
+#include "Tinned/Perturbation.hpp"
+
+namespace Tinned
+{
+    // Layout of components of perturbation-strength derivatives, so that a
+    // symbolic derivative with respect to perturbations is derived only once
+    // and evaluated for all its components in one call.
+    //
+    // Derivatives with respect to a same perturbation commute, so that only
+    // non-decreasing component tuples of a perturbation of order n are
+    // stored, and the number of them is C(|components|+n-1, n). Component
+    // tuples of different perturbations are stored in a row-major way, i.e.
+    // those of the last perturbation run fastest. A perturbation without
+    // components is considered to have only one component 0.
+    //
+    // Layouts are defined only for leaves, i.e. for callbacks of evaluators
+    // like `eval_1el_operator()`, whose batches hold all components of the
+    // leaf. Combination callbacks like `eval_oper_multiplication()` receive
+    // batches of their arguments without a layout of the result, because
+    // identical terms have been merged in the symbolic derivative. For
+    // example, the term 2*A^{el}*B^{el} of (A*B)^{el,el} means
+    // A^{i}*B^{j}+A^{j}*B^{i} for the component tuple (i,j), not
+    // 2*A^{i}*B^{j}. Hosts combining batches should therefore evaluate such
+    // terms by looping over `get_components()` of the layout of the merged
+    // derivatives and symmetrizing over the components of each
+    // perturbation, otherwise leaf batches should be evaluated per term.
+    class ComponentLayout
+    {
+        protected:
+            // Distinct perturbations of the derivatives and their orders
+            std::vector<SymEngine::RCP<const Perturbation>> perturbations_;
+            std::vector<unsigned int> orders_;
+            // Non-decreasing component tuples of each distinct perturbation
+            std::vector<std::vector<std::vector<std::size_t>>> component_tuples_;
+            std::vector<std::map<std::vector<std::size_t>, std::size_t>> idx_component_tuples_;
+            std::size_t size_;
+
+        public:
+            explicit ComponentLayout(const SymEngine::multiset_basic& derivatives);
+
+            // Number of components, i.e. the size of a batch
+            inline std::size_t size() const noexcept
+            {
+                return size_;
+            }
+
+            inline const std::vector<SymEngine::RCP<const Perturbation>>&
+            get_perturbations() const noexcept
+            {
+                return perturbations_;
+            }
+
+            inline const std::vector<unsigned int>& get_orders() const noexcept
+            {
+                return orders_;
+            }
+
+            // Get the components of derivatives from an index in the layout,
+            // which follow the order of derivatives in the multiset
+            std::vector<std::size_t> get_components(std::size_t index) const;
+
+            // Get the index in the layout from components of derivatives
+            // following the order of derivatives in the multiset, where
+            // components of a same perturbation can be in any order
+            std::size_t get_index(const std::vector<std::size_t>& components) const;
+
+            ~ComponentLayout() = default;
+    };
+}
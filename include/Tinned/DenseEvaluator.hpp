@@ -0,0 +1,164 @@
+/* Tinned: a set of nonnumerical routines for computational chemistry
+   Copyright 2023-2024 Bin Gao
+
+   This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+   This file is the header file of numerical evaluators using dense complex
+   matrices.
+
+   2026-10-18, Bin Gao:
+   * first version
+*/
+
+#pragma once
+
+#include <complex>
+#include <map>
+#include <memory>
+
+#include <symengine/basic.h>
+#include <symengine/number.h>
+#include <symengine/symengine_rcp.h>
+
+#include "Tinned/PerturbedParameter.hpp"
+#include "Tinned/OneElecDensity.hpp"
+#include "Tinned/OneElecOperator.hpp"
+#include "Tinned/TwoElecEnergy.hpp"
+#include "Tinned/TwoElecOperator.hpp"
+#include "Tinned/ExchCorrEnergy.hpp"
+#include "Tinned/ExchCorrPotential.hpp"
+#include "Tinned/NonElecFunction.hpp"
+#include "Tinned/TemporumOperator.hpp"
+#include "Tinned/TemporumOverlap.hpp"
+
+#include "Tinned/DenseMatrix.hpp"
+#include "Tinned/OperatorEvaluator.hpp"
+#include "Tinned/FunctionEvaluator.hpp"
+
+namespace Tinned
+{
+    // Values of operators (and their derivatives)
+    typedef std::map<SymEngine::RCP<const SymEngine::Basic>,
+                     DenseMatrix,
+                     SymEngine::RCPBasicKeyLess> DenseOperatorMap;
+
+    // Values of functions (and their derivatives)
+    typedef std::map<SymEngine::RCP<const SymEngine::Basic>,
+                     std::complex<double>,
+                     SymEngine::RCPBasicKeyLess> DenseFunctionMap;
+
+    // Operator evaluator using dense complex matrices, values of operators
+    // and their derivatives are looked up from a table. If a
+    // `TemporumOperator` object is not in the table, its value will be
+    // computed from the value of its target and its frequency factor.
+    class DenseOperatorEvaluator: public OperatorEvaluator<DenseMatrix>
+    {
+        protected:
+            DenseOperatorMap values_;
+
+            const DenseMatrix& get_value(const SymEngine::Basic& x) const;
+
+            DenseMatrix eval_pert_parameter(const PerturbedParameter& x) override;
+            DenseMatrix eval_hermitian_transpose(const DenseMatrix& A) override;
+            DenseMatrix eval_1el_density(const OneElecDensity& x) override;
+            DenseMatrix eval_1el_operator(const OneElecOperator& x) override;
+            DenseMatrix eval_2el_operator(const TwoElecOperator& x) override;
+            DenseMatrix eval_xc_potential(const ExchCorrPotential& x) override;
+            DenseMatrix eval_temporum_operator(const TemporumOperator& x) override;
+            DenseMatrix eval_temporum_overlap(const TemporumOverlap& x) override;
+            DenseMatrix eval_conjugate_matrix(const DenseMatrix& A) override;
+            DenseMatrix eval_transpose(const DenseMatrix& A) override;
+
+            void eval_oper_addition(DenseMatrix& A, const DenseMatrix& B) override;
+
+            DenseMatrix eval_oper_multiplication(
+                const DenseMatrix& A, const DenseMatrix& B
+            ) override;
+
+            void eval_oper_scale(
+                const SymEngine::RCP<const SymEngine::Number>& scalar,
+                DenseMatrix& A
+            ) override;
+
+            void eval_oper_gemm(
+                DenseMatrix& C,
+                const SymEngine::RCP<const SymEngine::Number>& alpha,
+                const DenseMatrix& A,
+                const DenseMatrix& B
+            ) override;
+
+            void eval_oper_axpy(
+                DenseMatrix& A,
+                const SymEngine::RCP<const SymEngine::Number>& alpha,
+                const DenseMatrix& B
+            ) override;
+
+            bool has_fused_callbacks() const noexcept override
+            {
+                return true;
+            }
+
+        public:
+            explicit DenseOperatorEvaluator(const DenseOperatorMap& values = {}):
+                values_(values) {}
+
+            // Set the value of an operator or its derivative
+            inline void set_value(
+                const SymEngine::RCP<const SymEngine::Basic>& x,
+                const DenseMatrix& value
+            )
+            {
+                values_[x] = value;
+            }
+
+            ~DenseOperatorEvaluator() = default;
+    };
+
+    // Function evaluator using dense complex matrices, values of functions
+    // and their derivatives are looked up from a table
+    class DenseFunctionEvaluator: public FunctionEvaluator<std::complex<double>, DenseMatrix>
+    {
+        protected:
+            DenseFunctionMap values_;
+
+            std::complex<double> get_value(const SymEngine::Basic& x) const;
+
+            std::complex<double> eval_nonel_function(const NonElecFunction& x) override;
+            std::complex<double> eval_2el_energy(const TwoElecEnergy& x) override;
+            std::complex<double> eval_xc_energy(const ExchCorrEnergy& x) override;
+            std::complex<double> eval_trace(const DenseMatrix& A) override;
+
+            std::complex<double> eval_trace_product(
+                const DenseMatrix& A, const DenseMatrix& B
+            ) override;
+
+            void eval_fun_addition(
+                std::complex<double>& f, const std::complex<double>& g
+            ) override;
+
+            void eval_fun_scale(
+                const SymEngine::RCP<const SymEngine::Number>& scalar,
+                std::complex<double>& f
+            ) override;
+
+        public:
+            explicit DenseFunctionEvaluator(
+                const std::shared_ptr<DenseOperatorEvaluator>& operEvaluator,
+                const DenseFunctionMap& values = {}
+            ): FunctionEvaluator<std::complex<double>, DenseMatrix>(operEvaluator),
+               values_(values) {}
+
+            // Set the value of a function or its derivative
+            inline void set_value(
+                const SymEngine::RCP<const SymEngine::Basic>& x,
+                const std::complex<double>& value
+            )
+            {
+                values_[x] = value;
+            }
+
+            ~DenseFunctionEvaluator() = default;
+    };
+}
@@ -0,0 +1,129 @@
+/* Tinned: a set of nonnumerical routines for computational chemistry
+   Copyright 2023-2024 Bin Gao
+
+   This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+   This file is the header file of dense complex matrices and their BLAS-like
+   kernels.
+
+   2026-10-18, Bin Gao:
+   * first version
+*/
+
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace Tinned
+{
+    // Dense complex matrix stored contiguously in row-major order
+    class DenseMatrix
+    {
+        protected:
+            std::size_t nrows_;
+            std::size_t ncols_;
+            std::vector<std::complex<double>> values_;
+
+        public:
+            explicit DenseMatrix() noexcept: nrows_(0), ncols_(0) {}
+
+            explicit DenseMatrix(
+                const std::size_t nrows,
+                const std::size_t ncols,
+                const std::complex<double>& value = 0.0
+            ): nrows_(nrows), ncols_(ncols), values_(nrows*ncols, value) {}
+
+            // `values` are in row-major order
+            explicit DenseMatrix(
+                const std::size_t nrows,
+                const std::size_t ncols,
+                const std::vector<std::complex<double>>& values
+            );
+
+            inline std::size_t nrows() const noexcept
+            {
+                return nrows_;
+            }
+
+            inline std::size_t ncols() const noexcept
+            {
+                return ncols_;
+            }
+
+            inline std::size_t size() const noexcept
+            {
+                return values_.size();
+            }
+
+            inline std::complex<double>* data() noexcept
+            {
+                return values_.data();
+            }
+
+            inline const std::complex<double>* data() const noexcept
+            {
+                return values_.data();
+            }
+
+            inline std::complex<double>& operator()(
+                const std::size_t i, const std::size_t j
+            ) noexcept
+            {
+                return values_[i*ncols_+j];
+            }
+
+            inline const std::complex<double>& operator()(
+                const std::size_t i, const std::size_t j
+            ) const noexcept
+            {
+                return values_[i*ncols_+j];
+            }
+
+            inline bool has_same_shape(const DenseMatrix& other) const noexcept
+            {
+                return nrows_==other.nrows_ && ncols_==other.ncols_;
+            }
+    };
+
+    // Helper function to make an identity matrix
+    DenseMatrix make_identity_matrix(const std::size_t dimension);
+
+    // `Y` = `Y` + `alpha` * `X`
+    void dense_axpy(
+        const std::complex<double>& alpha, const DenseMatrix& X, DenseMatrix& Y
+    );
+
+    // `X` = `alpha` * `X`
+    void dense_scal(const std::complex<double>& alpha, DenseMatrix& X);
+
+    // `C` = `alpha` * `A` * `B` + `beta` * `C`
+    void dense_gemm(
+        const std::complex<double>& alpha,
+        const DenseMatrix& A,
+        const DenseMatrix& B,
+        const std::complex<double>& beta,
+        DenseMatrix& C
+    );
+
+    // Return `A` * `B`
+    DenseMatrix dense_multiply(const DenseMatrix& A, const DenseMatrix& B);
+
+    // Return `A`^{\dagger}
+    DenseMatrix dense_adjoint(const DenseMatrix& A);
+
+    // Return `A`^{*}
+    DenseMatrix dense_conjugate(const DenseMatrix& A);
+
+    // Return `A`^{T}
+    DenseMatrix dense_transpose(const DenseMatrix& A);
+
+    // Return the trace of `A`
+    std::complex<double> dense_trace(const DenseMatrix& A);
+
+    // Return the trace of `A` * `B` without forming the product
+    std::complex<double> dense_trace_product(const DenseMatrix& A, const DenseMatrix& B);
+}
@@ -0,0 +1,133 @@
+/* Tinned: a set of nonnumerical routines for computational chemistry
+   Copyright 2023-2024 Bin Gao
+
+   This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+   This file is the header file of tables of generalized density vectors.
+
+   2026-10-18, Bin Gao:
+   * first version
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <symengine/basic.h>
+#include <symengine/number.h>
+#include <symengine/symengine_rcp.h>
+
+#include "Tinned/ElectronicState.hpp"
+#include "Tinned/OneElecOperator.hpp"
+#include "Tinned/ExchCorrContraction.hpp"
+
+namespace Tinned
+{
+    // Factor of a product of generalized density vectors, given by the index
+    // of the generalized density vector and its exponent
+    struct XcDensityFactor
+    {
+        std::size_t index;
+        unsigned int exponent;
+    };
+
+    // Product of generalized density vectors with a coefficient
+    struct XcDensityProduct
+    {
+        SymEngine::RCP<const SymEngine::Number> coef;
+        std::vector<XcDensityFactor> factors;
+    };
+
+    // Table of distinct generalized density vectors tr(Omega^{x}*D^{y}),
+    // together with the distinct (un)perturbed electronic states and
+    // generalized overlap distributions they are made of. One table can be
+    // shared by several XC energy and potential contraction maps, so that
+    // each generalized density vector is computed only once per grid point.
+    class DensityVectorTable
+    {
+        protected:
+            std::vector<SymEngine::RCP<const ElectronicState>> states_;
+            std::vector<SymEngine::RCP<const OneElecOperator>> overlaps_;
+            // Indices of generalized overlap distribution and electronic
+            // state of each generalized density vector
+            std::vector<std::pair<std::size_t, std::size_t>> density_vectors_;
+
+            // Look-up tables for the indices
+            std::map<SymEngine::RCP<const SymEngine::Basic>,
+                     std::size_t,
+                     SymEngine::RCPBasicKeyLess> idx_states_;
+            std::map<SymEngine::RCP<const SymEngine::Basic>,
+                     std::size_t,
+                     SymEngine::RCPBasicKeyLess> idx_overlaps_;
+            std::map<std::pair<std::size_t, std::size_t>, std::size_t> idx_density_vectors_;
+
+        public:
+            DensityVectorTable() = default;
+
+            std::size_t add_state(const SymEngine::RCP<const ElectronicState>& state);
+            std::size_t add_overlap(const SymEngine::RCP<const OneElecOperator>& Omega);
+
+            // Intern a generalized density vector tr(Omega*D) and return its
+            // index
+            std::size_t add_density_vector(const SymEngine::RCP<const SymEngine::Basic>& x);
+
+            // Rewrite a product of generalized density vectors
+            XcDensityProduct add_density_product(
+                const SymEngine::RCP<const SymEngine::Basic>& x
+            );
+
+            // Rewrite perturbed generalized density vectors of a contraction,
+            // i.e. a value of `ExcDensityContractionMap`, as a sum of
+            // products. A null value gives an empty sum.
+            std::vector<XcDensityProduct> add_density_products(
+                const SymEngine::RCP<const SymEngine::Basic>& x
+            );
+
+            // Intern all generalized density vectors of contraction maps
+            void add_energy_map(const ExcContractionMap& energyMap);
+            void add_potential_map(const VxcContractionMap& potentialMap);
+
+            inline std::size_t size() const noexcept
+            {
+                return density_vectors_.size();
+            }
+
+            inline const std::vector<SymEngine::RCP<const ElectronicState>>&
+            get_states() const noexcept
+            {
+                return states_;
+            }
+
+            inline const std::vector<SymEngine::RCP<const OneElecOperator>>&
+            get_overlap_distributions() const noexcept
+            {
+                return overlaps_;
+            }
+
+            // Each generalized density vector is given by indices of
+            // generalized overlap distribution and electronic state
+            inline const std::vector<std::pair<std::size_t, std::size_t>>&
+            get_density_vectors() const noexcept
+            {
+                return density_vectors_;
+            }
+
+            // Get the expression of a generalized density vector
+            inline SymEngine::RCP<const SymEngine::Basic> get_density_vector(
+                const std::size_t index
+            ) const
+            {
+                return make_density_vector(
+                    states_[density_vectors_[index].second],
+                    overlaps_[density_vectors_[index].first]
+                );
+            }
+
+            ~DensityVectorTable() = default;
+    };
+}
@@ -8,6 +8,10 @@
    This file is the header file of elimination of response parameters by
    following J. Chem. Phys. 129, 214103 (2008).
 
+   2026-10-18, Bin Gao:
+   * add `differentiate()` with elimination rules, which eliminates
+     response parameters after each order of differentiation.
+
    2024-05-03, Bin Gao:
    * previous implementation does not work since it uses `SymEngine::eq()` to
      compare a symbol and the parameter to be eliminated, which will also
@@ -22,6 +26,8 @@
 #include <functional>
 #include <string>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <symengine/basic.h>
 #include <symengine/add.h>
@@ -39,6 +45,8 @@
 #include <symengine/matrices/trace.h>
 #include <symengine/matrices/transpose.h>
 #include <symengine/matrices/zero_matrix.h>
+#include <symengine/symengine_assert.h>
+#include <symengine/symengine_casts.h>
 #include <symengine/symengine_exception.h>
 #include <symengine/symengine_rcp.h>
 #include <symengine/visitor.h>
@@ -47,8 +55,11 @@
 #include "Tinned/PertTuple.hpp"
 #include "Tinned/OneElecDensity.hpp"
 #include "Tinned/PerturbedParameter.hpp"
+#include "Tinned/ZeroOperator.hpp"
+#include "Tinned/ZerosRemover.hpp"
 
 #include "Tinned/VisitorUtilities.hpp"
+#include "Tinned/Profiler.hpp"
 
 namespace Tinned
 {
@@ -178,7 +189,59 @@ namespace Tinned
         const unsigned int min_order
     )
     {
+        TINNED_PROFILE_SCOPE("EliminationVisitor::apply");
         EliminationVisitor visitor(parameter, perturbations, min_order);
         return visitor.apply(x);
     }
+
+    // Elimination rule given by a response parameter and the minimum order
+    // of its derivatives to be eliminated, see `eliminate()`
+    typedef std::pair<SymEngine::RCP<const SymEngine::Basic>, unsigned int>
+        EliminationRule;
+
+    // Helper function to do high-order differentiation with respect to
+    // `perturbations`, and to eliminate response parameters by `eliminations`
+    // during the differentiation. The order of derivatives of a parameter
+    // never decreases in the further differentiation, so that a term is
+    // eliminated as soon as the order reaches the minimum order of a rule,
+    // and does not produce more terms by the product rule. The result equals
+    // that of eliminating parameters from the result of `differentiate()`.
+    template<typename T,
+             typename std::enable_if<std::is_same<T, PertTuple>::value ||
+                 std::is_same<T, SymEngine::multiset_basic>::value ||
+                 std::is_same<T, SymEngine::vec_basic>::value, int>::type = 0>
+    inline SymEngine::RCP<const SymEngine::Basic> differentiate(
+        const SymEngine::RCP<const SymEngine::Basic>& expr,
+        const T& perturbations,
+        const std::vector<EliminationRule>& eliminations
+    )
+    {
+        // Orders of derivatives are counted for all perturbations
+        PertTuple pert_tuple;
+        for (const auto& p: perturbations) {
+            SYMENGINE_ASSERT(SymEngine::is_a_sub<const Perturbation>(*p))
+            pert_tuple.insert(SymEngine::rcp_static_cast<const Perturbation>(p));
+        }
+        auto result = expr;
+        for (const auto& p: perturbations) {
+            result = result->diff(p);
+            for (const auto& rule: eliminations) {
+                result = eliminate(result, rule.first, pert_tuple, rule.second);
+                if (result.is_null()) break;
+            }
+            if (result.is_null()) break;
+        }
+        if (!result.is_null()) result = remove_zeros(result);
+        if (result.is_null()) {
+            if (SymEngine::is_a_sub<const SymEngine::MatrixExpr>(*expr)) {
+                return make_zero_operator();
+            }
+            else {
+                return SymEngine::zero;
+            }
+        }
+        else {
+            return result;
+        }
+    }
 }
@@ -0,0 +1,112 @@
+/* Tinned: a set of nonnumerical routines for computational chemistry
+   Copyright 2023-2024 Bin Gao
+
+   This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+   This file is the header file of planning the evaluation of operators.
+
+   2026-10-18, Bin Gao:
+   * first version
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+#include <symengine/basic.h>
+#include <symengine/matrices/conjugate_matrix.h>
+#include <symengine/matrices/matrix_add.h>
+#include <symengine/matrices/matrix_mul.h>
+#include <symengine/matrices/matrix_symbol.h>
+#include <symengine/matrices/transpose.h>
+#include <symengine/symengine_rcp.h>
+#include <symengine/visitor.h>
+
+namespace Tinned
+{
+    // Index of the argument to be evaluated first for each matrix addition
+    typedef std::map<SymEngine::RCP<const SymEngine::Basic>,
+                     std::size_t,
+                     SymEngine::RCPBasicKeyLess> EvaluationPlan;
+
+    // Liveness analysis of `OperatorEvaluator`, which predicts the peak
+    // number of operators alive at the same time during the evaluation of an
+    // expression. Intermediate operators are released as soon as they have
+    // been consumed, and the peak number is minimized by evaluating the most
+    // demanding argument of each matrix addition first, when no partial sum
+    // is alive.
+    class EvaluationPlanner: public SymEngine::BaseVisitor<EvaluationPlanner>
+    {
+        protected:
+            // If callbacks `eval_oper_gemm()` and `eval_oper_axpy()` work
+            // without temporaries
+            bool fused_;
+            // Peak number of live operators of the last visited symbol
+            std::size_t result_;
+            EvaluationPlan plan_;
+
+            // Peak number of live operators of multiplying the first
+            // `num_factors` factors from left to right, where `factor_peaks`
+            // are the peak numbers of evaluating each factor
+            std::size_t get_mul_peak(
+                const std::vector<std::size_t>& factor_peaks,
+                const std::size_t num_factors
+            ) const;
+
+            // Peak numbers of live operators of an argument of matrix
+            // addition, when it is evaluated first (`first_peak`) or added to
+            // the partial sum (`acc_peak`, including the partial sum)
+            void get_term_peaks(
+                const SymEngine::RCP<const SymEngine::Basic>& x,
+                std::size_t& first_peak,
+                std::size_t& acc_peak
+            );
+
+            // Method called by objects to process their argument(s)
+            inline std::size_t apply_(const SymEngine::RCP<const SymEngine::Basic>& x)
+            {
+                x->accept(*this);
+                return result_;
+            }
+
+        public:
+            explicit EvaluationPlanner(const bool fused = false) noexcept:
+                fused_(fused), result_(0) {}
+
+            // Return the peak number of live operators of evaluating `x`
+            inline std::size_t apply(const SymEngine::RCP<const SymEngine::Basic>& x)
+            {
+                plan_.clear();
+                return apply_(x);
+            }
+
+            // Return the evaluation order of matrix additions visited
+            inline const EvaluationPlan& get_plan() const noexcept
+            {
+                return plan_;
+            }
+
+            void bvisit(const SymEngine::Basic& x);
+            void bvisit(const SymEngine::MatrixSymbol& x);
+            void bvisit(const SymEngine::ConjugateMatrix& x);
+            void bvisit(const SymEngine::Transpose& x);
+            void bvisit(const SymEngine::MatrixAdd& x);
+            void bvisit(const SymEngine::MatrixMul& x);
+    };
+
+    // Helper function to get the peak number of live operators of evaluating
+    // `x`, `fused` indicates if the operator evaluator implements callbacks
+    // `eval_oper_gemm()` and `eval_oper_axpy()` without temporaries
+    inline std::size_t get_peak_live_operators(
+        const SymEngine::RCP<const SymEngine::Basic>& x,
+        const bool fused = false
+    )
+    {
+        EvaluationPlanner visitor(fused);
+        return visitor.apply(x);
+    }
+}
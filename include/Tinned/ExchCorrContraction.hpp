@@ -8,6 +8,19 @@
    This file implements functions for contractions between exchange-correlation
    energy functional derivative vectors and generalized density vectors.
 
+   2026-10-18, Bin Gao:
+   * extract `ExcContractionMap` in parallel (when SymEngine is thread-safe)
+     with a tree reduction, and optionally skip the validation of each term
+     in favour of `validate_energy_map()`;
+   * add `get_ordered_entries()` to export entries of contraction maps
+     ordered by their keys;
+   * add `add_energy_term()` and `diff_energy_map()`, so that
+     `ExcContractionMap` can be built and differentiated term by term
+     without expanding the whole XC energy expression;
+   * differentiate `ExcContractionMap` and `VxcContractionMap` directly by
+     the product rule on generalized density vectors and the Faa di Bruno
+     rule on XC functional derivatives.
+
    2024-05-10, Bin Gao:
    * add functions to stringify maps
 
@@ -22,9 +35,13 @@
 #include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include <symengine/basic.h>
+#include <symengine/constants.h>
 #include <symengine/dict.h>
+#include <symengine/number.h>
+#include <symengine/symbol.h>
 #include <symengine/matrices/matrix_expr.h>
 #include <symengine/matrices/matrix_mul.h>
 #include <symengine/matrices/trace.h>
@@ -67,6 +84,21 @@ namespace Tinned
                      SymEngine::RCPBasicKeyLess>
         VxcContractionMap;
 
+    // Export entries of a contraction map ordered by their keys with
+    // `SymEngine::RCPBasicKeyLess`, which is deterministic and used for
+    // printing and converting maps, and for tables built from maps
+    template<typename MapType>
+    inline std::vector<const typename MapType::value_type*> get_ordered_entries(
+        const MapType& contr_map
+    )
+    {
+        std::vector<const typename MapType::value_type*> entries;
+        entries.reserve(contr_map.size());
+        // Entries of `std::map` are already in the order of their keys
+        for (const auto& entry: contr_map) entries.push_back(&entry);
+        return entries;
+    }
+
     // Make (unperturbed) generalized density vector
     //FIXME: change `ElectronicState` to OneElecDensity?
     inline SymEngine::RCP<const SymEngine::Basic> make_density_vector(
@@ -133,13 +165,13 @@ namespace Tinned
         auto str_term_indent = str_indent + std::string("    ");
         std::ostringstream o;
         o << str_indent << "{\n";
-        for (const auto& term: exc_map) {
-            o << str_term_indent << visitor.convert(*term.first) << ",\n";
-            if (term.second.is_null()) {
+        for (const auto term: get_ordered_entries(exc_map)) {
+            o << str_term_indent << visitor.convert(*term->first) << ",\n";
+            if (term->second.is_null()) {
                 o << str_term_indent << "null,\n";
             }
             else {
-                o << str_term_indent << visitor.convert(*term.second) << ",\n";
+                o << str_term_indent << visitor.convert(*term->second) << ",\n";
             }
         }
         o << str_indent << "}";
@@ -148,11 +180,16 @@ namespace Tinned
 
     // Extract the grid weight, and corresponding contraction between XC
     // functional derivative and generalized density vectors from their
-    // multiplication expression.
+    // multiplication expression. Checking that generalized density vectors
+    // contain neither grid weights nor XC functional derivatives traverses
+    // them again, and can be skipped by `validate` as false.
     std::tuple<SymEngine::RCP<const NonElecFunction>,
                SymEngine::RCP<const CompositeFunction>,
                SymEngine::RCP<const SymEngine::Basic>>
-    extract_exc_contraction(const SymEngine::RCP<const SymEngine::Mul>& expr);
+    extract_exc_contraction(
+        const SymEngine::RCP<const SymEngine::Mul>& expr,
+        const bool validate = true
+    );
 
     // Add the output from `extract_exc_contraction()` into an `ExcContractionMap`
     void add_exc_contraction(
@@ -162,6 +199,17 @@ namespace Tinned
                          SymEngine::RCP<const SymEngine::Basic>>& value
     );
 
+    // Add a term of XC energy or its derivatives (multiplied by `coef`) into
+    // an `ExcContractionMap`, only generalized density vectors of the term,
+    // or the term itself if its grid weight and XC functional derivative
+    // cannot be found directly, will be expanded
+    void add_energy_term(
+        ExcContractionMap& energy_map,
+        const SymEngine::RCP<const SymEngine::Basic>& term,
+        const SymEngine::RCP<const SymEngine::Number>& coef = SymEngine::one,
+        const bool validate = true
+    );
+
     // Extract all terms in XC energy or its derivatives, i.e. (un)perturbed
     // weights, XC functional derivative vectors and perturbed generalized
     // density vectors. Results are arranged in a nested map. The key of the
@@ -169,8 +217,32 @@ namespace Tinned
     // another map whose key is the order of functional derivatives of XC
     // energy density, and whose value is the corresponding perturbed
     // generalized density vectors.
+    //
+    // When SymEngine is built thread-safe (`WITH_SYMENGINE_THREAD_SAFE`),
+    // terms can be partitioned over `numThreads` threads, each builds its own
+    // map, and maps are then merged pairwise as a tree; otherwise terms are
+    // always extracted serially. `validate` as false skips checking each
+    // term, see `extract_exc_contraction()` and `validate_energy_map()`.
     ExcContractionMap extract_energy_map(
-        const SymEngine::RCP<const SymEngine::Basic>& expr
+        const SymEngine::RCP<const SymEngine::Basic>& expr,
+        const unsigned int numThreads = 1,
+        const bool validate = true
+    );
+
+    // Check that generalized density vectors of an `ExcContractionMap`
+    // contain neither grid weights nor XC functional derivatives, an
+    // exception will be thrown otherwise. This is mainly for debug runs
+    // after extracting maps without validation.
+    void validate_energy_map(const ExcContractionMap& energy_map);
+
+    // Differentiate XC energy or its derivatives represented by an
+    // `ExcContractionMap` with respect to a perturbation. Each contraction
+    // w*exc^{(n)}*rho gives w^{s}*exc^{(n)}*rho, w*exc^{(n+1)}*tr(Omega*D)^{s}*rho
+    // and w*exc^{(n)}*rho^{s}, where products of generalized density vectors
+    // are differentiated factor by factor so that results stay expanded.
+    ExcContractionMap diff_energy_map(
+        const ExcContractionMap& energy_map,
+        const SymEngine::RCP<const SymEngine::Symbol>& s
     );
 
     // Merge the second `ExcContractionMap` to the first one
@@ -202,9 +274,9 @@ namespace Tinned
         auto str_term_indent = str_indent + std::string("    ");
         std::ostringstream o;
         o << str_indent << "{\n";
-        for (const auto& weight_map: energy_map) {
-            o << str_term_indent << visitor.convert(*weight_map.first) << ",\n"
-              << stringify_exc_density_map(visitor, weight_map.second, str_term_indent)
+        for (const auto weight_map: get_ordered_entries(energy_map)) {
+            o << str_term_indent << visitor.convert(*weight_map->first) << ",\n"
+              << stringify_exc_density_map(visitor, weight_map->second, str_term_indent)
               << ",\n";
         }
         o << str_indent << "}";
@@ -231,6 +303,13 @@ namespace Tinned
     // Merge the second `VxcContractionMap` to the first one
     void merge_potential_map(VxcContractionMap& map1, const VxcContractionMap& map2);
 
+    // Differentiate XC potential operator or its derivatives represented by
+    // a `VxcContractionMap` with respect to a perturbation
+    VxcContractionMap diff_potential_map(
+        const VxcContractionMap& potential_map,
+        const SymEngine::RCP<const SymEngine::Symbol>& s
+    );
+
     // Convert `VxcContractionMap` to XC potential operator or its derivatives
     SymEngine::RCP<const SymEngine::MatrixExpr> convert_potential_map(
         const VxcContractionMap& potential_map
@@ -257,9 +336,9 @@ namespace Tinned
         auto str_term_indent = str_indent + std::string("    ");
         std::ostringstream o;
         o << str_indent << "{\n";
-        for (const auto& energy_map: potential_map) {
-            o << str_term_indent << visitor.convert(*energy_map.first) << ",\n"
-              << stringify_energy_map(visitor, energy_map.second, str_term_indent)
+        for (const auto energy_map: get_ordered_entries(potential_map)) {
+            o << str_term_indent << visitor.convert(*energy_map->first) << ",\n"
+              << stringify_energy_map(visitor, energy_map->second, str_term_indent)
               << ",\n";
         }
         o << str_indent << "}";
@@ -8,6 +8,14 @@
    This file is the header file of exchange-correlation (XC) energy like
    functionals.
 
+   2026-10-18, Bin Gao:
+   * cache weights, states, overlap distributions, orders of XC functional
+     derivatives and derivatives at construction, and return them by
+     reference;
+   * keep `ExcContractionMap` as the canonical representation, which is
+     built and differentiated term by term instead of expanding the whole
+     XC energy expression.
+
    2024-05-04, Bin Gao:
    * add function `get_derivatives`
 
@@ -51,8 +59,24 @@ namespace Tinned
     class ExchCorrEnergy: public SymEngine::FunctionWrapper
     {
         protected:
-            // XC energy or its derivatives evaluated at grid points
+            // Canonical representation of XC energy or its derivatives
+            ExcContractionMap energy_map_;
+            // XC energy or its derivatives evaluated at grid points, which is
+            // converted from `energy_map_`
             SymEngine::RCP<const SymEngine::Basic> energy_;
+            // Unique (un)perturbed grid weights, electronic states and
+            // generalized overlap distributions, orders of XC functional
+            // derivatives and derivatives, found from `energy_` on the first
+            // access, because most objects, like intermediate ones of
+            // `diff()`, are never asked for them
+            mutable bool has_metadata_;
+            mutable SymEngine::set_basic weights_;
+            mutable SymEngine::set_basic states_;
+            mutable SymEngine::set_basic overlaps_;
+            mutable std::set<unsigned int> exc_orders_;
+            mutable SymEngine::multiset_basic derivatives_;
+
+            void find_metadata() const;
 
         public:
             //! Constructor
@@ -119,57 +143,40 @@ namespace Tinned
             }
 
             // Get all unique unperturbed and perturbed grid weights
-            inline SymEngine::set_basic get_weights() const
+            inline const SymEngine::set_basic& get_weights() const
             {
-                return find_all(energy_, get_weight());
+                find_metadata();
+                return weights_;
             }
 
             // Get all unique unperturbed and perturbed electronic states
-            inline SymEngine::set_basic get_states() const
+            inline const SymEngine::set_basic& get_states() const
             {
-                return find_all(energy_, get_state());
+                find_metadata();
+                return states_;
             }
 
             // Get derivatives, currently used only for `LaTeXifyVisitor` and
             // `FunctionEvaluator`
-            inline SymEngine::multiset_basic get_derivatives() const
+            inline const SymEngine::multiset_basic& get_derivatives() const
             {
-                auto states = get_states();
-                auto state = states.begin();
-                SYMENGINE_ASSERT(SymEngine::is_a_sub<const ElectronicState>(*(*state)))
-                auto op = SymEngine::rcp_dynamic_cast<const ElectronicState>(*state);
-                auto max_derivatives = op->get_derivatives();
-                for (; state!=states.end(); ++state) {
-                    SYMENGINE_ASSERT(SymEngine::is_a_sub<const ElectronicState>(*(*state)))
-                    op = SymEngine::rcp_dynamic_cast<const ElectronicState>(*state);
-                    auto derivatives = op->get_derivatives();
-                    if (derivatives.size()>max_derivatives.size())
-                        max_derivatives = std::move(derivatives);
-                }
-                return max_derivatives;
+                find_metadata();
+                return derivatives_;
             }
 
             // Get all unique unperturbed and perturbed generalized overlap
             // distribution vectors
-            inline SymEngine::set_basic get_overlap_distributions() const
+            inline const SymEngine::set_basic& get_overlap_distributions() const
             {
-                return find_all(energy_, get_overlap_distribution());
+                find_metadata();
+                return overlaps_;
             }
 
             // Get all unique orders of functional derivatives of XC energy density
-            inline std::set<unsigned int> get_exc_orders() const
+            inline const std::set<unsigned int>& get_exc_orders() const
             {
-                auto exc = find_all(
-                    energy_,
-                    make_exc_density(get_state(), get_overlap_distribution(), 0)
-                );
-                std::set<unsigned int> orders;
-                for (auto& e: exc) {
-                    SYMENGINE_ASSERT(SymEngine::is_a_sub<const CompositeFunction>(*e))
-                    auto op = SymEngine::rcp_dynamic_cast<const CompositeFunction>(e);
-                    orders.insert(op->get_order());
-                }
-                return orders;
+                find_metadata();
+                return exc_orders_;
             }
 
             // Get all terms in XC energy or its derivatives, each is a product
@@ -215,9 +222,9 @@ namespace Tinned
             // is the order of functional derivatives of XC energy density, and
             // whose value is the corresponding perturbed generalized density
             // vectors.
-            inline ExcContractionMap get_energy_map() const
+            inline const ExcContractionMap& get_energy_map() const noexcept
             {
-                return extract_energy_map(energy_);
+                return energy_map_;
             }
     };
 
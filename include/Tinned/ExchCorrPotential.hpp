@@ -8,6 +8,13 @@
    This file is the header file of exchange-correlation (XC) potential like
    operators.
 
+   2026-10-18, Bin Gao:
+   * cache weights, states, overlap distributions, orders of XC functional
+     derivatives and derivatives at construction, and return them by
+     reference;
+   * keep `VxcContractionMap` as the canonical representation, which is
+     differentiated directly by `diff_potential_map()`.
+
    2024-05-04, Bin Gao:
    * add function `get_derivatives`
 
@@ -53,9 +60,25 @@ namespace Tinned
             // Grid weight
             SymEngine::RCP<const NonElecFunction> weight_;
 
+            // Canonical representation of XC potential operator or its
+            // derivatives
+            VxcContractionMap potential_map_;
             // XC potential operator or its derivatives evaluated at grid
-            // points
+            // points, which is converted from `potential_map_`
             SymEngine::RCP<const SymEngine::MatrixExpr> potential_;
+            // Unique (un)perturbed grid weights, electronic states and
+            // generalized overlap distributions, orders of XC functional
+            // derivatives and derivatives, found from `potential_` on the first
+            // access, because most objects, like intermediate ones of
+            // `diff()`, are never asked for them
+            mutable bool has_metadata_;
+            mutable SymEngine::set_basic weights_;
+            mutable SymEngine::set_basic states_;
+            mutable SymEngine::set_basic overlaps_;
+            mutable std::set<unsigned int> exc_orders_;
+            mutable SymEngine::multiset_basic derivatives_;
+
+            void find_metadata() const;
 
         public:
             //! Constructor
@@ -119,54 +142,40 @@ namespace Tinned
             }
 
             // Get all unique unperturbed and perturbed grid weights
-            inline SymEngine::set_basic get_weights() const
+            inline const SymEngine::set_basic& get_weights() const
             {
-                return find_all(potential_, get_weight());
+                find_metadata();
+                return weights_;
             }
 
             // Get all unique unperturbed and perturbed electronic states
-            inline SymEngine::set_basic get_states() const
+            inline const SymEngine::set_basic& get_states() const
             {
-                return find_all(potential_, get_state());
+                find_metadata();
+                return states_;
             }
 
             // Get derivatives, currently used only for `LaTeXifyVisitor` and
             // `OperatorEvaluator`
-            inline SymEngine::multiset_basic get_derivatives() const
+            inline const SymEngine::multiset_basic& get_derivatives() const
             {
-                auto states = get_states();
-                auto state = states.begin();
-                SYMENGINE_ASSERT(SymEngine::is_a_sub<const ElectronicState>(*(*state)))
-                auto op = SymEngine::rcp_dynamic_cast<const ElectronicState>(*state);
-                auto max_derivatives = op->get_derivatives();
-                for (; state!=states.end(); ++state) {
-                    SYMENGINE_ASSERT(SymEngine::is_a_sub<const ElectronicState>(*(*state)))
-                    op = SymEngine::rcp_dynamic_cast<const ElectronicState>(*state);
-                    auto derivatives = op->get_derivatives();
-                    if (derivatives.size()>max_derivatives.size())
-                        max_derivatives = std::move(derivatives);
-                }
-                return max_derivatives;
+                find_metadata();
+                return derivatives_;
             }
 
             // Get all unique unperturbed and perturbed generalized overlap
             // distribution vectors
-            inline SymEngine::set_basic get_overlap_distributions() const
+            inline const SymEngine::set_basic& get_overlap_distributions() const
             {
-                return find_all(potential_, get_overlap_distribution());
+                find_metadata();
+                return overlaps_;
             }
 
             // Get all unique orders of functional derivatives of XC energy density
-            inline std::set<unsigned int> get_exc_orders() const
+            inline const std::set<unsigned int>& get_exc_orders() const
             {
-                auto exc = find_all(potential_, make_exc_density(state_, Omega_, 1));
-                std::set<unsigned int> orders;
-                for (auto& e: exc) {
-                    SYMENGINE_ASSERT(SymEngine::is_a_sub<const CompositeFunction>(*e))
-                    auto op = SymEngine::rcp_dynamic_cast<const CompositeFunction>(e);
-                    orders.insert(op->get_order());
-                }
-                return orders;
+                find_metadata();
+                return exc_orders_;
             }
 
             // Get all terms in XC potential operator or its derivatives, each
@@ -210,9 +219,9 @@ namespace Tinned
             // nested map. The key of the outermost map is (un)perturbed
             // generalized overlap distributions, whose value is
             // `ExcContractionMap`.
-            inline VxcContractionMap get_potential_map() const
+            inline const VxcContractionMap& get_potential_map() const noexcept
             {
-                return extract_potential_map(potential_);
+                return potential_map_;
             }
     };
 
@@ -0,0 +1,188 @@
+/* Tinned: a set of nonnumerical routines for computational chemistry
+   Copyright 2023-2024 Bin Gao
+
+   This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+   This file is the header file of symbolic frequencies of perturbations and
+   their numerical binding.
+
+   2026-10-18, Bin Gao:
+   * first version
+*/
+
+#pragma once
+
+#include <string>
+#include <type_traits>
+
+#include <symengine/basic.h>
+#include <symengine/add.h>
+#include <symengine/constants.h>
+#include <symengine/dict.h>
+#include <symengine/mul.h>
+#include <symengine/number.h>
+#include <symengine/pow.h>
+#include <symengine/symbol.h>
+#include <symengine/symengine_assert.h>
+#include <symengine/symengine_casts.h>
+#include <symengine/symengine_rcp.h>
+
+#include "Tinned/Perturbation.hpp"
+#include "Tinned/PertTuple.hpp"
+
+// Frequencies are part of the identity of `Perturbation` objects, so that an
+// expression derived for some frequencies cannot be reused for others. By
+// cleaning `TemporumOperator` objects with symbolic frequencies (see
+// "Tinned/TemporumCleaner.hpp"), the frequency factors become sums of
+// placeholders, and the derived expression serves as a template whose
+// numerical frequencies are bound at evaluation time by `FrequencyBinding`.
+namespace Tinned
+{
+    // Placeholder of the frequency of a perturbation, which is identified by
+    // the perturbation including its frequency and components. Perturbations
+    // with the same name but different frequencies, like the electric fields
+    // of frequencies w and 2w in second harmonic generation, therefore have
+    // different placeholders, although they are printed with the same name
+    // "omega_" followed by the name of the perturbation.
+    //
+    // Unlike other classes derived from SymEngine ones, placeholders have
+    // their own type code after all SymEngine ones. SymEngine compares type
+    // codes before calling `__eq__()` or `compare()` of either argument, so a
+    // placeholder never equals a `SymEngine::Symbol` or a `Perturbation` of
+    // the same name, whichever side the comparison is made from.
+    class FrequencyPlaceholder: public SymEngine::Symbol
+    {
+        protected:
+            SymEngine::RCP<const Perturbation> perturbation_;
+
+        public:
+            const static SymEngine::TypeID type_code_id = SymEngine::TypeID_Count;
+
+            explicit FrequencyPlaceholder(
+                const SymEngine::RCP<const Perturbation>& perturbation
+            );
+
+            SymEngine::hash_t __hash__() const override;
+            bool __eq__(const SymEngine::Basic& o) const override;
+            int compare(const SymEngine::Basic& o) const override;
+
+            inline SymEngine::RCP<const Perturbation> get_perturbation() const noexcept
+            {
+                return perturbation_;
+            }
+    };
+
+    // Helper function to make the frequency placeholder of a perturbation
+    inline SymEngine::RCP<const FrequencyPlaceholder> make_frequency_placeholder(
+        const SymEngine::RCP<const Perturbation>& perturbation
+    )
+    {
+        return SymEngine::make_rcp<const FrequencyPlaceholder>(perturbation);
+    }
+
+    // Sum of frequency placeholders of perturbations
+    template<typename T,
+             typename std::enable_if<std::is_same<T, PertTuple>::value ||
+                 std::is_same<T, SymEngine::multiset_basic>::value ||
+                 std::is_same<T, SymEngine::vec_basic>::value, int>::type = 0>
+    inline SymEngine::RCP<const SymEngine::Basic> get_frequency_placeholder_sum(
+        const T& perturbations
+    )
+    {
+        SymEngine::vec_basic placeholders;
+        for (const auto& p: perturbations) {
+            SYMENGINE_ASSERT(SymEngine::is_a_sub<const Perturbation>(*p))
+            placeholders.push_back(make_frequency_placeholder(
+                SymEngine::rcp_dynamic_cast<const Perturbation>(p)
+            ));
+        }
+        return placeholders.empty() ? SymEngine::zero : SymEngine::add(placeholders);
+    }
+
+    // Check if `x` is a number or an expression of frequency placeholders,
+    // other symbols are not accepted
+    inline bool is_frequency_expression(const SymEngine::Basic& x)
+    {
+        if (SymEngine::is_a_Number(x) || SymEngine::is_a_sub<const FrequencyPlaceholder>(x))
+            return true;
+        if (SymEngine::is_a<const SymEngine::Add>(x) ||
+            SymEngine::is_a<const SymEngine::Mul>(x) ||
+            SymEngine::is_a<const SymEngine::Pow>(x)) {
+            for (const auto& arg: x.get_args())
+                if (!is_frequency_expression(*arg)) return false;
+            return true;
+        }
+        return false;
+    }
+
+    // Numerical values of frequency placeholders
+    class FrequencyBinding
+    {
+        protected:
+            SymEngine::map_basic_basic frequencies_;
+
+        public:
+            FrequencyBinding() = default;
+
+            // Bind (or rebind) the frequency of a perturbation, which should
+            // be the perturbation (including its frequency) found in the
+            // expression to evaluate
+            void bind(
+                const SymEngine::RCP<const Perturbation>& perturbation,
+                const SymEngine::RCP<const SymEngine::Number>& frequency
+            );
+
+            // Bind the frequency of a perturbation to its own frequency
+            inline void bind(const SymEngine::RCP<const Perturbation>& perturbation)
+            {
+                bind(perturbation, perturbation->get_frequency());
+            }
+
+            // Get the bound frequency of a perturbation, or its own frequency
+            // if it is not bound
+            SymEngine::RCP<const SymEngine::Number> get_frequency(
+                const SymEngine::RCP<const Perturbation>& perturbation
+            ) const;
+
+            // Sum of frequencies of perturbations, where bound frequencies
+            // are used for perturbations bound
+            template<typename T,
+                     typename std::enable_if<std::is_same<T, PertTuple>::value ||
+                         std::is_same<T, SymEngine::multiset_basic>::value ||
+                         std::is_same<T, SymEngine::vec_basic>::value, int>::type = 0>
+            inline SymEngine::RCP<const SymEngine::Number> get_frequency_sum(
+                const T& perturbations
+            ) const
+            {
+                SymEngine::RCP<const SymEngine::Number> result = SymEngine::zero;
+                for (const auto& p: perturbations) {
+                    SYMENGINE_ASSERT(SymEngine::is_a_sub<const Perturbation>(*p))
+                    result = SymEngine::addnum(result, get_frequency(
+                        SymEngine::rcp_dynamic_cast<const Perturbation>(p)
+                    ));
+                }
+                return result;
+            }
+
+            inline bool empty() const noexcept
+            {
+                return frequencies_.empty();
+            }
+
+            inline void clear() noexcept
+            {
+                frequencies_.clear();
+            }
+
+            // Substitute bound frequencies into `x`, and return the numerical
+            // result, or a null pointer if `x` is not an expression of
+            // frequency placeholders or does not become a number
+            SymEngine::RCP<const SymEngine::Number> apply(
+                const SymEngine::RCP<const SymEngine::Basic>& x
+            ) const;
+
+            ~FrequencyBinding() = default;
+    };
+}
@@ -7,6 +7,18 @@
 
    This file is the header file of function evaluator.
 
+   2026-10-18, Bin Gao:
+   * add `get_component_layout()` for callbacks to evaluate all components
+     of perturbation-strength derivatives in one call;
+   * evaluate traces of matrix multiplications by `eval_trace_product()`
+     without forming the products, and distribute traces over matrix
+     additions;
+   * fix the derivatives and result of addition being overwritten by the
+     evaluation of its arguments;
+   * profile callbacks when `TINNED_ENABLE_PROFILING` is defined;
+   * bind numerical frequencies to frequency placeholders by
+     `set_frequency_binding()`.
+
    2024-06-14, Bin Gao:
    * add member variable `derivatives_` to hold derivatives of symbols to
      evaluate so that users can, for example, consider only interesting
@@ -20,6 +32,7 @@
 
 #include <cstddef>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include <symengine/basic.h>
@@ -29,6 +42,8 @@
 #include <symengine/functions.h>
 #include <symengine/mul.h>
 #include <symengine/number.h>
+#include <symengine/matrices/matrix_add.h>
+#include <symengine/matrices/matrix_mul.h>
 #include <symengine/matrices/trace.h>
 #include <symengine/symengine_casts.h>
 #include <symengine/symengine_exception.h>
@@ -38,8 +53,10 @@
 #include "Tinned/TwoElecEnergy.hpp"
 #include "Tinned/ExchCorrEnergy.hpp"
 #include "Tinned/NonElecFunction.hpp"
+#include "Tinned/ComponentLayout.hpp"
 #include "Tinned/StringifyVisitor.hpp"
 #include "Tinned/OperatorEvaluator.hpp"
+#include "Tinned/Profiler.hpp"
 
 namespace Tinned
 {
@@ -102,6 +119,116 @@ namespace Tinned
                 );
             }
 
+            // return the trace of `A` * `B`, the default implementation
+            // calls `OperatorEvaluator::eval_oper_multiplication()` and
+            // `eval_trace()`, and could be overridden to compute only the
+            // diagonal elements of the product
+            virtual FunctionType eval_trace_product(
+                const OperatorType& A, const OperatorType& B
+            )
+            {
+                return eval_trace(oper_evaluator_->eval_oper_multiplication(A, B));
+            }
+
+            // Layout of components of the derivatives of the leaf being
+            // evaluated, so that leaf callbacks like `eval_nonel_function()` can
+            // evaluate all components as a batch. Only leaf callbacks may use
+            // it, see "Tinned/ComponentLayout.hpp" for combining batches.
+            inline ComponentLayout get_component_layout() const
+            {
+                if (derivatives_.empty()) throw SymEngine::SymEngineException(
+                    "FunctionEvaluator::get_component_layout() called without derivatives"
+                );
+                return ComponentLayout(derivatives_.back());
+            }
+
+            // Arguments of `Add` and of `MatrixAdd` in a trace should have
+            // the same derivative, and we keep only the derivative of the
+            // first argument, which represents the derivative of `x`
+            inline void check_add_derivative(const SymEngine::Basic& x)
+            {
+                if (SymEngine::unified_eq(
+                    derivatives_.back(), derivatives_[derivatives_.size()-2]
+                )) {
+                    derivatives_.pop_back();
+                }
+                else {
+                    throw SymEngine::NotImplementedError(
+                        SymEngine::is_a<const SymEngine::MatrixAdd>(x)
+                        ? "FunctionEvaluator::bvisit() got invalid MatrixAdd in trace "
+                          + stringify(x)
+                        : "FunctionEvaluator::bvisit() got invalid Add "
+                          + stringify(x)
+                    );
+                }
+            }
+
+            // Evaluate an operator and push its derivative
+            inline OperatorType apply_operator(
+                const SymEngine::RCP<const SymEngine::Basic>& A
+            )
+            {
+                auto val = oper_evaluator_->apply(A);
+                SymEngine::multiset_basic derivative;
+                for (const auto& oper_derivative: oper_evaluator_->get_derivatives())
+                    derivative.insert(oper_derivative.begin(), oper_derivative.end());
+                derivatives_.push_back(derivative);
+                return val;
+            }
+
+            // Evaluate the trace of `A`, where the traces of matrix
+            // multiplications are computed by `eval_trace_product()` and the
+            // trace of a matrix addition is distributed over its arguments
+            inline FunctionType eval_trace_(const SymEngine::RCP<const SymEngine::Basic>& A)
+            {
+                if (SymEngine::is_a<const SymEngine::MatrixAdd>(*A)) {
+                    auto args = SymEngine::down_cast<const SymEngine::MatrixAdd&>(*A).get_args();
+                    auto sum = eval_trace_(args[0]);
+                    for (std::size_t i=1; i<args.size(); ++i) {
+                        auto val = eval_trace_(args[i]);
+                        check_add_derivative(*A);
+                        TINNED_PROFILE_SCOPE("FunctionEvaluator::eval_fun_addition");
+                        eval_fun_addition(sum, val);
+                    }
+                    return sum;
+                }
+                else if (SymEngine::is_a<const SymEngine::MatrixMul>(*A)) {
+                    auto& op = SymEngine::down_cast<const SymEngine::MatrixMul&>(*A);
+                    auto factors = op.get_factors();
+                    if (factors.size()>1) {
+                        auto scalar = oper_evaluator_->get_mul_scalar(op);
+                        // tr(c*F_1*...*F_{n-1}*F_n) = c*tr((F_1*...*F_{n-1})*F_n),
+                        // where the left factors are evaluated directly by
+                        // the operator evaluator
+                        oper_evaluator_->derivatives_.clear();
+                        auto val0 = oper_evaluator_->eval_mul_factors(
+                            factors, factors.size()-1
+                        );
+                        auto val1 = oper_evaluator_->apply_(factors.back());
+                        oper_evaluator_->update_mul_derivative();
+                        derivatives_.push_back(oper_evaluator_->derivatives_.back());
+                        TINNED_PROFILE_SCOPE("FunctionEvaluator::eval_trace_product");
+                        auto val = eval_trace_product(val0, val1);
+                        if (SymEngine::neq(*scalar, *SymEngine::one)) {
+                            TINNED_PROFILE_SCOPE("FunctionEvaluator::eval_fun_scale");
+                            eval_fun_scale(scalar, val);
+                        }
+                        return val;
+                    }
+                }
+                auto val = apply_operator(A);
+                TINNED_PROFILE_SCOPE("FunctionEvaluator::eval_trace");
+                return eval_trace(val);
+            }
+
+            // Method called by objects to process their argument(s), which
+            // does not clear the derivatives of visited symbols
+            inline FunctionType apply_(const SymEngine::RCP<const SymEngine::Basic>& x)
+            {
+                x->accept(*this);
+                return std::move(result_);
+            }
+
         public:
             explicit FunctionEvaluator(
                 const std::shared_ptr<OperatorEvaluator<OperatorType>>& operEvaluator
@@ -110,8 +237,14 @@ namespace Tinned
             inline FunctionType apply(const SymEngine::RCP<const SymEngine::Basic>& x)
             {
                 derivatives_.clear();
-                x->accept(*this);
-                return result_;
+                return apply_(x);
+            }
+
+            // Set numerical frequencies for expressions with frequency
+            // placeholders, which are used by the operator evaluator as well
+            inline void set_frequency_binding(const FrequencyBinding& binding)
+            {
+                oper_evaluator_->set_frequency_binding(binding);
             }
 
             void bvisit(const SymEngine::Basic& x)
@@ -124,25 +257,14 @@ namespace Tinned
             void bvisit(const SymEngine::Add& x)
             {
                 auto args = x.get_args();
-                result_ = apply(args[0]);
+                auto sum = apply_(args[0]);
                 for (std::size_t i=1; i<args.size(); ++i) {
-                    auto val = apply(args[i]);
-                    // Arguments of `Add` should have the same derivative
-                    if (SymEngine::unified_eq(
-                        derivatives_.back(), derivatives_[derivatives_.size()-2]
-                    )) {
-                        eval_fun_addition(result_, val);
-                        // We keep only the derivative of the first argument,
-                        // which represents the derivative of `Add`
-                        derivatives_.pop_back();
-                    }
-                    else {
-                        throw SymEngine::NotImplementedError(
-                            "FunctionEvaluator::bvisit() got invalid Add "
-                            + stringify(x)
-                        );
-                    }
+                    auto val = apply_(args[i]);
+                    check_add_derivative(x);
+                    TINNED_PROFILE_SCOPE("FunctionEvaluator::eval_fun_addition");
+                    eval_fun_addition(sum, val);
                 }
+                result_ = std::move(sum);
             }
 
             void bvisit(const SymEngine::Mul& x)
@@ -150,11 +272,10 @@ namespace Tinned
                 SymEngine::RCP<const SymEngine::Number> scalar = SymEngine::one;
                 unsigned int num_non_numbers = 0;
                 for (auto const& arg: x.get_args()) {
-                    if (SymEngine::is_a_Number(*arg)) {
-                        scalar = SymEngine::mulnum(
-                            scalar,
-                            SymEngine::rcp_dynamic_cast<const SymEngine::Number>(arg)
-                        );
+                    // Numbers and expressions of bound frequencies
+                    auto number = oper_evaluator_->frequency_binding_.apply(arg);
+                    if (!number.is_null()) {
+                        scalar = SymEngine::mulnum(scalar, number);
                     }
                     else {
                         ++num_non_numbers;
@@ -167,12 +288,14 @@ namespace Tinned
                             );
                         }
                         else {
-                            result_ = apply(arg);
+                            result_ = apply_(arg);
                         }
                     }
                 }
-                if (SymEngine::neq(*scalar, *SymEngine::one))
+                if (SymEngine::neq(*scalar, *SymEngine::one)) {
+                    TINNED_PROFILE_SCOPE("FunctionEvaluator::eval_fun_scale");
                     eval_fun_scale(scalar, result_);
+                }
             }
 
             void bvisit(const SymEngine::FunctionSymbol& x)
@@ -180,6 +303,7 @@ namespace Tinned
                 if (SymEngine::is_a_sub<const NonElecFunction>(x)) {
                     auto& op = SymEngine::down_cast<const NonElecFunction&>(x);
                     derivatives_.push_back(op.get_derivatives());
+                    TINNED_PROFILE_SCOPE("FunctionEvaluator::eval_nonel_function");
                     result_ = eval_nonel_function(op);
                 }
                 else if (SymEngine::is_a_sub<const TwoElecEnergy>(x)) {
@@ -194,11 +318,13 @@ namespace Tinned
                         outer_derivatives.begin(), outer_derivatives.end()
                     );
                     derivatives_.push_back(op_derivatives);
+                    TINNED_PROFILE_SCOPE("FunctionEvaluator::eval_2el_energy");
                     result_ = eval_2el_energy(op);
                 }
                 else if (SymEngine::is_a_sub<const ExchCorrEnergy>(x)) {
                     auto& op = SymEngine::down_cast<const ExchCorrEnergy&>(x);
                     derivatives_.push_back(op.get_derivatives());
+                    TINNED_PROFILE_SCOPE("FunctionEvaluator::eval_xc_energy");
                     result_ = eval_xc_energy(op);
                 }
                 else {
@@ -211,12 +337,7 @@ namespace Tinned
 
             void bvisit(const SymEngine::Trace& x)
             {
-                auto arg = oper_evaluator_->apply(x.get_args()[0]);
-                auto oper_derivatives = oper_evaluator_->get_derivatives();
-                derivatives_.insert(
-                    derivatives_.end(), oper_derivatives.begin(), oper_derivatives.end()
-                );
-                result_ = eval_trace(arg);
+                result_ = eval_trace_(x.get_args()[0]);
             }
     };
 }
@@ -0,0 +1,299 @@
+/* Tinned: a set of nonnumerical routines for computational chemistry
+   Copyright 2023-2024 Bin Gao
+
+   This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+   This file is the header file of grid-batch evaluation of LDA XC energy
+   and potential contractions.
+
+   2026-10-18, Bin Gao:
+   * first version
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <map>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <symengine/eval_double.h>
+#include <symengine/symengine_exception.h>
+
+#include "Tinned/ElectronicState.hpp"
+#include "Tinned/OneElecOperator.hpp"
+#include "Tinned/NonElecFunction.hpp"
+#include "Tinned/XcGridPlan.hpp"
+
+namespace Tinned
+{
+    // Driver of the evaluation of XC energy and potential contractions of
+    // LDA functionals over grid batches. Host codes only implement
+    // kernels for a single grid batch, i.e. generalized density vectors,
+    // grid weights, XC functional derivatives and the integration of a
+    // generalized overlap distribution. The driver walks an `XcGridPlan`
+    // for each batch, so that each generalized density vector, grid
+    // weight and XC functional derivative is computed once per batch.
+    //
+    // Generalized density vectors and XC functional derivatives have one
+    // value per grid point, and contractions are products of these
+    // values, which is valid only for LDA functionals. GGA and higher
+    // functionals, whose density vectors carry gradient components and
+    // whose derivatives are tensors over these components, are not
+    // supported.
+    //
+    // Batches are distributed over threads, and contributions of batches
+    // are kept separately and summed in the order of batches after all
+    // threads finish, so that results do not depend on the number of
+    // threads. Kernels are called from different threads and should be
+    // thread-safe, and they get plain references of symbolic objects so
+    // that no reference counting of SymEngine objects happens in threads.
+    // Exceptions thrown by kernels in threads are rethrown on the calling
+    // thread after all threads finish.
+    template<typename OperatorType>
+    class LdaXcGridDriver
+    {
+        protected:
+            // Number of threads for evaluating grid batches
+            unsigned int num_threads_;
+
+            virtual std::size_t get_num_batches() const = 0;
+
+            // Called before threads start, for example, to set up data of
+            // symbolic objects in the plan that kernels will look up
+            virtual void prepare(const XcGridPlan& plan) {}
+
+            // Values of the generalized density vector tr(Omega*D) at points
+            // of a grid batch, one value per point
+            virtual std::vector<double> eval_density_vector(
+                const std::size_t idxBatch,
+                const ElectronicState& state,
+                const OneElecOperator& Omega
+            ) = 0;
+
+            // Values of (un)perturbed grid weights at points of a grid batch
+            virtual std::vector<double> eval_weight(
+                const std::size_t idxBatch,
+                const NonElecFunction& weight
+            ) = 0;
+
+            // Values of LDA XC functional derivative of `order` at points of
+            // a grid batch, with the given values of generalized density
+            // vector, one value per point
+            virtual std::vector<double> eval_exc_derivative(
+                const std::size_t idxBatch,
+                const unsigned int order,
+                const std::vector<double>& density
+            ) = 0;
+
+            // Integration \sum_{p}values_{p}*Omega_{p} over points of a grid
+            // batch
+            virtual OperatorType eval_overlap_integration(
+                const std::size_t idxBatch,
+                const OneElecOperator& Omega,
+                const std::vector<double>& values
+            )
+            {
+                throw SymEngine::NotImplementedError(
+                    "LdaXcGridDriver::eval_overlap_integration() is not implemented"
+                );
+            }
+
+            // Add `B` to `A`
+            virtual void eval_oper_addition(OperatorType& A, const OperatorType& B)
+            {
+                throw SymEngine::NotImplementedError(
+                    "LdaXcGridDriver::eval_oper_addition() is not implemented"
+                );
+            }
+
+            // Coefficients of products of generalized density vectors as
+            // double numbers, converted before threads start
+            inline std::vector<std::vector<double>> get_coefficients(
+                const XcGridPlan& plan
+            ) const
+            {
+                std::vector<std::vector<double>> result;
+                for (const auto& recipe: plan.get_recipes()) {
+                    std::vector<double> coefs;
+                    for (const auto& product: recipe.products)
+                        coefs.push_back(SymEngine::eval_double(*product.coef));
+                    result.push_back(std::move(coefs));
+                }
+                return result;
+            }
+
+            // Values of contractions w*exc^{(n)}*\sum{c*\prod{rho}} of all
+            // recipes at points of a grid batch
+            inline std::vector<std::vector<double>> eval_contractions(
+                const std::size_t idxBatch,
+                const XcGridPlan& plan,
+                const std::vector<std::vector<double>>& coefficients
+            )
+            {
+                const auto& table = plan.get_density_table();
+                std::vector<std::vector<double>> densities;
+                for (const auto& rho: table.get_density_vectors())
+                    densities.push_back(eval_density_vector(
+                        idxBatch,
+                        *table.get_states()[rho.second],
+                        *table.get_overlap_distributions()[rho.first]
+                    ));
+                std::vector<std::vector<double>> weights;
+                for (const auto& weight: plan.get_weights())
+                    weights.push_back(eval_weight(idxBatch, *weight));
+                // XC functional derivatives by their orders and generalized
+                // density vectors
+                std::map<std::pair<unsigned int, std::size_t>, std::vector<double>> exc_values;
+                std::vector<std::vector<double>> result;
+                const auto& recipes = plan.get_recipes();
+                for (std::size_t idx_recipe=0; idx_recipe<recipes.size(); ++idx_recipe) {
+                    const auto& recipe = recipes[idx_recipe];
+                    auto key = std::make_pair(recipe.exc_order, recipe.idx_exc_density);
+                    auto exc = exc_values.find(key);
+                    if (exc==exc_values.end())
+                        exc = exc_values.emplace(key, eval_exc_derivative(
+                            idxBatch, recipe.exc_order, densities[recipe.idx_exc_density]
+                        )).first;
+                    std::vector<double> values(weights[recipe.idx_weight]);
+                    for (std::size_t p=0; p<values.size(); ++p) values[p] *= exc->second[p];
+                    if (!recipe.products.empty()) {
+                        std::vector<double> sum(values.size(), 0.0);
+                        for (std::size_t k=0; k<recipe.products.size(); ++k) {
+                            std::vector<double> product(
+                                values.size(), coefficients[idx_recipe][k]
+                            );
+                            for (const auto& factor: recipe.products[k].factors) {
+                                const auto& rho = densities[factor.index];
+                                for (std::size_t p=0; p<product.size(); ++p)
+                                    for (unsigned int e=0; e<factor.exponent; ++e)
+                                        product[p] *= rho[p];
+                            }
+                            for (std::size_t p=0; p<sum.size(); ++p) sum[p] += product[p];
+                        }
+                        for (std::size_t p=0; p<values.size(); ++p) values[p] *= sum[p];
+                    }
+                    result.push_back(std::move(values));
+                }
+                return result;
+            }
+
+            // Evaluate `eval_batch` for all batches with a static
+            // distribution of batches over threads. A thread stops at the
+            // first exception, which is rethrown after all threads finish,
+            // the exception of the thread with the smallest index first.
+            template<typename Function>
+            inline void run_batches(const std::size_t numBatches, Function eval_batch)
+            {
+                const std::size_t num_threads = std::min(std::size_t(num_threads_), numBatches);
+                if (num_threads>1) {
+                    std::vector<std::exception_ptr> errors(num_threads);
+                    auto eval_thread = [&](const std::size_t idx_thread)
+                    {
+                        try {
+                            for (std::size_t b=idx_thread; b<numBatches; b+=num_threads)
+                                eval_batch(b);
+                        }
+                        catch (...) {
+                            errors[idx_thread] = std::current_exception();
+                        }
+                    };
+                    std::vector<std::thread> threads;
+                    for (std::size_t t=1; t<num_threads; ++t)
+                        threads.push_back(std::thread(eval_thread, t));
+                    eval_thread(0);
+                    for (auto& thread: threads) thread.join();
+                    for (const auto& error: errors)
+                        if (error) std::rethrow_exception(error);
+                }
+                else {
+                    for (std::size_t b=0; b<numBatches; ++b) eval_batch(b);
+                }
+            }
+
+        public:
+            // `numThreads` as zero means the number of hardware threads
+            explicit LdaXcGridDriver(const unsigned int numThreads = 0):
+                num_threads_(numThreads>0
+                    ? numThreads : std::max(1u, std::thread::hardware_concurrency())) {}
+
+            // Evaluate XC energy or its derivatives given by a plan from an
+            // `ExcContractionMap`
+            inline double eval_energy(const XcGridPlan& plan)
+            {
+                for (const auto& recipe: plan.get_recipes())
+                    if (recipe.idx_overlap!=XcGridPlan::npos)
+                        throw SymEngine::SymEngineException(
+                            "LdaXcGridDriver::eval_energy() gets a plan of XC potential"
+                        );
+                prepare(plan);
+                const auto num_batches = get_num_batches();
+                const auto coefficients = get_coefficients(plan);
+                std::vector<double> batch_energies(num_batches, 0.0);
+                run_batches(num_batches, [&](const std::size_t idx_batch)
+                {
+                    double energy = 0.0;
+                    for (const auto& values: eval_contractions(idx_batch, plan, coefficients))
+                        for (const auto& val: values) energy += val;
+                    batch_energies[idx_batch] = energy;
+                });
+                double result = 0.0;
+                for (const auto& energy: batch_energies) result += energy;
+                return result;
+            }
+
+            // Evaluate XC potential operator or its derivatives given by a
+            // plan from a `VxcContractionMap`
+            inline OperatorType eval_potential(const XcGridPlan& plan)
+            {
+                const auto num_batches = get_num_batches();
+                if (num_batches==0 || plan.get_recipes().empty())
+                    throw SymEngine::SymEngineException(
+                        "LdaXcGridDriver::eval_potential() gets no grid batch or contraction"
+                    );
+                for (const auto& recipe: plan.get_recipes())
+                    if (recipe.idx_overlap==XcGridPlan::npos)
+                        throw SymEngine::SymEngineException(
+                            "LdaXcGridDriver::eval_potential() gets a plan of XC energy"
+                        );
+                prepare(plan);
+                const auto coefficients = get_coefficients(plan);
+                const auto& overlaps = plan.get_overlap_distributions();
+                std::vector<std::vector<OperatorType>> batch_potentials(num_batches);
+                run_batches(num_batches, [&](const std::size_t idx_batch)
+                {
+                    auto contractions = eval_contractions(idx_batch, plan, coefficients);
+                    // Sum of contractions for each generalized overlap
+                    // distribution
+                    std::map<std::size_t, std::vector<double>> values;
+                    const auto& recipes = plan.get_recipes();
+                    for (std::size_t i=0; i<recipes.size(); ++i) {
+                        auto val = values.find(recipes[i].idx_overlap);
+                        if (val==values.end()) {
+                            values.emplace(recipes[i].idx_overlap, std::move(contractions[i]));
+                        }
+                        else {
+                            for (std::size_t p=0; p<val->second.size(); ++p)
+                                val->second[p] += contractions[i][p];
+                        }
+                    }
+                    for (const auto& val: values)
+                        batch_potentials[idx_batch].push_back(eval_overlap_integration(
+                            idx_batch, *overlaps[val.first], val.second
+                        ));
+                });
+                OperatorType result = batch_potentials[0][0];
+                for (std::size_t b=0; b<num_batches; ++b)
+                    for (std::size_t k=(b==0 ? 1 : 0); k<batch_potentials[b].size(); ++k)
+                        eval_oper_addition(result, batch_potentials[b][k]);
+                return result;
+            }
+
+            virtual ~LdaXcGridDriver() noexcept = default;
+    };
+}
@@ -0,0 +1,136 @@
+/* Tinned: a set of nonnumerical routines for computational chemistry
+   Copyright 2023-2024 Bin Gao
+
+   This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+   This file is the header file of listing leaves of an expression that
+   evaluators will request.
+
+   2026-10-18, Bin Gao:
+   * first version
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <symengine/basic.h>
+#include <symengine/add.h>
+#include <symengine/constants.h>
+#include <symengine/dict.h>
+#include <symengine/functions.h>
+#include <symengine/mul.h>
+#include <symengine/number.h>
+#include <symengine/symbol.h>
+#include <symengine/matrices/conjugate_matrix.h>
+#include <symengine/matrices/matrix_add.h>
+#include <symengine/matrices/matrix_derivative.h>
+#include <symengine/matrices/matrix_mul.h>
+#include <symengine/matrices/matrix_symbol.h>
+#include <symengine/matrices/trace.h>
+#include <symengine/matrices/transpose.h>
+#include <symengine/matrices/zero_matrix.h>
+#include <symengine/symengine_rcp.h>
+#include <symengine/visitor.h>
+
+namespace Tinned
+{
+    // A leaf and the number of its occurrences in an expression
+    struct ManifestLeaf
+    {
+        SymEngine::RCP<const SymEngine::Basic> leaf;
+        std::size_t count;
+    };
+
+    // Kinds of leaves, named after their classes
+    enum class LeafKind
+    {
+        OneElecOperator,
+        TwoElecOperator,
+        ExchCorrEnergy,
+        ExchCorrPotential,
+        NonElecFunction,
+        TemporumOverlap
+    };
+
+    // Leaves grouped by their kinds and the names of their base operators or
+    // functions, and then by their orders of derivatives. Kinds are needed
+    // because leaves of different kinds may share a name, for example, an
+    // XC energy and an XC potential of a same functional.
+    typedef std::map<std::pair<LeafKind, std::string>,
+                     std::map<std::size_t, std::vector<ManifestLeaf>>> LeafManifest;
+
+    // Dry run of evaluators, which lists the distinct leaves that operator
+    // and function evaluators will request, so that hosts can compute them
+    // in bulk before the evaluation, for example, all geometric first order
+    // derivatives of the overlap integrals in one integral pass.
+    //
+    // Leaves are objects of `OneElecOperator`, `TwoElecOperator` (including
+    // those of `TwoElecEnergy`), `ExchCorrEnergy`, `ExchCorrPotential`,
+    // `NonElecFunction` and `TemporumOverlap`. The order of derivatives of a
+    // `TwoElecOperator` object includes the derivatives of its electronic
+    // state. Response parameters are not leaves, and targets of
+    // `TemporumOperator` objects are visited.
+    class ManifestVisitor: public SymEngine::BaseVisitor<ManifestVisitor>
+    {
+        protected:
+            // Leaves in the order of their first occurrences
+            SymEngine::vec_basic leaves_;
+            std::map<SymEngine::RCP<const SymEngine::Basic>,
+                     std::size_t,
+                     SymEngine::RCPBasicKeyLess> counts_;
+
+            // Add a leaf or increase its count
+            inline void add_leaf(const SymEngine::RCP<const SymEngine::Basic>& x)
+            {
+                auto iter = counts_.find(x);
+                if (iter==counts_.end()) {
+                    counts_.emplace(x, 1);
+                    leaves_.push_back(x);
+                }
+                else {
+                    ++iter->second;
+                }
+            }
+
+            // Method called by objects to process their argument(s)
+            inline void apply_(const SymEngine::RCP<const SymEngine::Basic>& x)
+            {
+                x->accept(*this);
+            }
+
+        public:
+            explicit ManifestVisitor() = default;
+
+            LeafManifest apply(const SymEngine::RCP<const SymEngine::Basic>& x);
+
+            void bvisit(const SymEngine::Basic& x);
+            void bvisit(const SymEngine::Symbol& x);
+            void bvisit(const SymEngine::Number& x);
+            void bvisit(const SymEngine::Add& x);
+            void bvisit(const SymEngine::Mul& x);
+            void bvisit(const SymEngine::Constant& x);
+            void bvisit(const SymEngine::FunctionSymbol& x);
+            void bvisit(const SymEngine::ZeroMatrix& x);
+            void bvisit(const SymEngine::MatrixSymbol& x);
+            void bvisit(const SymEngine::Trace& x);
+            void bvisit(const SymEngine::ConjugateMatrix& x);
+            void bvisit(const SymEngine::Transpose& x);
+            void bvisit(const SymEngine::MatrixAdd& x);
+            void bvisit(const SymEngine::MatrixMul& x);
+            void bvisit(const SymEngine::MatrixDerivative& x);
+    };
+
+    // Helper function to list leaves of `x` that evaluators will request
+    inline LeafManifest make_manifest(const SymEngine::RCP<const SymEngine::Basic>& x)
+    {
+        ManifestVisitor visitor;
+        return visitor.apply(x);
+    }
+}
@@ -0,0 +1,147 @@
+/* Tinned: a set of nonnumerical routines for computational chemistry
+   Copyright 2023-2024 Bin Gao
+
+   This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+   This file is the header file of N-level atom system.
+
+   2026-10-18, Bin Gao:
+   * first version
+*/
+
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <symengine/basic.h>
+#include <symengine/dict.h>
+#include <symengine/symengine_rcp.h>
+
+#include "Tinned/PertTuple.hpp"
+#include "Tinned/OneElecDensity.hpp"
+#include "Tinned/OneElecOperator.hpp"
+#include "Tinned/DenseMatrix.hpp"
+#include "Tinned/DenseEvaluator.hpp"
+
+// Numerical generalization of the two-level atom system in
+// "Tinned/TwoLevelAtom.hpp" to N levels. The unperturbed Hamiltonian is
+// diagonal with energies E_i, and each external field operator V_x couples to
+// one perturbation x. For a multiset of perturbations S, the density matrix
+// derivative satisfies
+//
+//   (w_S-W_ij) rho^{S}_ij = \sum_{x in S} n_x [V_x, rho^{S\x}]_ij,
+//
+// where the sum runs over distinct perturbations x with multiplicity n_x in
+// S, w_S is the sum of frequencies of S, and W_ij = E_i-E_j. Frequencies
+// bound by `set_frequency_binding()` replace those of the perturbations.
+//
+// Elements with w_S = W_ij, for example diagonal ones of static fields, are
+// not determined by the above equation. For a diagonal unperturbed density
+// matrix with occupation numbers n_i, they are instead obtained from the
+// idempotency rho = rho*rho,
+//
+//   (1-n_i-n_j) rho^{S}_ij = \sum_{A} c_A (rho^{A}*rho^{S\A})_ij,
+//
+// where A runs over proper non-empty sub-multisets of S and c_A is the
+// product of binomial coefficients of multiplicities of A in S. An exception
+// is thrown for resonances not determined in this way.
+namespace Tinned
+{
+    // Map of density matrix derivatives
+    typedef std::unordered_map<SymEngine::multiset_basic,
+                               DenseMatrix,
+                               PertMultisetHash,
+                               PertMultisetEq> DensityDerivativeMap;
+
+    class NLevelFrequencyScan;
+
+    // Evaluator for different (electron) operators of N-level atom system
+    class NLevelOperator: public DenseOperatorEvaluator
+    {
+        friend class NLevelFrequencyScan;
+
+        protected:
+            // Unperturbed Hamiltonian and its value
+            std::pair<SymEngine::RCP<const OneElecOperator>, DenseMatrix> H0_;
+            // Density matrix and the value of unperturbed one
+            std::pair<SymEngine::RCP<const OneElecDensity>, DenseMatrix> rho0_;
+            // External field's operators and their values, each operator
+            // should depend only on one unique perturbation
+            std::map<SymEngine::RCP<const OneElecOperator>,
+                     DenseMatrix,
+                     SymEngine::RCPBasicKeyLess> V_;
+            // Values of field operators and their indices by perturbations
+            std::vector<DenseMatrix> field_values_;
+            std::unordered_map<SymEngine::RCP<const SymEngine::Basic>,
+                               std::size_t,
+                               SymEngine::RCPBasicHash,
+                               SymEngine::RCPBasicKeyEq> field_indices_;
+            // Transition angular frequencies W_ij = E_i-E_j
+            DenseMatrix omega_;
+            // Occupation numbers of levels, empty if the unperturbed density
+            // matrix isn't diagonal
+            std::vector<double> occupations_;
+            // Number of threads for computing density matrix derivatives of
+            // the same order
+            unsigned int num_threads_;
+            // Cached density matrix derivatives
+            DensityDerivativeMap rho_derivatives_;
+
+            // Compute (if not cached) the density matrix derivative and all
+            // its lower order derivatives, and return the derivative
+            const DenseMatrix& get_rho_derivative(
+                const SymEngine::multiset_basic& derivatives
+            );
+
+            DenseMatrix eval_1el_density(const OneElecDensity& x) override;
+            DenseMatrix eval_1el_operator(const OneElecOperator& x) override;
+
+        public:
+            // Cached density matrix derivatives are dropped, because they
+            // depend on (bound) frequencies
+            void set_frequency_binding(const FrequencyBinding& binding) override;
+
+            // `numThreads` as zero means the number of hardware threads
+            explicit NLevelOperator(
+                const std::pair<SymEngine::RCP<const OneElecOperator>, DenseMatrix>& H0,
+                const std::map<SymEngine::RCP<const OneElecOperator>,
+                               DenseMatrix,
+                               SymEngine::RCPBasicKeyLess>& V,
+                const std::pair<SymEngine::RCP<const OneElecDensity>, DenseMatrix>& rho0,
+                const unsigned int numThreads = 0
+            );
+
+            // Get cached density matrix derivatives
+            inline const DensityDerivativeMap& get_rho_derivatives() const noexcept
+            {
+                return rho_derivatives_;
+            }
+
+            ~NLevelOperator() = default;
+    };
+
+    // Evaluator for different expectation values of N-level atom system
+    class NLevelFunction: public DenseFunctionEvaluator
+    {
+        public:
+            explicit NLevelFunction(
+                const std::pair<SymEngine::RCP<const OneElecOperator>, DenseMatrix>& H0,
+                const std::map<SymEngine::RCP<const OneElecOperator>,
+                               DenseMatrix,
+                               SymEngine::RCPBasicKeyLess>& V,
+                const std::pair<SymEngine::RCP<const OneElecDensity>, DenseMatrix>& rho0,
+                const unsigned int numThreads = 0
+            ): DenseFunctionEvaluator(
+                   std::make_shared<NLevelOperator>(H0, V, rho0, numThreads)
+               ) {}
+
+            ~NLevelFunction() = default;
+    };
+}
@@ -0,0 +1,92 @@
+/* Tinned: a set of nonnumerical routines for computational chemistry
+   Copyright 2023-2024 Bin Gao
+
+   This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+   This file is the header file of frequency scan of N-level atom system.
+
+   2026-10-18, Bin Gao:
+   * first version
+*/
+
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include <symengine/basic.h>
+#include <symengine/symengine_rcp.h>
+
+#include "Tinned/DenseMatrix.hpp"
+#include "Tinned/NLevelAtom.hpp"
+
+// Frequency scan of density matrix derivatives of an N-level atom system.
+// Instead of evaluating the recursion in "Tinned/NLevelAtom.hpp" once per
+// frequency with new `Perturbation` objects, all frequency points are swept
+// together. Values at different points are stored as separate real and
+// imaginary arrays, with the frequency point as the fastest running index,
+// so that commutators and the divisions by (w_S-W_ij) are simple loops
+// over contiguous arrays that compilers can vectorize. Resonant elements
+// (w_S = W_ij) are determined by the idempotency as in `NLevelOperator`.
+namespace Tinned
+{
+    class NLevelFrequencyScan
+    {
+        protected:
+            // Unperturbed density matrix, field operators and their indices
+            // by perturbations, transition angular frequencies and occupation
+            // numbers from the N-level atom system
+            DenseMatrix rho0_;
+            std::vector<DenseMatrix> field_values_;
+            std::unordered_map<SymEngine::RCP<const SymEngine::Basic>,
+                               std::size_t,
+                               SymEngine::RCPBasicHash,
+                               SymEngine::RCPBasicKeyEq> field_indices_;
+            DenseMatrix omega_;
+            std::vector<double> occupations_;
+            // Number of frequency points of the last scan
+            std::size_t num_points_;
+            // Real and imaginary parts of density matrix derivatives of the
+            // last scan, indexed by subsets (as bit masks) of the scanned
+            // perturbations, and each one is stored as [i*N+j][point]
+            std::vector<std::vector<double>> rho_real_;
+            std::vector<std::vector<double>> rho_imag_;
+
+        public:
+            explicit NLevelFrequencyScan(const NLevelOperator& system):
+                rho0_(system.rho0_.second),
+                field_values_(system.field_values_),
+                field_indices_(system.field_indices_),
+                omega_(system.omega_),
+                occupations_(system.occupations_),
+                num_points_(0) {}
+
+            // Compute density matrix derivatives with respect to
+            // `perturbations` for all frequency points, where
+            // `frequencies[k]` holds the frequencies of the `k`th
+            // perturbation at different points. Frequencies of
+            // `perturbations` themselves are not used.
+            void scan(
+                const SymEngine::vec_basic& perturbations,
+                const std::vector<std::vector<std::complex<double>>>& frequencies
+            );
+
+            inline std::size_t get_num_points() const noexcept
+            {
+                return num_points_;
+            }
+
+            // Get the density matrix derivative with respect to all scanned
+            // perturbations at a frequency point
+            DenseMatrix get_rho_derivative(const std::size_t idxPoint) const;
+
+            // Get response values tr(A*rho^{S}) at all frequency points
+            std::vector<std::complex<double>> get_response(const DenseMatrix& A) const;
+
+            ~NLevelFrequencyScan() = default;
+    };
+}
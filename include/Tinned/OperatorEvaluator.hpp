@@ -7,6 +7,25 @@
 
    This file is the header file of operator evaluator.
 
+   2026-10-18, Bin Gao:
+   * add `get_frequency_value()` for numerical frequency factors of
+     `TemporumOperator` objects;
+   * add `get_component_layout()` for callbacks to evaluate all components
+     of perturbation-strength derivatives in one call;
+   * add fused callbacks `eval_oper_gemm()` and `eval_oper_axpy()` used for
+     terms of matrix addition, so that operators can accumulate scaled
+     products without temporaries;
+   * fix the derivatives and result of matrix addition and multiplication
+     being overwritten by the evaluation of their arguments;
+   * release intermediate operators as soon as they have been consumed, and
+     evaluate with a bounded number of live operators planned by
+     `EvaluationPlanner`;
+   * profile callbacks when `TINNED_ENABLE_PROFILING` is defined;
+   * bind numerical frequencies to frequency placeholders by
+     `set_frequency_binding()`, which are also used for the frequency
+     factors of `TemporumOverlap` objects and sums of perturbation
+     frequencies requested by callbacks.
+
    2024-06-14, Bin Gao:
    * add member variable `derivatives_` to hold derivatives of symbols to
      evaluate so that users can, for example, consider only interesting
@@ -18,11 +37,17 @@
 
 #pragma once
 
+#include <complex>
 #include <cstddef>
+#include <string>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #include <symengine/basic.h>
 #include <symengine/constants.h>
+#include <symengine/eval_double.h>
+#include <symengine/integer.h>
 #include <symengine/number.h>
 #include <symengine/matrices/conjugate_matrix.h>
 #include <symengine/matrices/matrix_add.h>
@@ -46,19 +71,56 @@
 //#include "Tinned/AdjointMap.hpp"
 //#include "Tinned/ClusterConjHamiltonian.hpp"
 
+#include "Tinned/ComponentLayout.hpp"
 #include "Tinned/StringifyVisitor.hpp"
+#include "Tinned/EvaluationPlanner.hpp"
+#include "Tinned/FrequencyBinding.hpp"
+#include "Tinned/Profiler.hpp"
 
 namespace Tinned
 {
+    template<typename FunctionType, typename OperatorType> class FunctionEvaluator;
+
     template<typename OperatorType>
     class OperatorEvaluator: public SymEngine::BaseVisitor<OperatorEvaluator<OperatorType>>
     {
+        // Function evaluator uses operator multiplication for traces of
+        // products
+        template<typename FunctionType, typename T> friend class FunctionEvaluator;
+
         protected:
             // Each symbol adds its derivative to the end of the vector, and
             // its parent checks the validity of derivative and may remove it
             // when the child symbol has been evaluated.
             std::vector<SymEngine::multiset_basic> derivatives_;
             OperatorType result_;
+            // Evaluation order of matrix additions
+            EvaluationPlan plan_;
+            // Numerical frequencies of frequency placeholders
+            FrequencyBinding frequency_binding_;
+
+            // Set the evaluation plan within a scope, which is cleared when
+            // leaving the scope, including by exceptions from callbacks
+            class PlanScope
+            {
+                protected:
+                    EvaluationPlan& plan_;
+
+                public:
+                    explicit PlanScope(EvaluationPlan& plan, const EvaluationPlan& value):
+                        plan_(plan)
+                    {
+                        plan_ = value;
+                    }
+
+                    PlanScope(const PlanScope&) = delete;
+                    PlanScope& operator=(const PlanScope&) = delete;
+
+                    ~PlanScope()
+                    {
+                        plan_.clear();
+                    }
+            };
 
             virtual OperatorType eval_pert_parameter(const PerturbedParameter& x)
             {
@@ -162,6 +224,61 @@ namespace Tinned
                 );
             }
 
+            // C = C + alpha * A * B, the default implementation calls
+            // `eval_oper_multiplication()`, `eval_oper_scale()` and
+            // `eval_oper_addition()`, and could be overridden to avoid the
+            // temporary of the product
+            virtual void eval_oper_gemm(
+                OperatorType& C,
+                const SymEngine::RCP<const SymEngine::Number>& alpha,
+                const OperatorType& A,
+                const OperatorType& B
+            )
+            {
+                auto AB = eval_oper_multiplication(A, B);
+                if (SymEngine::neq(*alpha, *SymEngine::one)) eval_oper_scale(alpha, AB);
+                eval_oper_addition(C, AB);
+            }
+
+            // A = A + alpha * B, the default implementation calls
+            // `eval_oper_scale()` and `eval_oper_addition()`, and could be
+            // overridden to avoid the temporary of the scaled operator
+            virtual void eval_oper_axpy(
+                OperatorType& A,
+                const SymEngine::RCP<const SymEngine::Number>& alpha,
+                const OperatorType& B
+            )
+            {
+                if (SymEngine::eq(*alpha, *SymEngine::one)) {
+                    eval_oper_addition(A, B);
+                }
+                else {
+                    auto C = B;
+                    eval_oper_scale(alpha, C);
+                    eval_oper_addition(A, C);
+                }
+            }
+
+            // Whether `eval_oper_gemm()` and `eval_oper_axpy()` are overridden
+            // so that they work without temporaries, used for planning the
+            // evaluation
+            virtual bool has_fused_callbacks() const noexcept
+            {
+                return false;
+            }
+
+            // Layout of components of the derivatives of the leaf being
+            // evaluated, so that leaf callbacks like `eval_1el_operator()` can
+            // evaluate all components as a batch. Only leaf callbacks may use
+            // it, see "Tinned/ComponentLayout.hpp" for combining batches.
+            inline ComponentLayout get_component_layout() const
+            {
+                if (derivatives_.empty()) throw SymEngine::SymEngineException(
+                    "OperatorEvaluator::get_component_layout() called without derivatives"
+                );
+                return ComponentLayout(derivatives_.back());
+            }
+
             // Update the derivative of a multiplication
             inline void update_mul_derivative() noexcept
             {
@@ -172,14 +289,171 @@ namespace Tinned
                 derivatives_.back().insert(derivative.begin(), derivative.end());
             }
 
+            // Arguments of `MatrixAdd` should have the same derivative, and we
+            // keep only the derivative of the first argument, which
+            // represents the derivative of `MatrixAdd`
+            inline void check_add_derivative(const SymEngine::MatrixAdd& x)
+            {
+                if (SymEngine::unified_eq(
+                    derivatives_.back(), derivatives_[derivatives_.size()-2]
+                )) {
+                    derivatives_.pop_back();
+                }
+                else {
+                    throw SymEngine::NotImplementedError(
+                        "OperatorEvaluator::bvisit() got invalid MatrixAdd "
+                        + stringify(x)
+                    );
+                }
+            }
+
+            // Get the scalar of a matrix multiplication, which should be a
+            // number or become a number with bound frequencies
+            inline SymEngine::RCP<const SymEngine::Number> get_mul_scalar(
+                const SymEngine::MatrixMul& x
+            )
+            {
+                auto scalar = frequency_binding_.apply(x.get_scalar());
+                if (!scalar.is_null()) {
+                    return scalar;
+                }
+                else {
+                    throw SymEngine::NotImplementedError(
+                        "OperatorEvaluator::bvisit() not implemented for scalar "
+                        + stringify(x.get_scalar())
+                    );
+                }
+            }
+
+            // Evaluate the product of the first `num_factors` factors from
+            // left to right
+            inline OperatorType eval_mul_factors(
+                const SymEngine::vec_basic& factors,
+                const std::size_t num_factors
+            )
+            {
+                auto val = apply_(factors[0]);
+                for (std::size_t i=1; i<num_factors; ++i) {
+                    auto factor = apply_(factors[i]);
+                    TINNED_PROFILE_SCOPE("OperatorEvaluator::eval_oper_multiplication");
+                    val = eval_oper_multiplication(val, factor);
+                    update_mul_derivative();
+                }
+                return val;
+            }
+
+            // Method called by objects to process their argument(s), which
+            // does not clear the derivatives of visited symbols
+            inline OperatorType apply_(const SymEngine::RCP<const SymEngine::Basic>& x)
+            {
+                x->accept(*this);
+                // `result_` is moved out so that no extra operator stays alive
+                return std::move(result_);
+            }
+
         public:
             explicit OperatorEvaluator() = default;
 
             inline OperatorType apply(const SymEngine::RCP<const SymEngine::Basic>& x)
             {
                 derivatives_.clear();
-                x->accept(*this);
-                return result_;
+                return apply_(x);
+            }
+
+            // Set numerical frequencies for expressions with frequency
+            // placeholders, evaluators caching values that depend on
+            // frequencies should override it to drop those values
+            virtual void set_frequency_binding(const FrequencyBinding& binding)
+            {
+                frequency_binding_ = binding;
+            }
+
+            // Get the frequency factor of a `TemporumOperator` object, which
+            // uses bound frequencies of perturbations if available
+            inline SymEngine::RCP<const SymEngine::Number> get_frequency(
+                const TemporumOperator& x
+            ) const
+            {
+                if (frequency_binding_.empty()) return x.get_frequency();
+                auto frequency = frequency_binding_.get_frequency_sum(x.get_derivatives());
+                return x.get_type()==TemporumType::Bra
+                    ? SymEngine::subnum(SymEngine::zero, frequency) : frequency;
+            }
+
+            // Get the frequency factor of a `TemporumOperator` object as a
+            // complex double number, which uses the cached value of the object
+            // without bound frequencies
+            inline std::complex<double> get_frequency_value(const TemporumOperator& x) const
+            {
+                if (frequency_binding_.empty()) return x.get_frequency_value();
+                return SymEngine::eval_complex_double(*get_frequency(x));
+            }
+
+            // Get the frequency factor of the `index`th product of a
+            // `TemporumOverlap` object, which uses bound frequencies if
+            // available. Callback `eval_temporum_overlap()` should use it
+            // instead of `TemporumOverlap::get_frequency()`.
+            inline SymEngine::RCP<const SymEngine::Number> get_frequency(
+                const TemporumOverlap& x, const std::size_t index
+            ) const
+            {
+                if (frequency_binding_.empty()) return x.get_frequency(index);
+                auto term = x.get_braket_product(index);
+                return SymEngine::divnum(
+                    SymEngine::mulnum(
+                        SymEngine::addnum(
+                            get_frequency(*std::get<1>(term)),
+                            get_frequency(*std::get<2>(term))
+                        ),
+                        std::get<0>(term)
+                    ),
+                    SymEngine::integer(-2)
+                );
+            }
+
+            inline std::complex<double> get_frequency_value(
+                const TemporumOverlap& x, const std::size_t index
+            ) const
+            {
+                if (frequency_binding_.empty()) return x.get_frequency_value(index);
+                return SymEngine::eval_complex_double(*get_frequency(x, index));
+            }
+
+            // Get the sum of frequencies of perturbations as a complex double
+            // number, which uses bound frequencies of perturbations if
+            // available, for callbacks of leaves depending on frequencies
+            template<typename T>
+            inline std::complex<double> get_frequency_sum_value(const T& perturbations) const
+            {
+                if (frequency_binding_.empty())
+                    return Tinned::get_frequency_sum_value(perturbations);
+                return SymEngine::eval_complex_double(
+                    *frequency_binding_.get_frequency_sum(perturbations)
+                );
+            }
+
+            // Evaluate `x` in an order that the number of operators alive at
+            // the same time does not exceed `maxLiveOperators`. The only
+            // reordering is the choice of the argument evaluated first in
+            // each `MatrixAdd`, other arguments and factors keep their order.
+            // The budget counts operators, not bytes, because operators of
+            // different sizes are not distinguished.
+            inline OperatorType apply(
+                const SymEngine::RCP<const SymEngine::Basic>& x,
+                const std::size_t maxLiveOperators
+            )
+            {
+                EvaluationPlanner planner(has_fused_callbacks());
+                auto peak = planner.apply(x);
+                if (peak>maxLiveOperators) throw SymEngine::SymEngineException(
+                    "OperatorEvaluator::apply() needs at least "
+                    + std::to_string(peak)
+                    + " live operators for "
+                    + stringify(x)
+                );
+                PlanScope scope(plan_, planner.get_plan());
+                derivatives_.clear();
+                return apply_(x);
             }
 
             inline std::vector<SymEngine::multiset_basic> get_derivatives() const
@@ -199,20 +473,25 @@ namespace Tinned
                 if (SymEngine::is_a_sub<const PerturbedParameter>(x)) {
                     auto& op = SymEngine::down_cast<const PerturbedParameter&>(x);
                     derivatives_.push_back(op.get_derivatives());
+                    TINNED_PROFILE_SCOPE("OperatorEvaluator::eval_pert_parameter");
                     result_ = eval_pert_parameter(op);
                 }
                 else if (SymEngine::is_a_sub<const ConjugateTranspose>(x)) {
                     auto& op = SymEngine::down_cast<const ConjugateTranspose&>(x);
-                    result_ = eval_hermitian_transpose(apply(op.get_arg()));
+                    auto A = apply_(op.get_arg());
+                    TINNED_PROFILE_SCOPE("OperatorEvaluator::eval_hermitian_transpose");
+                    result_ = eval_hermitian_transpose(A);
                 }
                 else if (SymEngine::is_a_sub<const OneElecDensity>(x)) {
                     auto& op = SymEngine::down_cast<const OneElecDensity&>(x);
                     derivatives_.push_back(op.get_derivatives());
+                    TINNED_PROFILE_SCOPE("OperatorEvaluator::eval_1el_density");
                     result_ = eval_1el_density(op);
                 }
                 else if (SymEngine::is_a_sub<const OneElecOperator>(x)) {
                     auto& op = SymEngine::down_cast<const OneElecOperator&>(x);
                     derivatives_.push_back(op.get_derivatives());
+                    TINNED_PROFILE_SCOPE("OperatorEvaluator::eval_1el_operator");
                     result_ = eval_1el_operator(op);
                 }
                 else if (SymEngine::is_a_sub<const TwoElecOperator>(x)) {
@@ -223,21 +502,25 @@ namespace Tinned
                         state_derivatives.begin(), state_derivatives.end()
                     );
                     derivatives_.push_back(op_derivatives);
+                    TINNED_PROFILE_SCOPE("OperatorEvaluator::eval_2el_operator");
                     result_ = eval_2el_operator(op);
                 }
                 else if (SymEngine::is_a_sub<const ExchCorrPotential>(x)) {
                     auto& op = SymEngine::down_cast<const ExchCorrPotential&>(x);
                     derivatives_.push_back(op.get_derivatives());
+                    TINNED_PROFILE_SCOPE("OperatorEvaluator::eval_xc_potential");
                     result_ = eval_xc_potential(op);
                 }
                 else if (SymEngine::is_a_sub<const TemporumOperator>(x)) {
                     auto& op = SymEngine::down_cast<const TemporumOperator&>(x);
                     derivatives_.push_back(op.get_derivatives());
+                    TINNED_PROFILE_SCOPE("OperatorEvaluator::eval_temporum_operator");
                     result_ = eval_temporum_operator(op);
                 }
                 else if (SymEngine::is_a_sub<const TemporumOverlap>(x)) {
                     auto& op = SymEngine::down_cast<const TemporumOverlap&>(x);
                     derivatives_.push_back(op.get_derivatives());
+                    TINNED_PROFILE_SCOPE("OperatorEvaluator::eval_temporum_overlap");
                     result_ = eval_temporum_overlap(op);
                 }
                 else {
@@ -250,104 +533,70 @@ namespace Tinned
 
             void bvisit(const SymEngine::ConjugateMatrix& x)
             {
-                result_ = eval_conjugate_matrix(apply(x.get_arg()));
+                auto A = apply_(x.get_arg());
+                TINNED_PROFILE_SCOPE("OperatorEvaluator::eval_conjugate_matrix");
+                result_ = eval_conjugate_matrix(A);
             }
 
             void bvisit(const SymEngine::Transpose& x)
             {
-                result_ = eval_transpose(apply(x.get_arg()));
+                auto A = apply_(x.get_arg());
+                TINNED_PROFILE_SCOPE("OperatorEvaluator::eval_transpose");
+                result_ = eval_transpose(A);
             }
 
             void bvisit(const SymEngine::MatrixAdd& x)
             {
                 auto args = x.get_args();
-                result_ = apply(args[0]);
-                for (std::size_t i=1; i<args.size(); ++i) {
-                    auto val = apply(args[i]);
-                    // Arguments of `MatrixAdd` should have the same derivative
-                    if (SymEngine::unified_eq(
-                        derivatives_.back(), derivatives_[derivatives_.size()-2]
-                    )) {
-                        eval_oper_addition(result_, val);
-                        // We keep only the derivative of the first argument,
-                        // which represents the derivative of `MatrixAdd`
-                        derivatives_.pop_back();
+                // Argument evaluated first according to the plan
+                std::size_t first = 0;
+                if (!plan_.empty()) {
+                    auto iter = plan_.find(x.rcp_from_this());
+                    if (iter!=plan_.end()) first = iter->second;
+                }
+                auto sum = apply_(args[first]);
+                for (std::size_t i=0; i<args.size(); ++i) {
+                    if (i==first) continue;
+                    // Scaled products are accumulated into `sum` directly
+                    if (SymEngine::is_a<const SymEngine::MatrixMul>(*args[i])) {
+                        auto& term = SymEngine::down_cast<const SymEngine::MatrixMul&>(*args[i]);
+                        auto scalar = get_mul_scalar(term);
+                        auto factors = term.get_factors();
+                        if (factors.size()==1) {
+                            auto val = apply_(factors[0]);
+                            check_add_derivative(x);
+                            TINNED_PROFILE_SCOPE("OperatorEvaluator::eval_oper_axpy");
+                            eval_oper_axpy(sum, scalar, val);
+                        }
+                        else {
+                            auto val0 = eval_mul_factors(factors, factors.size()-1);
+                            auto val1 = apply_(factors.back());
+                            update_mul_derivative();
+                            check_add_derivative(x);
+                            TINNED_PROFILE_SCOPE("OperatorEvaluator::eval_oper_gemm");
+                            eval_oper_gemm(sum, scalar, val0, val1);
+                        }
                     }
                     else {
-                        throw SymEngine::NotImplementedError(
-                            "OperatorEvaluator::bvisit() got invalid MatrixAdd "
-                            + stringify(x)
-                        );
+                        auto val = apply_(args[i]);
+                        check_add_derivative(x);
+                        TINNED_PROFILE_SCOPE("OperatorEvaluator::eval_oper_addition");
+                        eval_oper_addition(sum, val);
                     }
                 }
+                result_ = std::move(sum);
             }
 
             void bvisit(const SymEngine::MatrixMul& x)
             {
+                auto scalar = get_mul_scalar(x);
                 auto factors = x.get_factors();
-                switch (factors.size()) {
-                    case 1: {
-                        result_ = apply(factors[0]);
-                        break;
-                    }
-                    case 2: {
-                        auto val0 = apply(factors[0]);
-                        auto val1 = apply(factors[1]);
-                        result_ = eval_oper_multiplication(val0, val1);
-                        update_mul_derivative();
-                        break;
-                    }
-                    case 3: {
-                        auto val0 = apply(factors[0]);
-                        result_ = apply(factors[1]);
-                        auto val1 = eval_oper_multiplication(val0, result_);
-                        update_mul_derivative();
-                        val0 = apply(factors[2]);
-                        result_ = eval_oper_multiplication(val1, val0);
-                        update_mul_derivative();
-                        break;
-                    }
-                    default: {
-                        auto val0 = apply(factors[0]);
-                        auto val = apply(factors[1]);
-                        auto val1 = eval_oper_multiplication(val0, val);
-                        update_mul_derivative();
-                        for (std::size_t i=2; i<factors.size()-1; ++i) {
-                            val = apply(factors[i]);
-                            if (i%2==0) {
-                                val0 = eval_oper_multiplication(val1, val);
-                            }
-                            else {
-                                val1 = eval_oper_multiplication(val0, val);
-                            }
-                            update_mul_derivative();
-                        }
-                        val = apply(factors.back());
-                        if (factors.size()%2==0) {
-                            result_ = eval_oper_multiplication(val0, val);
-                        }
-                        else {
-                            result_ = eval_oper_multiplication(val1, val);
-                        }
-                        update_mul_derivative();
-                        break;
-                    }
-                }
-                auto scalar = x.get_scalar();
+                auto val = eval_mul_factors(factors, factors.size());
                 if (SymEngine::neq(*scalar, *SymEngine::one)) {
-                    if (SymEngine::is_a_Number(*scalar)) {
-                        eval_oper_scale(
-                            SymEngine::rcp_dynamic_cast<const SymEngine::Number>(scalar),
-                            result_
-                        );
-                    }
-                    else {
-                        throw SymEngine::NotImplementedError(
-                            "OperatorEvaluator::bvisit() not implemented for scalar "
-                            + stringify(scalar)
-                        );
-                    }
+                    TINNED_PROFILE_SCOPE("OperatorEvaluator::eval_oper_scale");
+                    eval_oper_scale(scalar, val);
                 }
+                result_ = std::move(val);
             }
     };
 }
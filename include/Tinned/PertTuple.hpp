@@ -7,6 +7,17 @@
 
    This file is the header file of perturbation tuples.
 
+   2026-10-18, Bin Gao:
+   * add ranking and unranking of perturbation tuples and permuting
+     perturbation-strength derivatives of `PertPermutation`;
+   * add enumeration of distinct multisets of perturbation-strength
+     derivatives with their multiplicities to `PertPermutation`, optionally
+     bounded by perturbation dependencies;
+   * add `get_frequency_sum_value()` for numerical sums of perturbation
+     frequencies;
+   * add hash and equality functors of perturbation multisets for unordered
+     containers.
+
    2024-04-30, Bin Gao:
    * first version
 */
@@ -17,8 +28,13 @@
 #include "Tinned/StringifyVisitor.hpp"
 
 #include <algorithm>
+#include <complex>
 #include <cstddef>
+#include <iterator>
+#include <numeric>
+#include <string>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <symengine/basic.h>
@@ -27,9 +43,12 @@
 #include <symengine/constants.h>
 #include <symengine/symbol.h>
 #include <symengine/symengine_assert.h>
+#include <symengine/symengine_casts.h>
+#include <symengine/symengine_exception.h>
 #include <symengine/symengine_rcp.h>
 
 #include "Tinned/Perturbation.hpp"
+#include "Tinned/PertDependency.hpp"
 #include "Tinned/ZeroOperator.hpp"
 #include "Tinned/ZerosRemover.hpp"
 
@@ -50,6 +69,28 @@ namespace Tinned
         return perturbations;
     }
 
+    // Hash and equality functors of perturbation multisets (derivatives), so
+    // that they can be used as keys of unordered containers
+    struct PertMultisetHash
+    {
+        inline std::size_t operator()(const SymEngine::multiset_basic& x) const
+        {
+            SymEngine::hash_t seed = x.size();
+            for (const auto& p: x) SymEngine::hash_combine(seed, *p);
+            return seed;
+        }
+    };
+
+    struct PertMultisetEq
+    {
+        inline bool operator()(
+            const SymEngine::multiset_basic& x, const SymEngine::multiset_basic& y
+        ) const
+        {
+            return SymEngine::unified_eq(x, y);
+        }
+    };
+
     // Helper function to do high-order differentiation, and to remove zero
     // quantities
     template<typename T,
@@ -89,13 +130,29 @@ namespace Tinned
         for (const auto& p: perturbations) {
             SYMENGINE_ASSERT(SymEngine::is_a_sub<const Perturbation>(*p))
             result = SymEngine::addnum(
-                result,
-                SymEngine::rcp_dynamic_cast<const Perturbation>(p)->get_frequency()
+                result, SymEngine::down_cast<const Perturbation&>(*p).get_frequency()
             );
         }
         return result;
     }
 
+    // Compute the sum of perturbation frequencies as a complex double
+    // number, from frequencies cached by perturbations, for numerical
+    // evaluation
+    template<typename T,
+             typename std::enable_if<std::is_same<T, PertTuple>::value ||
+                 std::is_same<T, SymEngine::multiset_basic>::value ||
+                 std::is_same<T, SymEngine::vec_basic>::value, int>::type = 0>
+    inline std::complex<double> get_frequency_sum_value(const T& perturbations)
+    {
+        std::complex<double> result = 0.0;
+        for (const auto& p: perturbations) {
+            SYMENGINE_ASSERT(SymEngine::is_a_sub<const Perturbation>(*p))
+            result += SymEngine::down_cast<const Perturbation&>(*p).get_frequency_value();
+        }
+        return result;
+    }
+
     // For a set of perturbations {b1, b2, ..., bn} and an `order` of
     // perturbation-strength derivatives, we first generate a perturbation
     // tuple of the `order`, and then build all its perturbation-strength
@@ -161,6 +218,39 @@ namespace Tinned
                 return true;
             }
 
+            // Enumerate weak compositions in decreasing lexicographic order,
+            // with each part not greater than its bound, and save multisets
+            // of perturbation-strength derivatives
+            inline void enumerate_multisets(
+                const std::size_t idxPert,
+                const unsigned int remaining,
+                const std::vector<unsigned int>& bounds,
+                std::vector<unsigned int>& compositions,
+                std::vector<std::pair<SymEngine::multiset_basic, std::size_t>>& multisets
+            ) const
+            {
+                if (idxPert+1==compositions.size()) {
+                    if (remaining>bounds[idxPert]) return;
+                    compositions[idxPert] = remaining;
+                    SymEngine::multiset_basic derivatives;
+                    auto iter_pert = perturbations_.begin();
+                    for (std::size_t p=0; p<compositions.size(); ++p,++iter_pert)
+                        for (unsigned int i=0; i<compositions[p]; ++i)
+                            derivatives.insert(*iter_pert);
+                    multisets.push_back(std::make_pair(
+                        std::move(derivatives), get_multiplicity(compositions)
+                    ));
+                }
+                else {
+                    for (unsigned int v=std::min(remaining, bounds[idxPert])+1; v-->0;) {
+                        compositions[idxPert] = v;
+                        enumerate_multisets(
+                            idxPert+1, remaining-v, bounds, compositions, multisets
+                        );
+                    }
+                }
+            }
+
         public:
             explicit PertPermutation(
                 const unsigned int order,
@@ -213,6 +303,269 @@ namespace Tinned
                 return derivatives;
             }
 
+            // Perturbation tuples and permuting perturbation-strength
+            // derivatives can also be accessed by their indices in the
+            // sequences generated by `get_pert_tuple()` and
+            // `get_derivatives()`, so that different workers can take
+            // different ranges of indices without enumerating the sequences.
+            // The index of derivatives is `idxTuple*order!+idxPermutation`,
+            // where `idxPermutation` is the lexicographic rank of the
+            // permutation of positions in the perturbation tuple.
+
+            // Number of weak compositions of `m` into `k` parts
+            static inline std::size_t get_num_compositions(
+                const unsigned int m, const std::size_t k
+            ) noexcept
+            {
+                // C(m+k-1, k-1)
+                std::size_t result = 1;
+                for (std::size_t i=1; i<k; ++i) result = result*(m+i)/i;
+                return result;
+            }
+
+            static inline std::size_t get_factorial(const unsigned int n) noexcept
+            {
+                std::size_t result = 1;
+                for (unsigned int i=2; i<=n; ++i) result *= i;
+                return result;
+            }
+
+            // Get the number of perturbation tuples
+            inline std::size_t get_num_pert_tuples() const noexcept
+            {
+                return get_num_compositions(order_, perturbations_.size());
+            }
+
+            // Get the number of permuting perturbation-strength derivatives
+            inline std::size_t get_num_derivatives() const noexcept
+            {
+                return get_num_pert_tuples()*get_factorial(order_);
+            }
+
+            // Get the weak composition of a perturbation tuple from its index
+            inline std::vector<unsigned int> unrank_compositions(std::size_t index) const
+            {
+                if (index>=get_num_pert_tuples()) throw SymEngine::SymEngineException(
+                    "PertPermutation::unrank_compositions() gets an invalid index "
+                    + std::to_string(index)
+                );
+                const auto num_parts = perturbations_.size();
+                std::vector<unsigned int> compositions(num_parts, 0);
+                unsigned int remaining = order_;
+                // Compositions are in decreasing lexicographic order
+                for (std::size_t p=0; p+1<num_parts; ++p) {
+                    for (unsigned int v=remaining+1; v-->0;) {
+                        auto count = get_num_compositions(remaining-v, num_parts-p-1);
+                        if (index<count) {
+                            compositions[p] = v;
+                            remaining -= v;
+                            break;
+                        }
+                        index -= count;
+                    }
+                }
+                compositions.back() = remaining;
+                return compositions;
+            }
+
+            // Get the index of a perturbation tuple from its weak composition
+            inline std::size_t rank_compositions(
+                const std::vector<unsigned int>& compositions
+            ) const
+            {
+                const auto num_parts = perturbations_.size();
+                if (compositions.size()!=num_parts ||
+                    std::accumulate(compositions.begin(), compositions.end(), 0u)!=order_)
+                    throw SymEngine::SymEngineException(
+                        "PertPermutation::rank_compositions() gets invalid compositions"
+                    );
+                std::size_t index = 0;
+                unsigned int remaining = order_;
+                for (std::size_t p=0; p+1<num_parts; ++p) {
+                    for (unsigned int v=remaining; v>compositions[p]; --v)
+                        index += get_num_compositions(remaining-v, num_parts-p-1);
+                    remaining -= compositions[p];
+                }
+                return index;
+            }
+
+            // Get a perturbation tuple from its index
+            inline SymEngine::vec_basic unrank_pert_tuple(const std::size_t index) const
+            {
+                auto compositions = unrank_compositions(index);
+                SymEngine::vec_basic pert_tuple;
+                auto iter_pert = perturbations_.begin();
+                for (std::size_t p=0; p<compositions.size(); ++p,++iter_pert)
+                    for (unsigned int i=0; i<compositions[p]; ++i)
+                        pert_tuple.push_back(*iter_pert);
+                return pert_tuple;
+            }
+
+            // Get the index of a perturbation tuple, whose perturbations can
+            // be in any order
+            inline std::size_t rank_pert_tuple(const SymEngine::vec_basic& pertTuple) const
+            {
+                std::vector<unsigned int> compositions(perturbations_.size(), 0);
+                for (const auto& p: pertTuple) {
+                    auto iter_pert = perturbations_.find(p);
+                    if (iter_pert==perturbations_.end()) throw SymEngine::SymEngineException(
+                        "PertPermutation::rank_pert_tuple() gets an invalid perturbation "
+                        + stringify(p)
+                    );
+                    ++compositions[std::distance(perturbations_.begin(), iter_pert)];
+                }
+                return rank_compositions(compositions);
+            }
+
+            // Get the permutation of positions from its lexicographic rank
+            inline std::vector<unsigned int> unrank_positions(std::size_t index) const
+            {
+                std::vector<unsigned int> candidates(permut_positions_.size());
+                for (unsigned int i=0; i<candidates.size(); ++i) candidates[i] = i;
+                std::vector<unsigned int> positions;
+                positions.reserve(candidates.size());
+                for (unsigned int n=order_; n>0; --n) {
+                    auto factorial = get_factorial(n-1);
+                    auto k = index/factorial;
+                    index %= factorial;
+                    positions.push_back(candidates[k]);
+                    candidates.erase(candidates.begin()+k);
+                }
+                return positions;
+            }
+
+            // Get the lexicographic rank of a permutation of positions
+            inline std::size_t rank_positions(const std::vector<unsigned int>& positions) const
+            {
+                std::size_t index = 0;
+                for (std::size_t i=0; i<positions.size(); ++i) {
+                    std::size_t smaller = 0;
+                    for (std::size_t j=i+1; j<positions.size(); ++j)
+                        if (positions[j]<positions[i]) ++smaller;
+                    index += smaller*get_factorial(positions.size()-i-1);
+                }
+                return index;
+            }
+
+            // Get permuting perturbation-strength derivatives from the index
+            inline SymEngine::vec_basic unrank_derivatives(const std::size_t index) const
+            {
+                if (index>=get_num_derivatives()) throw SymEngine::SymEngineException(
+                    "PertPermutation::unrank_derivatives() gets an invalid index "
+                    + std::to_string(index)
+                );
+                const auto factorial = get_factorial(order_);
+                auto pert_tuple = unrank_pert_tuple(index/factorial);
+                SymEngine::vec_basic derivatives;
+                for (const auto& p: unrank_positions(index%factorial))
+                    derivatives.push_back(pert_tuple[p]);
+                return derivatives;
+            }
+
+            // Get the index of permuting perturbation-strength derivatives
+            // from the perturbation tuple and the permutation of positions
+            inline std::size_t rank_derivatives(
+                const SymEngine::vec_basic& pertTuple,
+                const std::vector<unsigned int>& positions
+            ) const
+            {
+                if (positions.size()!=order_) throw SymEngine::SymEngineException(
+                    "PertPermutation::rank_derivatives() gets invalid positions"
+                );
+                return rank_pert_tuple(pertTuple)*get_factorial(order_)
+                    + rank_positions(positions);
+            }
+
+            // Call `fun(index, derivatives)` for permuting
+            // perturbation-strength derivatives with indices in [first, last)
+            template<typename Function>
+            inline void for_each_derivatives(
+                const std::size_t first, const std::size_t last, Function fun
+            ) const
+            {
+                if (first>=last) return;
+                if (last>get_num_derivatives()) throw SymEngine::SymEngineException(
+                    "PertPermutation::for_each_derivatives() gets an invalid range ["
+                    + std::to_string(first) + ", " + std::to_string(last) + ")"
+                );
+                const auto factorial = get_factorial(order_);
+                auto idx_tuple = first/factorial;
+                auto pert_tuple = unrank_pert_tuple(idx_tuple);
+                auto positions = unrank_positions(first%factorial);
+                for (auto index=first; index<last; ++index) {
+                    SymEngine::vec_basic derivatives;
+                    for (const auto& p: positions) derivatives.push_back(pert_tuple[p]);
+                    fun(index, derivatives);
+                    if (!std::next_permutation(positions.begin(), positions.end())) {
+                        ++idx_tuple;
+                        if (idx_tuple<get_num_pert_tuples())
+                            pert_tuple = unrank_pert_tuple(idx_tuple);
+                    }
+                }
+            }
+
+            // Multinomial coefficient order!/\prod_{p}n_{p}!, i.e. the number
+            // of distinct permuting perturbation-strength derivatives of a
+            // weak composition {n_{p}}
+            static inline std::size_t get_multiplicity(
+                const std::vector<unsigned int>& compositions
+            ) noexcept
+            {
+                // Product of binomial coefficients, which avoids computing
+                // order! for high orders
+                std::size_t result = 1;
+                std::size_t total = 0;
+                for (const auto& n: compositions)
+                    for (unsigned int i=1; i<=n; ++i) {
+                        ++total;
+                        result = result*total/i;
+                    }
+                return result;
+            }
+
+            // Get each distinct multiset of perturbation-strength derivatives
+            // once, together with its multiplicity in the sequence generated
+            // by `get_derivatives()` as distinct permuting derivatives.
+            // Multisets are in the order of perturbation tuples.
+            inline std::vector<std::pair<SymEngine::multiset_basic, std::size_t>>
+            get_derivative_multisets() const
+            {
+                std::vector<std::pair<SymEngine::multiset_basic, std::size_t>> multisets;
+                std::vector<unsigned int> compositions(perturbations_.size(), 0);
+                enumerate_multisets(
+                    0,
+                    order_,
+                    std::vector<unsigned int>(perturbations_.size(), order_),
+                    compositions,
+                    multisets
+                );
+                return multisets;
+            }
+
+            // Same as above but skip multisets that are zero derivatives
+            // according to `dependencies`, i.e. the order of any perturbation
+            // exceeds its maximum order in `dependencies`
+            inline std::vector<std::pair<SymEngine::multiset_basic, std::size_t>>
+            get_derivative_multisets(const PertDependency& dependencies) const
+            {
+                std::vector<unsigned int> bounds;
+                bounds.reserve(perturbations_.size());
+                for (const auto& p: perturbations_) {
+                    unsigned int bound = 0;
+                    for (const auto& dep: dependencies) {
+                        if (dep.first->__eq__(*p)) {
+                            bound = dep.second;
+                            break;
+                        }
+                    }
+                    bounds.push_back(bound);
+                }
+                std::vector<std::pair<SymEngine::multiset_basic, std::size_t>> multisets;
+                std::vector<unsigned int> compositions(perturbations_.size(), 0);
+                enumerate_multisets(0, order_, bounds, compositions, multisets);
+                return multisets;
+            }
+
             ~PertPermutation() noexcept = default;
     };
 }
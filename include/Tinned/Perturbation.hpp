@@ -7,6 +7,10 @@
 
    This file is the header file of perturbations.
 
+   2026-10-18, Bin Gao:
+   * cache the frequency as a complex double number for numerical
+     evaluation.
+
    2023-10-09, Bin Gao:
    * change Perturbation's frequency to class
      SymEngine::RCP<const SymEngine::Number>. Users can use any derived class
@@ -18,6 +22,7 @@
 
 #pragma once
 
+#include <complex>
 #include <cstddef>
 #include <set>
 #include <string>
@@ -36,6 +41,8 @@ namespace Tinned
         protected:
             // Frequency
             SymEngine::RCP<const SymEngine::Number> frequency_;
+            // Frequency as a complex double number
+            std::complex<double> frequency_value_;
             // Set of components
             std::set<std::size_t> components_;
 
@@ -57,6 +64,12 @@ namespace Tinned
                 return frequency_;
             }
 
+            //! Get the frequency as a complex double number
+            inline std::complex<double> get_frequency_value() const noexcept
+            {
+                return frequency_value_;
+            }
+
             //! Get the set of components of the perturbation
             inline std::set<std::size_t> get_components() const
             {
@@ -0,0 +1,145 @@
+/* Tinned: a set of nonnumerical routines for computational chemistry
+   Copyright 2023-2024 Bin Gao
+
+   This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+   This file is the header file of profiling evaluators and visitors.
+
+   2026-10-18, Bin Gao:
+   * first version
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Tinned
+{
+    // Accumulated statistics of a profiled region
+    struct ProfileRecord
+    {
+        std::size_t num_calls = 0;
+        // Wall time in seconds
+        double wall_time = 0.0;
+        // Floating point operations reported by users
+        double flops = 0.0;
+    };
+
+    // Singleton collecting call counts, wall time and FLOPs of profiled
+    // regions, which are evaluator callbacks and visitor passes when the
+    // library is built with `TINNED_PROFILING=ON`. Regions are named like
+    // "OperatorEvaluator::eval_1el_operator", and users may report FLOPs of
+    // their callbacks by `TINNED_PROFILE_FLOPS()` with the same names.
+    class Profiler
+    {
+        public:
+            typedef std::chrono::steady_clock Clock;
+
+        protected:
+            // Complete event of Chrome trace
+            struct TraceEvent
+            {
+                std::string name;
+                Clock::time_point start;
+                Clock::time_point end;
+                std::size_t thread;
+            };
+
+            mutable std::mutex mutex_;
+            Clock::time_point origin_;
+            bool trace_;
+            // Maximum number of kept events, and the number of events dropped
+            // after reaching it
+            std::size_t max_events_;
+            std::size_t num_dropped_events_;
+            std::map<std::string, ProfileRecord> records_;
+            std::vector<TraceEvent> events_;
+            std::map<std::thread::id, std::size_t> threads_;
+
+            explicit Profiler():
+                origin_(Clock::now()),
+                trace_(false),
+                max_events_(1000000),
+                num_dropped_events_(0) {}
+
+        public:
+            Profiler(const Profiler&) = delete;
+            Profiler& operator=(const Profiler&) = delete;
+
+            static Profiler& instance();
+
+            // Record a call of the region `name`
+            void add_call(
+                const std::string& name,
+                const Clock::time_point& start,
+                const Clock::time_point& end
+            );
+
+            // Add `flops` floating point operations to the region `name`
+            void add_flops(const std::string& name, const double flops);
+
+            // Whether to keep events for Chrome trace, which is off by
+            // default. At most `maxEvents` events are kept, later ones are
+            // dropped but still counted in records.
+            void set_trace(const bool trace, const std::size_t maxEvents = 1000000);
+
+            std::size_t get_num_events() const;
+
+            std::size_t get_num_dropped_events() const;
+
+            // Clear all records and events
+            void reset();
+
+            std::map<std::string, ProfileRecord> get_records() const;
+
+            // Return a table of records sorted by wall time
+            std::string get_summary() const;
+
+            // Write events in the Chrome trace event format, which can be
+            // viewed by chrome://tracing or Perfetto, and has the number of
+            // dropped events in its metadata
+            void write_chrome_trace(const std::string& filename) const;
+    };
+
+    // Record the wall time of a scope
+    class ProfileScope
+    {
+        protected:
+            const char* name_;
+            Profiler::Clock::time_point start_;
+
+        public:
+            explicit ProfileScope(const char* name):
+                name_(name), start_(Profiler::Clock::now()) {}
+
+            ProfileScope(const ProfileScope&) = delete;
+            ProfileScope& operator=(const ProfileScope&) = delete;
+
+            ~ProfileScope()
+            {
+                Profiler::instance().add_call(name_, start_, Profiler::Clock::now());
+            }
+    };
+}
+
+// Profiling macros compile to nothing unless `TINNED_ENABLE_PROFILING` is
+// defined
+#if defined(TINNED_ENABLE_PROFILING)
+#define TINNED_PROFILE_CONCAT_(a, b) a##b
+#define TINNED_PROFILE_CONCAT(a, b) TINNED_PROFILE_CONCAT_(a, b)
+#define TINNED_PROFILE_SCOPE(name) \
+    Tinned::ProfileScope TINNED_PROFILE_CONCAT(tinned_profile_scope_, __LINE__)(name)
+#define TINNED_PROFILE_FLOPS(name, flops) \
+    Tinned::Profiler::instance().add_flops(name, flops)
+#else
+#define TINNED_PROFILE_SCOPE(name)
+#define TINNED_PROFILE_FLOPS(name, flops)
+#endif
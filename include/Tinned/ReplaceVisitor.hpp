@@ -40,6 +40,7 @@
 #include <symengine/subs.h>
 
 #include "Tinned/FindAllVisitor.hpp"
+#include "Tinned/Profiler.hpp"
 
 namespace Tinned
 {
@@ -154,6 +155,7 @@ namespace Tinned
     )
     {
         //ReplaceVisitor visitor(subs_dict, cache);
+        TINNED_PROFILE_SCOPE("ReplaceVisitor::apply");
         ReplaceVisitor visitor(subs_dict, false);
         return visitor.apply(x);
     }
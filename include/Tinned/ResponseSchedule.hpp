@@ -0,0 +1,112 @@
+/* Tinned: a set of nonnumerical routines for computational chemistry
+   Copyright 2023-2024 Bin Gao
+
+   This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+   This file is the header file of schedules of response equations to solve.
+
+   2026-10-18, Bin Gao:
+   * first version
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <symengine/basic.h>
+#include <symengine/dict.h>
+#include <symengine/number.h>
+#include <symengine/symengine_rcp.h>
+
+namespace Tinned
+{
+    // A response equation to solve for a perturbed response parameter
+    struct ResponseSolve
+    {
+        // Perturbed response parameter, like D^{ab}
+        SymEngine::RCP<const SymEngine::Basic> parameter;
+        // Index of the unperturbed parameter in the list given to
+        // `ResponseSchedule`
+        std::size_t idx_parameter;
+        SymEngine::multiset_basic derivatives;
+        // Sum of perturbation frequencies
+        SymEngine::RCP<const SymEngine::Number> frequency;
+        // Indices of solves whose solutions are needed by this solve
+        std::vector<std::size_t> prerequisites;
+        // Length of the longest chain of prerequisites
+        std::size_t level;
+    };
+
+    // Schedule of response equations to solve for a property expression, in
+    // which response parameters have been eliminated. All perturbed response
+    // parameters found in the expression need to be solved, as well as their
+    // lower order derivatives that appear in the right hand sides of their
+    // response equations.
+    //
+    // A perturbed parameter depends on all derivatives of the same parameter
+    // with respect to its proper sub-multisets of perturbations. Parameters
+    // are given in the order that a perturbed parameter also depends on
+    // derivatives of previous parameters with respect to its sub-multisets
+    // of perturbations, for example, {D, lambda} for multipliers lambda
+    // depending on perturbed density matrices.
+    //
+    // Solves are topologically ordered by their orders of derivatives and
+    // the order of parameters. Solves of the same level and frequency do not
+    // depend on each other and can be batched by linear-equation solvers.
+    class ResponseSchedule
+    {
+        protected:
+            std::vector<ResponseSolve> solves_;
+            // Indices of solves grouped by levels and frequencies
+            std::vector<std::vector<std::size_t>> groups_;
+
+            // Get derivatives of a response parameter
+            static SymEngine::multiset_basic get_parameter_derivatives(
+                const SymEngine::RCP<const SymEngine::Basic>& x
+            );
+
+            // Check if `x` is a sub-multiset of `y`
+            static bool is_sub_multiset(
+                const SymEngine::multiset_basic& x, const SymEngine::multiset_basic& y
+            );
+
+            // Add a solve if it does not exist yet, together with all solves
+            // of its sub-multisets of perturbations
+            void add_solve(
+                const SymEngine::vec_basic& parameters,
+                const std::size_t idxParameter,
+                const SymEngine::multiset_basic& derivatives,
+                std::vector<ResponseSolve>& solves
+            );
+
+        public:
+            explicit ResponseSchedule(
+                const SymEngine::RCP<const SymEngine::Basic>& expr,
+                const SymEngine::vec_basic& parameters
+            );
+
+            inline std::size_t size() const noexcept
+            {
+                return solves_.size();
+            }
+
+            inline const std::vector<ResponseSolve>& get_solves() const noexcept
+            {
+                return solves_;
+            }
+
+            // Groups of indices of solves that share a frequency and level,
+            // in an order that prerequisites of any group are in previous
+            // groups
+            inline const std::vector<std::vector<std::size_t>>&
+            get_frequency_groups() const noexcept
+            {
+                return groups_;
+            }
+
+            ~ResponseSchedule() = default;
+    };
+}
@@ -0,0 +1,158 @@
+/* Tinned: a set of nonnumerical routines for computational chemistry
+   Copyright 2023-2024 Bin Gao
+
+   This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+   This file is the header file of permutational symmetry of response
+   tensors.
+
+   2026-10-18, Bin Gao:
+   * first version
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <symengine/basic.h>
+#include <symengine/dict.h>
+#include <symengine/symengine_exception.h>
+#include <symengine/symengine_rcp.h>
+
+#include "Tinned/Perturbation.hpp"
+#include "Tinned/ComponentLayout.hpp"
+
+namespace Tinned
+{
+    // Permutational symmetry of a response tensor with respect to a list of
+    // perturbations. Perturbations are equivalent if they are equal, i.e.
+    // the same name, frequency and components, and the tensor is symmetric
+    // under the permutation of equivalent perturbations. Therefore, the
+    // response tensor is derived only once with respect to the multiset of
+    // perturbations, evaluated only for symmetry-unique components given by
+    // the `ComponentLayout` of the multiset, and then scattered back into the
+    // full tensor.
+    //
+    // Components of the full tensor are stored in a row-major way following
+    // the order of perturbations, i.e. those of the last perturbation run
+    // fastest. A perturbation without components is considered to have only
+    // one component 0.
+    class ResponseSymmetry
+    {
+        protected:
+            std::vector<SymEngine::RCP<const Perturbation>> perturbations_;
+            // Unique components
+            ComponentLayout layout_;
+            // Components of each perturbation
+            std::vector<std::vector<std::size_t>> components_;
+            // Positions of perturbations grouped by the distinct
+            // perturbations in `layout_`
+            std::vector<std::size_t> positions_;
+            // Index of unique component of each component of the full tensor
+            std::vector<std::size_t> idx_unique_;
+            // Index of a component of the full tensor representing each
+            // unique component, and the number of components it represents
+            std::vector<std::size_t> representatives_;
+            std::vector<std::size_t> multiplicities_;
+
+        public:
+            explicit ResponseSymmetry(
+                const std::vector<SymEngine::RCP<const Perturbation>>& perturbations
+            );
+
+            // Number of components of the full tensor
+            inline std::size_t size() const noexcept
+            {
+                return idx_unique_.size();
+            }
+
+            // Number of symmetry-unique components
+            inline std::size_t get_num_unique() const noexcept
+            {
+                return representatives_.size();
+            }
+
+            inline const std::vector<SymEngine::RCP<const Perturbation>>&
+            get_perturbations() const noexcept
+            {
+                return perturbations_;
+            }
+
+            // Derivatives that the response tensor is differentiated with
+            // respect to
+            inline SymEngine::multiset_basic get_derivatives() const
+            {
+                return SymEngine::multiset_basic(perturbations_.begin(), perturbations_.end());
+            }
+
+            // Layout of unique components, which is also the layout of the
+            // derivatives used by evaluators
+            inline const ComponentLayout& get_layout() const noexcept
+            {
+                return layout_;
+            }
+
+            // Get components of perturbations from an index of the full tensor
+            std::vector<std::size_t> get_components(std::size_t index) const;
+
+            // Get the index of the full tensor from components of
+            // perturbations
+            std::size_t get_index(const std::vector<std::size_t>& components) const;
+
+            // Get the index of unique component of a component of the full
+            // tensor
+            inline std::size_t get_unique_index(const std::size_t index) const
+            {
+                if (index>=size()) throw SymEngine::SymEngineException(
+                    "ResponseSymmetry::get_unique_index() gets an invalid index "
+                    + std::to_string(index)
+                );
+                return idx_unique_[index];
+            }
+
+            // Get the index of the full tensor representing a unique component
+            inline std::size_t get_representative(const std::size_t idxUnique) const
+            {
+                if (idxUnique>=get_num_unique()) throw SymEngine::SymEngineException(
+                    "ResponseSymmetry::get_representative() gets an invalid index "
+                    + std::to_string(idxUnique)
+                );
+                return representatives_[idxUnique];
+            }
+
+            // Get the number of components of the full tensor equal to a
+            // unique component
+            inline std::size_t get_multiplicity(const std::size_t idxUnique) const
+            {
+                if (idxUnique>=get_num_unique()) throw SymEngine::SymEngineException(
+                    "ResponseSymmetry::get_multiplicity() gets an invalid index "
+                    + std::to_string(idxUnique)
+                );
+                return multiplicities_[idxUnique];
+            }
+
+            // Scatter values of unique components, in the order of
+            // `get_layout()`, into the full tensor
+            template<typename T>
+            inline std::vector<T> scatter(const std::vector<T>& uniqueValues) const
+            {
+                if (uniqueValues.size()!=get_num_unique())
+                    throw SymEngine::SymEngineException(
+                        "ResponseSymmetry::scatter() gets "
+                        + std::to_string(uniqueValues.size())
+                        + " values instead of "
+                        + std::to_string(get_num_unique())
+                    );
+                std::vector<T> result;
+                result.reserve(size());
+                for (const auto& idx: idx_unique_) result.push_back(uniqueValues[idx]);
+                return result;
+            }
+
+            ~ResponseSymmetry() = default;
+    };
+}
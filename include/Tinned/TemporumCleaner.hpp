@@ -7,6 +7,10 @@
 
    This file is the header file of cleaning `TemporumOperator` objects.
 
+   2026-10-18, Bin Gao:
+   * add symbolic mode using frequency placeholders, so that cleaned
+     expressions do not depend on numerical frequencies.
+
    2024-05-08, Bin Gao:
    * first version
 */
@@ -40,10 +44,16 @@ namespace Tinned
     // multiplied by sums of perturbation frequencies. Undifferentiated targets
     // and targets with zero sums, and undifferentiated `TemporumOverlap`
     // objects will be set as zero quantities.
+    //
+    // In the symbolic mode, sums of frequency placeholders (see
+    // "Tinned/FrequencyBinding.hpp") are used instead of numerical sums, and
+    // only undifferentiated targets and undifferentiated `TemporumOverlap`
+    // objects will be set as zero quantities.
     class TemporumCleaner: public SymEngine::BaseVisitor<TemporumCleaner>
     {
         protected:
             SymEngine::RCP<const SymEngine::Number> threshold_;
+            bool symbolic_;
             SymEngine::RCP<const SymEngine::Basic> result_;
 
             // Function template for one argument function like classes
@@ -80,8 +90,9 @@ namespace Tinned
         public:
             explicit TemporumCleaner(
                 const SymEngine::RCP<const SymEngine::Number>&
-                    threshold = SymEngine::real_double(std::numeric_limits<double>::epsilon())
-            ) noexcept: threshold_(threshold) {}
+                    threshold = SymEngine::real_double(std::numeric_limits<double>::epsilon()),
+                const bool symbolic = false
+            ) noexcept: threshold_(threshold), symbolic_(symbolic) {}
 
             inline SymEngine::RCP<const SymEngine::Basic> apply(
                 const SymEngine::RCP<const SymEngine::Basic>& x
@@ -104,12 +115,16 @@ namespace Tinned
     };
 
     // Helper function to clean `TemporumOperator` and unperturbed
-    // `TemporumOverlap` objects in `x`
+    // `TemporumOverlap` objects in `x`, frequency placeholders will be used
+    // if `symbolic` is true
     inline SymEngine::RCP<const SymEngine::Basic> clean_temporum(
-        const SymEngine::RCP<const SymEngine::Basic>& x
+        const SymEngine::RCP<const SymEngine::Basic>& x,
+        const bool symbolic = false
     )
     {
-        TemporumCleaner visitor;
+        TemporumCleaner visitor(
+            SymEngine::real_double(std::numeric_limits<double>::epsilon()), symbolic
+        );
         // Remove zero quantities
         auto result = remove_zeros(visitor.apply(x));
         if (result.is_null()) {
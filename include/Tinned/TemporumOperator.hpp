@@ -8,6 +8,11 @@
    This file is the header file of time differentiation operator
    i\frac{\partial}{\partial t}.
 
+   2026-10-18, Bin Gao:
+   * add `get_frequency_placeholder()` for the symbolic frequency factor;
+   * cache the frequency factor at construction, also as a complex double
+     number by `get_frequency_value()`.
+
    2024-06-04, Bin Gao:
    * remove the support for `NonElecFunction`
 
@@ -17,6 +22,8 @@
 
 #pragma once
 
+#include <complex>
+
 #include <symengine/basic.h>
 #include <symengine/dict.h>
 #include <symengine/number.h>
@@ -28,6 +35,8 @@
 #include <symengine/matrices/matrix_symbol.h>
 
 #include "Tinned/Perturbation.hpp"
+#include "Tinned/PertTuple.hpp"
+#include "Tinned/FrequencyBinding.hpp"
 #include "Tinned/ElectronicState.hpp"
 #include "Tinned/OneElecOperator.hpp"
 
@@ -43,6 +52,9 @@ namespace Tinned
             SymEngine::RCP<const SymEngine::MatrixExpr> target_;
             // Type of the time differentiation operator
             TemporumType type_;
+            // Frequency factor +/-sum(w), and as a complex double number
+            SymEngine::RCP<const SymEngine::Number> frequency_;
+            std::complex<double> frequency_value_;
 
         public:
             explicit TemporumOperator(
@@ -73,16 +85,24 @@ namespace Tinned
             }
 
             // Get frequency factor +/-sum(w)
-            inline SymEngine::RCP<const SymEngine::Number> get_frequency() const
+            inline const SymEngine::RCP<const SymEngine::Number>& get_frequency() const noexcept
             {
-                SymEngine::RCP<const SymEngine::Number> result = SymEngine::zero;
-                for (const auto& var: get_derivatives()) {
-                    auto pert = SymEngine::rcp_dynamic_cast<const Perturbation>(var);
-                    auto frequency = pert->get_frequency();
-                    result = SymEngine::addnum(result, frequency);
-                }
+                return frequency_;
+            }
+
+            // Get frequency factor +/-sum(w) as a complex double number
+            inline std::complex<double> get_frequency_value() const noexcept
+            {
+                return frequency_value_;
+            }
+
+            // Get symbolic frequency factor +/-sum(omega) using frequency
+            // placeholders of perturbations
+            inline SymEngine::RCP<const SymEngine::Basic> get_frequency_placeholder() const
+            {
+                auto result = get_frequency_placeholder_sum(get_derivatives());
                 return type_==TemporumType::Ket
-                    ? result : SymEngine::subnum(SymEngine::zero, result);
+                    ? result : SymEngine::mul(SymEngine::minus_one, result);
             }
 
             // Get derivatives
@@ -7,6 +7,11 @@
 
    This file is the header file of T matrix.
 
+   2026-10-18, Bin Gao:
+   * cache frequency factors of half time-differentiated bra and ket
+     products at construction, also as complex double numbers by
+     `get_frequency_value()`.
+
    2024-06-04, Bin Gao:
    * use `OneElecOperator` to represent basis functions on bra and ket
 
@@ -22,9 +27,11 @@
 
 #pragma once
 
+#include <complex>
 #include <cstddef>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include <symengine/basic.h>
 #include <symengine/dict.h>
@@ -51,6 +58,14 @@ namespace Tinned
         protected:
             // Sum of half time-differentiated bra and ket products
             SymEngine::RCP<const SymEngine::Basic> braket_;
+            // Frequency factors of half time-differentiated bra and ket
+            // products, and as complex double numbers
+            std::vector<SymEngine::RCP<const SymEngine::Number>> frequencies_;
+            std::vector<std::complex<double>> frequency_values_;
+
+            // Compute frequency factors of all products, called by
+            // constructors
+            void find_frequencies();
 
         public:
             explicit TemporumOverlap(const PertDependency& dependencies);
@@ -128,20 +143,18 @@ namespace Tinned
             }
 
             // Get frequency factor [sum(w_bra)-sum(w_ket)]/2 of a product
-            inline SymEngine::RCP<const SymEngine::Number>
+            inline const SymEngine::RCP<const SymEngine::Number>&
             get_frequency(const std::size_t index) const
             {
-                auto term = get_braket_product(index);
-                return SymEngine::divnum(
-                    SymEngine::mulnum(
-                        SymEngine::addnum(
-                            std::get<1>(term)->get_frequency(),
-                            std::get<2>(term)->get_frequency()
-                        ),
-                        std::get<0>(term)
-                    ),
-                    SymEngine::integer(-2)
-                );
+                SYMENGINE_ASSERT(index<size())
+                return frequencies_[index];
+            }
+
+            // Get frequency factor of a product as a complex double number
+            inline std::complex<double> get_frequency_value(const std::size_t index) const
+            {
+                SYMENGINE_ASSERT(index<size())
+                return frequency_values_[index];
             }
 
             // Get derivatives on bra and ket of a product
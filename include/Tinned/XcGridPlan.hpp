@@ -0,0 +1,143 @@
+/* Tinned: a set of nonnumerical routines for computational chemistry
+   Copyright 2023-2024 Bin Gao
+
+   This Source Code Form is subject to the terms of the Mozilla Public
+   License, v. 2.0. If a copy of the MPL was not distributed with this
+   file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+   This file is the header file of grid execution plans of XC energy and
+   potential contractions.
+
+   2026-10-18, Bin Gao:
+   * first version
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <symengine/basic.h>
+#include <symengine/symengine_rcp.h>
+
+#include "Tinned/ElectronicState.hpp"
+#include "Tinned/OneElecOperator.hpp"
+#include "Tinned/NonElecFunction.hpp"
+#include "Tinned/ExchCorrContraction.hpp"
+#include "Tinned/DensityVectorTable.hpp"
+
+namespace Tinned
+{
+    // Recipe of a contraction w*exc^{(n)}*\sum{c*\prod{rho}}(*Omega), given
+    // by indices into tables of `XcGridPlan`. `idx_overlap` is
+    // `XcGridPlan::npos` for XC energy contractions, and `products` is empty
+    // for the unperturbed contraction.
+    struct XcContractionRecipe
+    {
+        std::size_t idx_weight;
+        unsigned int exc_order;
+        // Index of the generalized density vector that the XC functional
+        // derivative is evaluated at
+        std::size_t idx_exc_density;
+        std::size_t idx_overlap;
+        std::vector<XcDensityProduct> products;
+    };
+
+    // Grid execution plan of an `ExcContractionMap` or `VxcContractionMap`,
+    // which collects unique (un)perturbed electronic states, generalized
+    // overlap distributions, generalized density vectors tr(Omega^{x}*D^{y})
+    // and grid weights, and the orders of XC functional derivatives, so that
+    // all contractions can be computed in one pass over grid points
+    class XcGridPlan
+    {
+        protected:
+            // Distinct electronic states, generalized overlap distributions
+            // and generalized density vectors
+            DensityVectorTable table_;
+            std::vector<SymEngine::RCP<const NonElecFunction>> weights_;
+            std::set<unsigned int> exc_orders_;
+            std::vector<XcContractionRecipe> recipes_;
+
+            std::map<SymEngine::RCP<const SymEngine::Basic>,
+                     std::size_t,
+                     SymEngine::RCPBasicKeyLess> idx_weights_;
+
+            std::size_t add_weight(const SymEngine::RCP<const NonElecFunction>& weight);
+            // Add contractions of an `ExcContractionMap`
+            void add_energy_map(const ExcContractionMap& energyMap, const std::size_t idxOverlap);
+
+        public:
+            static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+            // Plans can start from a table of generalized density vectors,
+            // for example, one shared by XC energy and potential maps, so
+            // that indices of already interned entries stay the same
+            explicit XcGridPlan(
+                const ExcContractionMap& energyMap,
+                const DensityVectorTable& table = DensityVectorTable()
+            );
+            explicit XcGridPlan(
+                const VxcContractionMap& potentialMap,
+                const DensityVectorTable& table = DensityVectorTable()
+            );
+
+            inline const DensityVectorTable& get_density_table() const noexcept
+            {
+                return table_;
+            }
+
+            // Unique electronic states to be read
+            inline const std::vector<SymEngine::RCP<const ElectronicState>>&
+            get_states() const noexcept
+            {
+                return table_.get_states();
+            }
+
+            // Unique generalized overlap distributions to be computed
+            inline const std::vector<SymEngine::RCP<const OneElecOperator>>&
+            get_overlap_distributions() const noexcept
+            {
+                return table_.get_overlap_distributions();
+            }
+
+            // Unique generalized density vectors, each given by indices of
+            // generalized overlap distribution and electronic state
+            inline const std::vector<std::pair<std::size_t, std::size_t>>&
+            get_density_vectors() const noexcept
+            {
+                return table_.get_density_vectors();
+            }
+
+            // Get the expression of a generalized density vector
+            inline SymEngine::RCP<const SymEngine::Basic> get_density_vector(
+                const std::size_t index
+            ) const
+            {
+                return table_.get_density_vector(index);
+            }
+
+            // Unique (un)perturbed grid weights
+            inline const std::vector<SymEngine::RCP<const NonElecFunction>>&
+            get_weights() const noexcept
+            {
+                return weights_;
+            }
+
+            // Orders of XC functional derivatives needed
+            inline const std::set<unsigned int>& get_exc_orders() const noexcept
+            {
+                return exc_orders_;
+            }
+
+            inline const std::vector<XcContractionRecipe>& get_recipes() const noexcept
+            {
+                return recipes_;
+            }
+
+            ~XcGridPlan() = default;
+    };
+}
@@ -35,6 +35,7 @@
 #include <symengine/visitor.h>
 
 #include "Tinned/ZeroOperator.hpp"
+#include "Tinned/Profiler.hpp"
 
 namespace Tinned
 {
@@ -136,6 +137,7 @@ namespace Tinned
         const SymEngine::RCP<const SymEngine::Basic>& x
     )
     {
+        TINNED_PROFILE_SCOPE("ZerosRemover::apply");
         ZerosRemover visitor;
         return visitor.apply(x);
     }
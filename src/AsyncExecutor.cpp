@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <utility>
+
+#include "Tinned/AsyncExecutor.hpp"
+
+namespace Tinned
+{
+    AsyncExecutor::AsyncExecutor(const unsigned int numThreads):
+        num_running_(0), stop_(false)
+    {
+        for (unsigned int i=0; i<std::max(numThreads, 1u); ++i)
+            threads_.push_back(std::thread(&AsyncExecutor::run_tasks, this));
+    }
+
+    void AsyncExecutor::run_tasks()
+    {
+        while (true) {
+            std::shared_ptr<AsyncTask> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                task_ready_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+                // Threads stop only when all tasks have been taken
+                if (tasks_.empty()) return;
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+                ++num_running_;
+            }
+            task->run();
+            task->finished_ = true;
+            // Continuations whose dependencies have all finished
+            std::vector<std::shared_ptr<AsyncTask>> ready_tasks;
+            for (const auto& parent: task->parents_)
+                if (parent->num_pending_.fetch_sub(1)==1) ready_tasks.push_back(parent);
+            task.reset();
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (auto& ready_task: ready_tasks) tasks_.push_back(std::move(ready_task));
+                --num_running_;
+                if (tasks_.empty() && num_running_==0) idle_.notify_all();
+            }
+            if (!ready_tasks.empty()) task_ready_.notify_all();
+        }
+    }
+
+    void AsyncExecutor::submit(const std::vector<std::shared_ptr<AsyncTask>>& tasks)
+    {
+        if (tasks.empty()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.insert(tasks_.end(), tasks.begin(), tasks.end());
+        }
+        task_ready_.notify_all();
+    }
+
+    void AsyncExecutor::wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this]() { return tasks_.empty() && num_running_==0; });
+    }
+
+    AsyncExecutor::~AsyncExecutor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        task_ready_.notify_all();
+        for (auto& thread: threads_) thread.join();
+    }
+}
@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <utility>
+
+#include <symengine/symengine_casts.h>
+#include <symengine/symengine_exception.h>
+
+#include "Tinned/StringifyVisitor.hpp"
+
+#include "Tinned/ComponentLayout.hpp"
+
+namespace Tinned
+{
+    ComponentLayout::ComponentLayout(const SymEngine::multiset_basic& derivatives):
+        size_(1)
+    {
+        // Equal perturbations are adjacent in the multiset
+        for (auto iter=derivatives.begin(); iter!=derivatives.end();
+             iter=derivatives.upper_bound(*iter)) {
+            if (!SymEngine::is_a_sub<const Perturbation>(**iter))
+                throw SymEngine::SymEngineException(
+                    "ComponentLayout() gets an invalid perturbation " + stringify(*iter)
+                );
+            auto pert = SymEngine::rcp_static_cast<const Perturbation>(*iter);
+            auto order = static_cast<unsigned int>(derivatives.count(*iter));
+            auto components = pert->get_components();
+            std::vector<std::size_t> candidates(components.begin(), components.end());
+            if (candidates.empty()) candidates.push_back(0);
+            // Enumerate non-decreasing component tuples by positions in
+            // `candidates`
+            std::vector<std::vector<std::size_t>> tuples;
+            std::map<std::vector<std::size_t>, std::size_t> idx_tuples;
+            std::vector<std::size_t> positions(order, 0);
+            while (true) {
+                std::vector<std::size_t> tuple;
+                tuple.reserve(order);
+                for (const auto& p: positions) tuple.push_back(candidates[p]);
+                idx_tuples.emplace(tuple, tuples.size());
+                tuples.push_back(std::move(tuple));
+                // Move to the next non-decreasing positions
+                std::size_t k = order;
+                for (; k>0 && positions[k-1]+1==candidates.size(); --k);
+                if (k==0) break;
+                ++positions[k-1];
+                std::fill(positions.begin()+k, positions.end(), positions[k-1]);
+            }
+            size_ *= tuples.size();
+            perturbations_.push_back(pert);
+            orders_.push_back(order);
+            component_tuples_.push_back(std::move(tuples));
+            idx_component_tuples_.push_back(std::move(idx_tuples));
+        }
+    }
+
+    std::vector<std::size_t> ComponentLayout::get_components(std::size_t index) const
+    {
+        if (index>=size_) throw SymEngine::SymEngineException(
+            "ComponentLayout::get_components() gets an invalid index "
+            + std::to_string(index)
+        );
+        // Indices of component tuples of perturbations, the last one runs
+        // fastest
+        std::vector<std::size_t> idx_tuples(perturbations_.size(), 0);
+        for (std::size_t p=perturbations_.size(); p-->0;) {
+            idx_tuples[p] = index%component_tuples_[p].size();
+            index /= component_tuples_[p].size();
+        }
+        std::vector<std::size_t> components;
+        for (std::size_t p=0; p<perturbations_.size(); ++p) {
+            const auto& tuple = component_tuples_[p][idx_tuples[p]];
+            components.insert(components.end(), tuple.begin(), tuple.end());
+        }
+        return components;
+    }
+
+    std::size_t ComponentLayout::get_index(const std::vector<std::size_t>& components) const
+    {
+        std::size_t index = 0;
+        auto first = components.begin();
+        for (std::size_t p=0; p<perturbations_.size(); ++p) {
+            if (static_cast<std::size_t>(std::distance(first, components.end()))<orders_[p])
+                throw SymEngine::SymEngineException(
+                    "ComponentLayout::get_index() gets too few components"
+                );
+            std::vector<std::size_t> tuple(first, first+orders_[p]);
+            std::sort(tuple.begin(), tuple.end());
+            auto iter = idx_component_tuples_[p].find(tuple);
+            if (iter==idx_component_tuples_[p].end())
+                throw SymEngine::SymEngineException(
+                    "ComponentLayout::get_index() gets invalid components of "
+                    + stringify(perturbations_[p])
+                );
+            index = index*component_tuples_[p].size() + iter->second;
+            first += orders_[p];
+        }
+        if (first!=components.end()) throw SymEngine::SymEngineException(
+            "ComponentLayout::get_index() gets too many components"
+        );
+        return index;
+    }
+}
@@ -0,0 +1,162 @@
+#include <symengine/eval_double.h>
+#include <symengine/symengine_exception.h>
+
+#include "Tinned/StringifyVisitor.hpp"
+
+#include "Tinned/DenseEvaluator.hpp"
+
+namespace Tinned
+{
+    const DenseMatrix& DenseOperatorEvaluator::get_value(const SymEngine::Basic& x) const
+    {
+        auto value = values_.find(x.rcp_from_this());
+        if (value==values_.end()) throw SymEngine::SymEngineException(
+            "DenseOperatorEvaluator::get_value() has no value for " + stringify(x)
+        );
+        return value->second;
+    }
+
+    DenseMatrix DenseOperatorEvaluator::eval_pert_parameter(const PerturbedParameter& x)
+    {
+        return get_value(x);
+    }
+
+    DenseMatrix DenseOperatorEvaluator::eval_hermitian_transpose(const DenseMatrix& A)
+    {
+        return dense_adjoint(A);
+    }
+
+    DenseMatrix DenseOperatorEvaluator::eval_1el_density(const OneElecDensity& x)
+    {
+        return get_value(x);
+    }
+
+    DenseMatrix DenseOperatorEvaluator::eval_1el_operator(const OneElecOperator& x)
+    {
+        return get_value(x);
+    }
+
+    DenseMatrix DenseOperatorEvaluator::eval_2el_operator(const TwoElecOperator& x)
+    {
+        return get_value(x);
+    }
+
+    DenseMatrix DenseOperatorEvaluator::eval_xc_potential(const ExchCorrPotential& x)
+    {
+        return get_value(x);
+    }
+
+    DenseMatrix DenseOperatorEvaluator::eval_temporum_operator(const TemporumOperator& x)
+    {
+        auto value = values_.find(x.rcp_from_this());
+        if (value!=values_.end()) return value->second;
+        auto result = get_value(*x.get_target());
+        dense_scal(get_frequency_value(x), result);
+        return result;
+    }
+
+    DenseMatrix DenseOperatorEvaluator::eval_temporum_overlap(const TemporumOverlap& x)
+    {
+        return get_value(x);
+    }
+
+    DenseMatrix DenseOperatorEvaluator::eval_conjugate_matrix(const DenseMatrix& A)
+    {
+        return dense_conjugate(A);
+    }
+
+    DenseMatrix DenseOperatorEvaluator::eval_transpose(const DenseMatrix& A)
+    {
+        return dense_transpose(A);
+    }
+
+    void DenseOperatorEvaluator::eval_oper_addition(DenseMatrix& A, const DenseMatrix& B)
+    {
+        dense_axpy(1.0, B, A);
+    }
+
+    DenseMatrix DenseOperatorEvaluator::eval_oper_multiplication(
+        const DenseMatrix& A, const DenseMatrix& B
+    )
+    {
+        return dense_multiply(A, B);
+    }
+
+    void DenseOperatorEvaluator::eval_oper_scale(
+        const SymEngine::RCP<const SymEngine::Number>& scalar,
+        DenseMatrix& A
+    )
+    {
+        dense_scal(SymEngine::eval_complex_double(*scalar), A);
+    }
+
+    void DenseOperatorEvaluator::eval_oper_gemm(
+        DenseMatrix& C,
+        const SymEngine::RCP<const SymEngine::Number>& alpha,
+        const DenseMatrix& A,
+        const DenseMatrix& B
+    )
+    {
+        dense_gemm(SymEngine::eval_complex_double(*alpha), A, B, 1.0, C);
+    }
+
+    void DenseOperatorEvaluator::eval_oper_axpy(
+        DenseMatrix& A,
+        const SymEngine::RCP<const SymEngine::Number>& alpha,
+        const DenseMatrix& B
+    )
+    {
+        dense_axpy(SymEngine::eval_complex_double(*alpha), B, A);
+    }
+
+    std::complex<double> DenseFunctionEvaluator::get_value(const SymEngine::Basic& x) const
+    {
+        auto value = values_.find(x.rcp_from_this());
+        if (value==values_.end()) throw SymEngine::SymEngineException(
+            "DenseFunctionEvaluator::get_value() has no value for " + stringify(x)
+        );
+        return value->second;
+    }
+
+    std::complex<double> DenseFunctionEvaluator::eval_nonel_function(const NonElecFunction& x)
+    {
+        return get_value(x);
+    }
+
+    std::complex<double> DenseFunctionEvaluator::eval_2el_energy(const TwoElecEnergy& x)
+    {
+        return get_value(x);
+    }
+
+    std::complex<double> DenseFunctionEvaluator::eval_xc_energy(const ExchCorrEnergy& x)
+    {
+        return get_value(x);
+    }
+
+    std::complex<double> DenseFunctionEvaluator::eval_trace(const DenseMatrix& A)
+    {
+        return dense_trace(A);
+    }
+
+    std::complex<double> DenseFunctionEvaluator::eval_trace_product(
+        const DenseMatrix& A, const DenseMatrix& B
+    )
+    {
+        return dense_trace_product(A, B);
+    }
+
+    void DenseFunctionEvaluator::eval_fun_addition(
+        std::complex<double>& f, const std::complex<double>& g
+    )
+    {
+        f += g;
+    }
+
+    void DenseFunctionEvaluator::eval_fun_scale(
+        const SymEngine::RCP<const SymEngine::Number>& scalar,
+        std::complex<double>& f
+    )
+    {
+        f *= SymEngine::eval_complex_double(*scalar);
+    }
+}
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <string>
+
+#include <symengine/symengine_exception.h>
+
+#include "Tinned/DenseMatrix.hpp"
+
+namespace Tinned
+{
+    DenseMatrix::DenseMatrix(
+        const std::size_t nrows,
+        const std::size_t ncols,
+        const std::vector<std::complex<double>>& values
+    ): nrows_(nrows), ncols_(ncols), values_(values)
+    {
+        if (values_.size()!=nrows_*ncols_) throw SymEngine::SymEngineException(
+            "DenseMatrix::DenseMatrix() got "
+            + std::to_string(values_.size())
+            + " values for a "
+            + std::to_string(nrows_) + "x" + std::to_string(ncols_)
+            + " matrix"
+        );
+    }
+
+    DenseMatrix make_identity_matrix(const std::size_t dimension)
+    {
+        DenseMatrix I(dimension, dimension);
+        for (std::size_t i=0; i<dimension; ++i) I(i, i) = 1.0;
+        return I;
+    }
+
+    void dense_axpy(
+        const std::complex<double>& alpha, const DenseMatrix& X, DenseMatrix& Y
+    )
+    {
+        if (!X.has_same_shape(Y)) throw SymEngine::SymEngineException(
+            "dense_axpy() got matrices of different shapes"
+        );
+        const std::complex<double>* x = X.data();
+        std::complex<double>* y = Y.data();
+        const std::size_t size = X.size();
+        if (alpha==std::complex<double>(1.0)) {
+            for (std::size_t i=0; i<size; ++i) y[i] += x[i];
+        }
+        else {
+            for (std::size_t i=0; i<size; ++i) y[i] += alpha*x[i];
+        }
+    }
+
+    void dense_scal(const std::complex<double>& alpha, DenseMatrix& X)
+    {
+        std::complex<double>* x = X.data();
+        const std::size_t size = X.size();
+        for (std::size_t i=0; i<size; ++i) x[i] *= alpha;
+    }
+
+    void dense_gemm(
+        const std::complex<double>& alpha,
+        const DenseMatrix& A,
+        const DenseMatrix& B,
+        const std::complex<double>& beta,
+        DenseMatrix& C
+    )
+    {
+        if (A.ncols()!=B.nrows() || C.nrows()!=A.nrows() || C.ncols()!=B.ncols())
+            throw SymEngine::SymEngineException(
+                "dense_gemm() got matrices of incompatible shapes"
+            );
+        if (beta==std::complex<double>(0.0)) {
+            std::fill(C.data(), C.data()+C.size(), std::complex<double>(0.0));
+        }
+        else if (beta!=std::complex<double>(1.0)) {
+            dense_scal(beta, C);
+        }
+        if (alpha==std::complex<double>(0.0)) return;
+        // Blocked i-k-j loops so that the innermost loop runs over contiguous
+        // rows of `B` and `C`
+        const std::size_t block = 64;
+        const std::size_t m = A.nrows();
+        const std::size_t n = B.ncols();
+        const std::size_t l = A.ncols();
+        const std::complex<double>* a = A.data();
+        const std::complex<double>* b = B.data();
+        std::complex<double>* c = C.data();
+        for (std::size_t kk=0; kk<l; kk+=block) {
+            const std::size_t k_end = std::min(kk+block, l);
+            for (std::size_t jj=0; jj<n; jj+=block) {
+                const std::size_t j_end = std::min(jj+block, n);
+                for (std::size_t i=0; i<m; ++i) {
+                    std::complex<double>* c_row = c+i*n;
+                    for (std::size_t k=kk; k<k_end; ++k) {
+                        const std::complex<double> a_ik = alpha*a[i*l+k];
+                        if (a_ik==std::complex<double>(0.0)) continue;
+                        const std::complex<double>* b_row = b+k*n;
+                        for (std::size_t j=jj; j<j_end; ++j) c_row[j] += a_ik*b_row[j];
+                    }
+                }
+            }
+        }
+    }
+
+    DenseMatrix dense_multiply(const DenseMatrix& A, const DenseMatrix& B)
+    {
+        DenseMatrix C(A.nrows(), B.ncols());
+        dense_gemm(1.0, A, B, 0.0, C);
+        return C;
+    }
+
+    DenseMatrix dense_adjoint(const DenseMatrix& A)
+    {
+        DenseMatrix B(A.ncols(), A.nrows());
+        for (std::size_t i=0; i<A.nrows(); ++i)
+            for (std::size_t j=0; j<A.ncols(); ++j)
+                B(j, i) = std::conj(A(i, j));
+        return B;
+    }
+
+    DenseMatrix dense_conjugate(const DenseMatrix& A)
+    {
+        DenseMatrix B(A.nrows(), A.ncols());
+        const std::complex<double>* a = A.data();
+        std::complex<double>* b = B.data();
+        const std::size_t size = A.size();
+        for (std::size_t i=0; i<size; ++i) b[i] = std::conj(a[i]);
+        return B;
+    }
+
+    DenseMatrix dense_transpose(const DenseMatrix& A)
+    {
+        DenseMatrix B(A.ncols(), A.nrows());
+        for (std::size_t i=0; i<A.nrows(); ++i)
+            for (std::size_t j=0; j<A.ncols(); ++j)
+                B(j, i) = A(i, j);
+        return B;
+    }
+
+    std::complex<double> dense_trace(const DenseMatrix& A)
+    {
+        if (A.nrows()!=A.ncols()) throw SymEngine::SymEngineException(
+            "dense_trace() got a non-square matrix"
+        );
+        std::complex<double> result = 0.0;
+        for (std::size_t i=0; i<A.nrows(); ++i) result += A(i, i);
+        return result;
+    }
+
+    std::complex<double> dense_trace_product(const DenseMatrix& A, const DenseMatrix& B)
+    {
+        if (A.ncols()!=B.nrows() || A.nrows()!=B.ncols())
+            throw SymEngine::SymEngineException(
+                "dense_trace_product() got matrices of incompatible shapes"
+            );
+        // tr(AB) = \sum_{ij} A_{ij} B_{ji}, loop over rows of `A` and columns
+        // of `B`
+        std::complex<double> result = 0.0;
+        for (std::size_t i=0; i<A.nrows(); ++i)
+            for (std::size_t j=0; j<A.ncols(); ++j)
+                result += A(i, j)*B(j, i);
+        return result;
+    }
+}
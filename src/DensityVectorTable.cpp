@@ -0,0 +1,152 @@
+#include <symengine/add.h>
+#include <symengine/mul.h>
+#include <symengine/pow.h>
+#include <symengine/integer.h>
+#include <symengine/constants.h>
+#include <symengine/matrices/matrix_mul.h>
+#include <symengine/matrices/trace.h>
+#include <symengine/symengine_casts.h>
+#include <symengine/symengine_exception.h>
+
+#include "Tinned/StringifyVisitor.hpp"
+
+#include "Tinned/DensityVectorTable.hpp"
+
+namespace Tinned
+{
+    std::size_t DensityVectorTable::add_state(
+        const SymEngine::RCP<const ElectronicState>& state
+    )
+    {
+        auto iter = idx_states_.find(state);
+        if (iter!=idx_states_.end()) return iter->second;
+        idx_states_.emplace(state, states_.size());
+        states_.push_back(state);
+        return states_.size()-1;
+    }
+
+    std::size_t DensityVectorTable::add_overlap(
+        const SymEngine::RCP<const OneElecOperator>& Omega
+    )
+    {
+        auto iter = idx_overlaps_.find(Omega);
+        if (iter!=idx_overlaps_.end()) return iter->second;
+        idx_overlaps_.emplace(Omega, overlaps_.size());
+        overlaps_.push_back(Omega);
+        return overlaps_.size()-1;
+    }
+
+    std::size_t DensityVectorTable::add_density_vector(
+        const SymEngine::RCP<const SymEngine::Basic>& x
+    )
+    {
+        if (SymEngine::is_a<const SymEngine::Trace>(*x)) {
+            auto arg = x->get_args()[0];
+            if (SymEngine::is_a<const SymEngine::MatrixMul>(*arg)) {
+                auto& op = SymEngine::down_cast<const SymEngine::MatrixMul&>(*arg);
+                auto factors = op.get_factors();
+                if (SymEngine::eq(*op.get_scalar(), *SymEngine::one) &&
+                    factors.size()==2 &&
+                    SymEngine::is_a_sub<const OneElecOperator>(*factors[0]) &&
+                    SymEngine::is_a_sub<const ElectronicState>(*factors[1])) {
+                    auto key = std::make_pair(
+                        add_overlap(SymEngine::rcp_dynamic_cast<const OneElecOperator>(factors[0])),
+                        add_state(SymEngine::rcp_dynamic_cast<const ElectronicState>(factors[1]))
+                    );
+                    auto iter = idx_density_vectors_.find(key);
+                    if (iter!=idx_density_vectors_.end()) return iter->second;
+                    idx_density_vectors_.emplace(key, density_vectors_.size());
+                    density_vectors_.push_back(key);
+                    return density_vectors_.size()-1;
+                }
+            }
+        }
+        throw SymEngine::SymEngineException(
+            "DensityVectorTable::add_density_vector() gets an invalid generalized density vector "
+            + stringify(x)
+        );
+    }
+
+    XcDensityProduct DensityVectorTable::add_density_product(
+        const SymEngine::RCP<const SymEngine::Basic>& x
+    )
+    {
+        XcDensityProduct result;
+        result.coef = SymEngine::one;
+        // Bases and exponents of generalized density vectors
+        SymEngine::vec_basic bases;
+        SymEngine::vec_basic exponents;
+        if (SymEngine::is_a<const SymEngine::Mul>(*x)) {
+            auto& op = SymEngine::down_cast<const SymEngine::Mul&>(*x);
+            result.coef = op.get_coef();
+            for (const auto& p: op.get_dict()) {
+                bases.push_back(p.first);
+                exponents.push_back(p.second);
+            }
+        }
+        else if (SymEngine::is_a<const SymEngine::Pow>(*x)) {
+            auto& op = SymEngine::down_cast<const SymEngine::Pow&>(*x);
+            bases.push_back(op.get_base());
+            exponents.push_back(op.get_exp());
+        }
+        else if (SymEngine::is_a_Number(*x)) {
+            result.coef = SymEngine::rcp_dynamic_cast<const SymEngine::Number>(x);
+        }
+        else {
+            bases.push_back(x);
+            exponents.push_back(SymEngine::one);
+        }
+        for (std::size_t i=0; i<bases.size(); ++i) {
+            if (!SymEngine::is_a<const SymEngine::Integer>(*exponents[i]) ||
+                !SymEngine::down_cast<const SymEngine::Integer&>(*exponents[i]).is_positive())
+                throw SymEngine::SymEngineException(
+                    "DensityVectorTable::add_density_product() gets an invalid exponent "
+                    + stringify(x)
+                );
+            result.factors.push_back(XcDensityFactor{
+                add_density_vector(bases[i]),
+                static_cast<unsigned int>(
+                    SymEngine::down_cast<const SymEngine::Integer&>(*exponents[i]).as_uint()
+                )
+            });
+        }
+        return result;
+    }
+
+    std::vector<XcDensityProduct> DensityVectorTable::add_density_products(
+        const SymEngine::RCP<const SymEngine::Basic>& x
+    )
+    {
+        std::vector<XcDensityProduct> result;
+        if (!x.is_null()) {
+            // Perturbed generalized density vectors are stored as an expanded
+            // sum of products
+            if (SymEngine::is_a<const SymEngine::Add>(*x)) {
+                for (const auto& arg: x->get_args())
+                    result.push_back(add_density_product(arg));
+            }
+            else {
+                result.push_back(add_density_product(x));
+            }
+        }
+        return result;
+    }
+
+    void DensityVectorTable::add_energy_map(const ExcContractionMap& energyMap)
+    {
+        // Ordered entries so that indices do not depend on hashing
+        for (const auto term: get_ordered_entries(energyMap))
+            for (const auto contr: get_ordered_entries(term->second)) {
+                add_density_vector(contr->first->get_inner());
+                add_density_products(contr->second);
+            }
+    }
+
+    void DensityVectorTable::add_potential_map(const VxcContractionMap& potentialMap)
+    {
+        for (const auto energy_map: get_ordered_entries(potentialMap)) {
+            add_overlap(energy_map->first);
+            add_energy_map(energy_map->second);
+        }
+    }
+}
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <vector>
+
+#include <symengine/constants.h>
+#include <symengine/symengine_casts.h>
+#include <symengine/symengine_exception.h>
+
+#include "Tinned/ConjugateTranspose.hpp"
+#include "Tinned/StringifyVisitor.hpp"
+
+#include "Tinned/EvaluationPlanner.hpp"
+
+namespace Tinned
+{
+    std::size_t EvaluationPlanner::get_mul_peak(
+        const std::vector<std::size_t>& factor_peaks,
+        const std::size_t num_factors
+    ) const
+    {
+        auto peak = factor_peaks[0];
+        for (std::size_t i=1; i<num_factors; ++i) {
+            // The product so far is alive during the evaluation of the next
+            // factor, and the multiplication needs both operands and the new
+            // product
+            peak = std::max(peak, 1+factor_peaks[i]);
+            peak = std::max(peak, std::size_t(3));
+        }
+        return peak;
+    }
+
+    void EvaluationPlanner::get_term_peaks(
+        const SymEngine::RCP<const SymEngine::Basic>& x,
+        std::size_t& first_peak,
+        std::size_t& acc_peak
+    )
+    {
+        if (SymEngine::is_a<const SymEngine::MatrixMul>(*x)) {
+            auto& op = SymEngine::down_cast<const SymEngine::MatrixMul&>(*x);
+            auto factors = op.get_factors();
+            std::vector<std::size_t> factor_peaks;
+            factor_peaks.reserve(factors.size());
+            for (const auto& factor: factors) factor_peaks.push_back(apply_(factor));
+            first_peak = get_mul_peak(factor_peaks, factors.size());
+            if (factors.size()==1) {
+                // `eval_oper_axpy()` needs a scaled copy if not fused
+                acc_peak = 1+factor_peaks[0];
+                if (!fused_ && SymEngine::neq(*op.get_scalar(), *SymEngine::one))
+                    acc_peak = std::max(acc_peak, std::size_t(3));
+            }
+            else {
+                // `eval_oper_gemm()` needs a temporary product if not fused
+                acc_peak = std::max(
+                    1+get_mul_peak(factor_peaks, factors.size()-1),
+                    2+factor_peaks.back()
+                );
+                acc_peak = std::max(acc_peak, fused_ ? std::size_t(3) : std::size_t(4));
+            }
+        }
+        else {
+            first_peak = apply_(x);
+            acc_peak = 1+first_peak;
+        }
+    }
+
+    void EvaluationPlanner::bvisit(const SymEngine::Basic& x)
+    {
+        throw SymEngine::NotImplementedError(
+            "EvaluationPlanner::bvisit() not implemented for " + stringify(x)
+        );
+    }
+
+    void EvaluationPlanner::bvisit(const SymEngine::MatrixSymbol& x)
+    {
+        if (SymEngine::is_a_sub<const ConjugateTranspose>(x)) {
+            auto& op = SymEngine::down_cast<const ConjugateTranspose&>(x);
+            result_ = std::max(apply_(op.get_arg()), std::size_t(2));
+        }
+        else {
+            result_ = 1;
+        }
+    }
+
+    void EvaluationPlanner::bvisit(const SymEngine::ConjugateMatrix& x)
+    {
+        result_ = std::max(apply_(x.get_arg()), std::size_t(2));
+    }
+
+    void EvaluationPlanner::bvisit(const SymEngine::Transpose& x)
+    {
+        result_ = std::max(apply_(x.get_arg()), std::size_t(2));
+    }
+
+    void EvaluationPlanner::bvisit(const SymEngine::MatrixAdd& x)
+    {
+        auto args = x.get_args();
+        // Peak numbers of live operators when an argument is evaluated first
+        // or accumulated into the partial sum
+        std::vector<std::size_t> first_peaks;
+        std::vector<std::size_t> acc_peaks;
+        first_peaks.reserve(args.size());
+        acc_peaks.reserve(args.size());
+        for (const auto& arg: args) {
+            std::size_t first_peak, acc_peak;
+            get_term_peaks(arg, first_peak, acc_peak);
+            first_peaks.push_back(first_peak);
+            acc_peaks.push_back(acc_peak);
+        }
+        // The two largest peaks of accumulation, so that the peak of the
+        // addition with any argument evaluated first is known in constant
+        // time
+        std::size_t max_acc = 0;
+        std::size_t second_acc = 0;
+        std::size_t idx_max = 0;
+        for (std::size_t i=0; i<args.size(); ++i) {
+            if (acc_peaks[i]>max_acc) {
+                second_acc = max_acc;
+                max_acc = acc_peaks[i];
+                idx_max = i;
+            }
+            else if (acc_peaks[i]>second_acc) {
+                second_acc = acc_peaks[i];
+            }
+        }
+        std::size_t first = 0;
+        result_ = 0;
+        for (std::size_t i=0; i<args.size(); ++i) {
+            auto peak = std::max(first_peaks[i], i==idx_max ? second_acc : max_acc);
+            if (i==0 || peak<result_) {
+                result_ = peak;
+                first = i;
+            }
+        }
+        plan_[x.rcp_from_this()] = first;
+    }
+
+    void EvaluationPlanner::bvisit(const SymEngine::MatrixMul& x)
+    {
+        // Scaling is performed in place
+        auto factors = x.get_factors();
+        std::vector<std::size_t> factor_peaks;
+        factor_peaks.reserve(factors.size());
+        for (const auto& factor: factors) factor_peaks.push_back(apply_(factor));
+        result_ = get_mul_peak(factor_peaks, factors.size());
+    }
+}
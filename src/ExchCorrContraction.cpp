@@ -1,9 +1,19 @@
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <utility>
+#include <thread>
+#include <vector>
+
+#include <symengine/symengine_config.h>
 #include <symengine/add.h>
 #include <symengine/mul.h>
 #include <symengine/pow.h>
 #include <symengine/number.h>
 #include <symengine/constants.h>
 #include <symengine/matrices/matrix_add.h>
+#include <symengine/matrices/matrix_mul.h>
+#include <symengine/matrices/trace.h>
 #include <symengine/symengine_assert.h>
 #include <symengine/symengine_casts.h>
 #include <symengine/symengine_exception.h>
@@ -13,13 +23,17 @@
 #include "Tinned/CompositeFunction.hpp"
 
 #include "Tinned/KeepVisitor.hpp"
+#include "Tinned/ZerosRemover.hpp"
 
 namespace Tinned
 {
     std::tuple<SymEngine::RCP<const NonElecFunction>,
                SymEngine::RCP<const CompositeFunction>,
                SymEngine::RCP<const SymEngine::Basic>>
-    extract_exc_contraction(const SymEngine::RCP<const SymEngine::Mul>& expr)
+    extract_exc_contraction(
+        const SymEngine::RCP<const SymEngine::Mul>& expr,
+        const bool validate
+    )
     {
         SymEngine::RCP<const NonElecFunction> weight;
         SymEngine::RCP<const CompositeFunction> exc;
@@ -82,6 +96,7 @@ namespace Tinned
             }
             else {
                 auto dens_vectors = SymEngine::mul(factors);
+                if (!validate) return std::make_tuple(weight, exc, dens_vectors);
                 // We need to make sure there is neither grid weights nor XC
                 // functional derivatives in the generalized density vectors
                 auto factors_left = keep_if(
@@ -126,109 +141,362 @@ namespace Tinned
             }
             else {
                 exc_map->second = SymEngine::add(exc_map->second, std::get<2>(value));
+                // Contractions may cancel each other
+                if (is_zero_quantity(exc_map->second)) {
+                    weight_map->second.erase(exc_map);
+                    if (weight_map->second.empty()) energy_map.erase(weight_map);
+                }
             }
         }
     }
 
-    // Extract all terms in a sum of XC energy or its derivatives
-    ExcContractionMap extract_energy_map_(
-        const SymEngine::RCP<const SymEngine::Add>& expr,
-        const SymEngine::RCP<const SymEngine::Number>& coef = SymEngine::one
+    void add_energy_term(
+        ExcContractionMap& energy_map,
+        const SymEngine::RCP<const SymEngine::Basic>& term,
+        const SymEngine::RCP<const SymEngine::Number>& coef,
+        const bool validate
     )
     {
-        ExcContractionMap energy_map;
-        auto sum_energies = expr->get_args();
-        // No coefficient exists in the XC energy derivatives
-        SYMENGINE_ASSERT(
-            !SymEngine::is_a_sub<const SymEngine::Number>(*sum_energies.front())
-        )
-        for (const auto& expr_energy: sum_energies) {
-            SYMENGINE_ASSERT(
-                SymEngine::is_a_sub<const SymEngine::Mul>(*expr_energy)
-            )
-            auto energy = SymEngine::rcp_dynamic_cast<const SymEngine::Mul>(expr_energy);
-            auto args = energy->get_args();
-            // This is another sum of XC energy or its derivatives
+        // Sum of XC energy or its derivatives
+        if (SymEngine::is_a<const SymEngine::Add>(*term)) {
+            for (const auto& arg: term->get_args())
+                add_energy_term(energy_map, arg, coef, validate);
+            return;
+        }
+        if (SymEngine::is_a<const SymEngine::Mul>(*term)) {
+            auto args = term->get_args();
+            // `SymEngine::Add` multiplied by a coefficient (e.g. results from
+            // `keep_if()`)
             if (args.size()==2
                 && SymEngine::is_a_sub<const SymEngine::Number>(*args.front())
                 && SymEngine::is_a_sub<const SymEngine::Add>(*args.back())) {
-                if (energy_map.empty()) {
-                    energy_map = extract_energy_map_(
-                        SymEngine::rcp_dynamic_cast<const SymEngine::Add>(args.back()),
+                add_energy_term(
+                    energy_map,
+                    args.back(),
+                    SymEngine::mulnum(
+                        coef,
                         SymEngine::rcp_dynamic_cast<const SymEngine::Number>(args.front())
-                    );
+                    ),
+                    validate
+                );
+                return;
+            }
+            // A contraction, whose generalized density vectors are expanded
+            // locally
+            std::size_t num_weights = 0;
+            std::size_t num_exc = 0;
+            for (const auto& arg: args) {
+                if (SymEngine::is_a_sub<const NonElecFunction>(*arg)) {
+                    ++num_weights;
                 }
-                else {
-                    merge_energy_map(
-                        energy_map,
-                        extract_energy_map_(
-                            SymEngine::rcp_dynamic_cast<const SymEngine::Add>(args.back()),
-                            SymEngine::rcp_dynamic_cast<const SymEngine::Number>(args.front())
-                        )
-                    );
+                else if (SymEngine::is_a_sub<const CompositeFunction>(*arg)) {
+                    ++num_exc;
                 }
             }
-            else {
-                auto contr_term = coef->is_one()
-                    ? extract_exc_contraction(
-                          SymEngine::rcp_dynamic_cast<const SymEngine::Mul>(expr_energy)
-                      )
-                    : extract_exc_contraction(
-                          SymEngine::rcp_dynamic_cast<const SymEngine::Mul>(
-                              SymEngine::mul(coef, expr_energy)
-                          )
-                      );
+            if (num_weights==1 && num_exc==1) {
+                auto contr_term = extract_exc_contraction(
+                    SymEngine::rcp_dynamic_cast<const SymEngine::Mul>(
+                        coef->is_one() ? term : SymEngine::mul(coef, term)
+                    ),
+                    validate
+                );
+                if (!std::get<2>(contr_term).is_null())
+                    std::get<2>(contr_term) = SymEngine::expand(std::get<2>(contr_term));
                 add_exc_contraction(energy_map, contr_term);
+                return;
             }
         }
-        return energy_map;
+        // Otherwise only this term is expanded so that grid weights and XC
+        // functional derivatives could be collected
+        auto term_expand = SymEngine::expand(
+            coef->is_one() ? term : SymEngine::mul(coef, term)
+        );
+        SymEngine::vec_basic contractions;
+        if (SymEngine::is_a<const SymEngine::Add>(*term_expand)) {
+            contractions = term_expand->get_args();
+        }
+        else {
+            contractions.push_back(term_expand);
+        }
+        for (const auto& contr: contractions) {
+            if (!SymEngine::is_a<const SymEngine::Mul>(*contr))
+                throw SymEngine::SymEngineException(
+                    "Invalid term from the XC energy " + stringify(term)
+                );
+            add_exc_contraction(
+                energy_map,
+                extract_exc_contraction(
+                    SymEngine::rcp_dynamic_cast<const SymEngine::Mul>(contr), validate
+                )
+            );
+        }
     }
 
     ExcContractionMap extract_energy_map(
-        const SymEngine::RCP<const SymEngine::Basic>& expr
+        const SymEngine::RCP<const SymEngine::Basic>& expr,
+        const unsigned int numThreads,
+        const bool validate
     )
     {
-        // We first expand `expr` so that generalized density vectors could be
-        // collected and simplified
-        auto expr_expand = SymEngine::expand(expr);
         // XC energy or its derivatives must be either `SymEngine::Mul` or
-        // `SymEngine::Add`
+        // `SymEngine::Add`. Instead of expanding `expr` as a whole, terms are
+        // added one by one, and only their generalized density vectors are
+        // expanded so that they could be collected and simplified
         SYMENGINE_ASSERT(
-            SymEngine::is_a<const SymEngine::Mul>(*expr_expand) ||
-            SymEngine::is_a<const SymEngine::Add>(*expr_expand)
+            SymEngine::is_a<const SymEngine::Mul>(*expr) ||
+            SymEngine::is_a<const SymEngine::Add>(*expr)
         )
-        // Unperturbed, the first-order case or `SymEngine::Add` multiplied by
-        // a coefficient (e.g. results from `keep_if()`)
-        if (SymEngine::is_a_sub<const SymEngine::Mul>(*expr_expand)) {
-            auto energy = SymEngine::rcp_dynamic_cast<const SymEngine::Mul>(expr_expand);
-            auto args = energy->get_args();
-            if (args.size()==2
-                && SymEngine::is_a_sub<const SymEngine::Number>(*args.front())
-                && SymEngine::is_a_sub<const SymEngine::Add>(*args.back()))
+#if defined(WITH_SYMENGINE_THREAD_SAFE)
+        if (numThreads>1 && SymEngine::is_a<const SymEngine::Add>(*expr)) {
+            auto terms = expr->get_args();
+            const std::size_t num_threads = std::min(std::size_t(numThreads), terms.size());
+            // Contiguous partitions of terms so that the result does not
+            // depend on the scheduling of threads
+            std::vector<ExcContractionMap> maps(num_threads);
+            // Exceptions (for example, from the validation of terms) are
+            // captured by each thread and rethrown after all threads join
+            std::vector<std::exception_ptr> errors(num_threads);
+            auto extract_terms = [&](const std::size_t idx_thread)
+            {
+                try {
+                    auto first = terms.size()*idx_thread/num_threads;
+                    auto last = terms.size()*(idx_thread+1)/num_threads;
+                    for (auto i=first; i<last; ++i)
+                        add_energy_term(maps[idx_thread], terms[i], SymEngine::one, validate);
+                }
+                catch (...) {
+                    errors[idx_thread] = std::current_exception();
+                }
+            };
+            auto rethrow_errors = [&errors]()
             {
-                return extract_energy_map_(
-                    SymEngine::rcp_dynamic_cast<const SymEngine::Add>(args.back()),
-                    SymEngine::rcp_dynamic_cast<const SymEngine::Number>(args.front())
+                for (const auto& error: errors)
+                    if (error) std::rethrow_exception(error);
+            };
+            std::vector<std::thread> threads;
+            for (std::size_t t=1; t<num_threads; ++t)
+                threads.push_back(std::thread(extract_terms, t));
+            extract_terms(0);
+            for (auto& thread: threads) thread.join();
+            rethrow_errors();
+            // Tree reduction, maps at distance `stride` are merged in
+            // parallel at each level
+            for (std::size_t stride=1; stride<num_threads; stride*=2) {
+                threads.clear();
+                for (std::size_t t=0; t+stride<num_threads; t+=2*stride)
+                    threads.push_back(std::thread(
+                        [&maps, &errors, t, stride]()
+                        {
+                            try {
+                                merge_energy_map(maps[t], maps[t+stride]);
+                            }
+                            catch (...) {
+                                errors[t] = std::current_exception();
+                            }
+                        }
+                    ));
+                for (auto& thread: threads) thread.join();
+                rethrow_errors();
+            }
+            return maps.front();
+        }
+#endif
+        ExcContractionMap energy_map;
+        add_energy_term(energy_map, expr, SymEngine::one, validate);
+        return energy_map;
+    }
+
+    void validate_energy_map(const ExcContractionMap& energy_map)
+    {
+        for (const auto& weight_map: energy_map)
+            for (const auto& exc_map: weight_map.second) {
+                if (exc_map.second.is_null()) continue;
+                auto factors_left = keep_if(
+                    exc_map.second, SymEngine::set_basic({weight_map.first, exc_map.first})
+                );
+                if (!factors_left.is_null()) throw SymEngine::SymEngineException(
+                    "Invalid grid weights and/or XC functional derivatives "
+                    + stringify(factors_left)
+                    + " in "
+                    + stringify(exc_map.second)
                 );
             }
+    }
+
+    // Differentiate a generalized density vector, and return terms of the
+    // derivative
+    SymEngine::vec_basic diff_density_vector(
+        const SymEngine::RCP<const SymEngine::Basic>& x,
+        const SymEngine::RCP<const SymEngine::Symbol>& s
+    )
+    {
+        SymEngine::vec_basic result;
+        // tr(Omega*D)^{s} = tr(Omega^{s}*D) + tr(Omega*D^{s})
+        if (SymEngine::is_a<const SymEngine::Trace>(*x)) {
+            auto arg = x->get_args()[0];
+            if (SymEngine::is_a<const SymEngine::MatrixMul>(*arg)) {
+                auto& op = SymEngine::down_cast<const SymEngine::MatrixMul&>(*arg);
+                auto factors = op.get_factors();
+                if (SymEngine::eq(*op.get_scalar(), *SymEngine::one) &&
+                    factors.size()==2 &&
+                    SymEngine::is_a_sub<const OneElecOperator>(*factors[0]) &&
+                    SymEngine::is_a_sub<const ElectronicState>(*factors[1])) {
+                    auto Omega = SymEngine::rcp_dynamic_cast<const OneElecOperator>(factors[0]);
+                    auto state = SymEngine::rcp_dynamic_cast<const ElectronicState>(factors[1]);
+                    auto Omega_diff = Omega->diff(s);
+                    if (SymEngine::is_a_sub<const OneElecOperator>(*Omega_diff))
+                        result.push_back(make_density_vector(
+                            state,
+                            SymEngine::rcp_dynamic_cast<const OneElecOperator>(Omega_diff)
+                        ));
+                    auto state_diff = state->diff(s);
+                    if (SymEngine::is_a_sub<const ElectronicState>(*state_diff))
+                        result.push_back(make_density_vector(
+                            SymEngine::rcp_dynamic_cast<const ElectronicState>(state_diff),
+                            Omega
+                        ));
+                    return result;
+                }
+            }
+        }
+        // Other forms, for example, after the elimination of perturbed
+        // density matrices
+        auto x_diff = remove_zeros(x->diff(s));
+        if (!x_diff.is_null()) {
+            x_diff = SymEngine::expand(x_diff);
+            if (SymEngine::is_a<const SymEngine::Add>(*x_diff)) {
+                result = x_diff->get_args();
+            }
             else {
-                auto contr_term = extract_exc_contraction(energy);
-                return ExcContractionMap({
-                    {
-                        std::get<0>(contr_term),
-                        ExcDensityContractionMap({
-                            {std::get<1>(contr_term), std::get<2>(contr_term)}
-                        })
-                    }
-                });
+                result.push_back(x_diff);
             }
         }
-        // Perturbed case
-        else {
-            return extract_energy_map_(
-                SymEngine::rcp_dynamic_cast<const SymEngine::Add>(expr_expand)
-            );
+        return result;
+    }
+
+    // Get terms of a sum of products of generalized density vectors
+    inline SymEngine::vec_basic get_density_terms(
+        const SymEngine::RCP<const SymEngine::Basic>& x
+    )
+    {
+        if (SymEngine::is_a<const SymEngine::Add>(*x)) return x->get_args();
+        return SymEngine::vec_basic({x});
+    }
+
+    // Differentiate a sum of products of generalized density vectors term by
+    // term, and return nullptr if the derivative is zero
+    SymEngine::RCP<const SymEngine::Basic> diff_density_vectors(
+        const SymEngine::RCP<const SymEngine::Basic>& x,
+        const SymEngine::RCP<const SymEngine::Symbol>& s
+    )
+    {
+        SymEngine::vec_basic result;
+        for (const auto& term: get_density_terms(x)) {
+            // Coefficient, generalized density vectors and their exponents of
+            // the term
+            SymEngine::RCP<const SymEngine::Basic> coef = SymEngine::one;
+            std::vector<std::pair<SymEngine::RCP<const SymEngine::Basic>,
+                                  SymEngine::RCP<const SymEngine::Basic>>> factors;
+            if (SymEngine::is_a<const SymEngine::Mul>(*term)) {
+                auto& op = SymEngine::down_cast<const SymEngine::Mul&>(*term);
+                coef = op.get_coef();
+                for (const auto& p: op.get_dict()) factors.push_back(p);
+            }
+            else if (SymEngine::is_a<const SymEngine::Pow>(*term)) {
+                auto& op = SymEngine::down_cast<const SymEngine::Pow&>(*term);
+                factors.push_back(std::make_pair(op.get_base(), op.get_exp()));
+            }
+            else if (SymEngine::is_a_Number(*term)) {
+                continue;
+            }
+            else {
+                factors.push_back(std::make_pair(term, SymEngine::one));
+            }
+            // (c*\prod_{j}x_{j}^{k_{j}})^{s}
+            //   = \sum_{i}c*k_{i}*x_{i}^{k_{i}-1}*x_{i}^{s}*\prod_{j!=i}x_{j}^{k_{j}}
+            for (std::size_t i=0; i<factors.size(); ++i) {
+                auto base_diff = diff_density_vector(factors[i].first, s);
+                if (base_diff.empty()) continue;
+                SymEngine::vec_basic args({coef, factors[i].second});
+                if (SymEngine::neq(*factors[i].second, *SymEngine::one))
+                    args.push_back(SymEngine::pow(
+                        factors[i].first, SymEngine::sub(factors[i].second, SymEngine::one)
+                    ));
+                for (std::size_t j=0; j<factors.size(); ++j)
+                    if (j!=i) args.push_back(
+                        SymEngine::pow(factors[j].first, factors[j].second)
+                    );
+                for (const auto& dens_vector: base_diff) {
+                    auto term_args = args;
+                    term_args.push_back(dens_vector);
+                    result.push_back(SymEngine::mul(term_args));
+                }
+            }
+        }
+        if (result.empty()) return SymEngine::RCP<const SymEngine::Basic>();
+        return SymEngine::add(result);
+    }
+
+    ExcContractionMap diff_energy_map(
+        const ExcContractionMap& energy_map,
+        const SymEngine::RCP<const SymEngine::Symbol>& s
+    )
+    {
+        ExcContractionMap result;
+        for (const auto& weight_map: energy_map) {
+            // Derivative of grid weight is either a `NonElecFunction` object
+            // or zero
+            auto weight_diff = weight_map.first->diff(s);
+            auto has_weight_diff = SymEngine::is_a_sub<const NonElecFunction>(*weight_diff);
+            for (const auto& exc_map: weight_map.second) {
+                auto exc = exc_map.first;
+                auto dens_vectors = exc_map.second;
+                // w^{s}*exc*rho
+                if (has_weight_diff) add_exc_contraction(
+                    result,
+                    std::make_tuple(
+                        SymEngine::rcp_dynamic_cast<const NonElecFunction>(weight_diff),
+                        exc,
+                        dens_vectors
+                    )
+                );
+                // w*exc^{(n+1)}*rho^{s}*rho, where rho^{s} is the derivative
+                // of the unperturbed generalized density vector, and each of
+                // its terms opens a new block in the Faa di Bruno formula
+                auto inner_diff = diff_density_vector(exc->get_inner(), s);
+                if (!inner_diff.empty()) {
+                    SymEngine::vec_basic terms;
+                    for (const auto& dens_vector: inner_diff) {
+                        if (dens_vectors.is_null()) {
+                            terms.push_back(dens_vector);
+                        }
+                        else {
+                            for (const auto& term: get_density_terms(dens_vectors))
+                                terms.push_back(SymEngine::mul(dens_vector, term));
+                        }
+                    }
+                    add_exc_contraction(
+                        result,
+                        std::make_tuple(
+                            weight_map.first,
+                            SymEngine::make_rcp<const CompositeFunction>(
+                                exc->get_name(), exc->get_inner(), exc->get_order()+1
+                            ),
+                            SymEngine::add(terms)
+                        )
+                    );
+                }
+                // w*exc*(rho)^{s}, which adds the perturbation to an existing
+                // block
+                if (!dens_vectors.is_null()) {
+                    auto dens_diff = diff_density_vectors(dens_vectors, s);
+                    if (!dens_diff.is_null()) add_exc_contraction(
+                        result, std::make_tuple(weight_map.first, exc, dens_diff)
+                    );
+                }
+            }
         }
+        return result;
     }
 
     void merge_energy_map(ExcContractionMap& map1, const ExcContractionMap& map2)
@@ -250,8 +518,11 @@ namespace Tinned
                         exc_map1->second = SymEngine::add(
                             exc_map1->second, exc_map2.second
                         );
+                        if (is_zero_quantity(exc_map1->second))
+                            weight_map1->second.erase(exc_map1);
                     }
                 }
+                if (weight_map1->second.empty()) map1.erase(weight_map1);
             }
         }
     }
@@ -391,6 +662,31 @@ namespace Tinned
         }
     }
 
+    VxcContractionMap diff_potential_map(
+        const VxcContractionMap& potential_map,
+        const SymEngine::RCP<const SymEngine::Symbol>& s
+    )
+    {
+        VxcContractionMap result;
+        for (const auto& energy_map: potential_map) {
+            // (E*Omega)^{s} = E^{s}*Omega + E*Omega^{s}
+            auto energy_diff = diff_energy_map(energy_map.second, s);
+            if (!energy_diff.empty()) merge_potential_map(
+                result, VxcContractionMap({{energy_map.first, energy_diff}})
+            );
+            auto Omega_diff = energy_map.first->diff(s);
+            if (SymEngine::is_a_sub<const OneElecOperator>(*Omega_diff))
+                merge_potential_map(
+                    result,
+                    VxcContractionMap({{
+                        SymEngine::rcp_dynamic_cast<const OneElecOperator>(Omega_diff),
+                        energy_map.second
+                    }})
+                );
+        }
+        return result;
+    }
+
     SymEngine::RCP<const SymEngine::MatrixExpr> convert_potential_map(
         const VxcContractionMap& potential_map
     )
@@ -398,10 +694,10 @@ namespace Tinned
         SymEngine::vec_basic factors = {};
         // `energy_map.first` is the (un)perturbed generalized overlap
         // distribution, and `energy_map.second` is type `ExcContractionMap`
-        for (const auto& energy_map: potential_map) {
+        for (const auto energy_map: get_ordered_entries(potential_map)) {
             factors.push_back(
                 SymEngine::matrix_mul({
-                    convert_energy_map(energy_map.second), energy_map.first
+                    convert_energy_map(energy_map->second), energy_map->first
                 })
             );
         }
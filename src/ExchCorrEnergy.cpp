@@ -13,7 +13,13 @@ namespace Tinned
         const SymEngine::RCP<const NonElecFunction>& weight,
         const unsigned int order
     ) : SymEngine::FunctionWrapper(name, SymEngine::vec_basic({weight, state, Omega})),
-        energy_(SymEngine::mul(weight, make_exc_density(state, Omega, order)))
+        energy_map_({
+            {weight, ExcDensityContractionMap({
+                {make_exc_density(state, Omega, order), SymEngine::RCP<const SymEngine::Basic>()}
+            })}
+        }),
+        energy_(convert_energy_map(energy_map_)),
+        has_metadata_(false)
     {
         SYMENGINE_ASSIGN_TYPEID()
     }
@@ -22,7 +28,13 @@ namespace Tinned
         const ExchCorrEnergy& other,
         const SymEngine::RCP<const SymEngine::Symbol>& s
     ) : SymEngine::FunctionWrapper(other.get_name(), other.get_args()),
-        energy_(remove_zeros(other.energy_->diff(s)))
+        energy_map_(diff_energy_map(other.energy_map_, s)),
+        energy_(
+            energy_map_.empty()
+                ? SymEngine::RCP<const SymEngine::Basic>(SymEngine::zero)
+                : convert_energy_map(energy_map_)
+        ),
+        has_metadata_(false)
     {
         SYMENGINE_ASSIGN_TYPEID()
     }
@@ -34,11 +46,35 @@ namespace Tinned
         const SymEngine::RCP<const NonElecFunction>& weight,
         const SymEngine::RCP<const SymEngine::Basic>& energy
     ) : SymEngine::FunctionWrapper(name, SymEngine::vec_basic({weight, state, Omega})),
-        energy_(canonicalize_xc_energy(remove_zeros(energy)))
+        energy_map_(extract_energy_map(remove_zeros(energy))),
+        energy_(convert_energy_map(energy_map_)),
+        has_metadata_(false)
     {
         SYMENGINE_ASSIGN_TYPEID()
     }
 
+    void ExchCorrEnergy::find_metadata() const
+    {
+        if (has_metadata_) return;
+        weights_ = find_all(energy_, get_weight());
+        states_ = find_all(energy_, get_state());
+        overlaps_ = find_all(energy_, get_overlap_distribution());
+        for (const auto& e: find_all(energy_, make_exc_density(get_state(), get_overlap_distribution(), 0))) {
+            SYMENGINE_ASSERT(SymEngine::is_a_sub<const CompositeFunction>(*e))
+            exc_orders_.insert(
+                SymEngine::down_cast<const CompositeFunction&>(*e).get_order()
+            );
+        }
+        // Derivatives of the electronic state with the highest order
+        for (const auto& state: states_) {
+            SYMENGINE_ASSERT(SymEngine::is_a_sub<const ElectronicState>(*state))
+            auto derivatives
+                = SymEngine::down_cast<const ElectronicState&>(*state).get_derivatives();
+            if (derivatives.size()>derivatives_.size()) derivatives_ = std::move(derivatives);
+        }
+        has_metadata_ = true;
+    }
+
     SymEngine::hash_t ExchCorrEnergy::__hash__() const
     {
         SymEngine::hash_t seed = SymEngine::FunctionWrapper::__hash__();
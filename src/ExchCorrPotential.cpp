@@ -3,6 +3,7 @@
 #include <symengine/symengine_casts.h>
 
 #include "Tinned/ExchCorrPotential.hpp"
+#include "Tinned/ZeroOperator.hpp"
 #include "Tinned/ZerosRemover.hpp"
 
 namespace Tinned
@@ -18,13 +19,16 @@ namespace Tinned
         state_(state),
         Omega_(Omega),
         weight_(weight),
-        potential_(SymEngine::matrix_mul(
-            SymEngine::vec_basic({
-                // Order for the XC potential is 1
-                SymEngine::mul(weight, make_exc_density(state, Omega, 1)),
-                Omega
-            })
-        ))
+        potential_map_({
+            {Omega, ExcContractionMap({
+                {weight, ExcDensityContractionMap({
+                    // Order for the XC potential is 1
+                    {make_exc_density(state, Omega, 1), SymEngine::RCP<const SymEngine::Basic>()}
+                })}
+            })}
+        }),
+        potential_(convert_potential_map(potential_map_)),
+        has_metadata_(false)
     {
         SYMENGINE_ASSIGN_TYPEID()
     }
@@ -36,9 +40,13 @@ namespace Tinned
         state_(other.state_),
         Omega_(other.Omega_),
         weight_(other.weight_),
-        potential_(SymEngine::rcp_dynamic_cast<const SymEngine::MatrixExpr>(
-            remove_zeros(other.potential_->diff(s))
-        ))
+        potential_map_(diff_potential_map(other.potential_map_, s)),
+        potential_(
+            potential_map_.empty()
+                ? SymEngine::RCP<const SymEngine::MatrixExpr>(make_zero_operator())
+                : convert_potential_map(potential_map_)
+        ),
+        has_metadata_(false)
     {
         SYMENGINE_ASSIGN_TYPEID()
     }
@@ -53,13 +61,37 @@ namespace Tinned
         state_(state),
         Omega_(Omega),
         weight_(weight),
+        potential_map_(extract_potential_map(potential)),
         potential_(SymEngine::rcp_dynamic_cast<const SymEngine::MatrixExpr>(
-            remove_zeros(canonicalize_xc_potential(potential))
-        ))
+            remove_zeros(convert_potential_map(potential_map_))
+        )),
+        has_metadata_(false)
     {
         SYMENGINE_ASSIGN_TYPEID()
     }
 
+    void ExchCorrPotential::find_metadata() const
+    {
+        if (has_metadata_) return;
+        weights_ = find_all(potential_, get_weight());
+        states_ = find_all(potential_, get_state());
+        overlaps_ = find_all(potential_, get_overlap_distribution());
+        for (const auto& e: find_all(potential_, make_exc_density(state_, Omega_, 1))) {
+            SYMENGINE_ASSERT(SymEngine::is_a_sub<const CompositeFunction>(*e))
+            exc_orders_.insert(
+                SymEngine::down_cast<const CompositeFunction&>(*e).get_order()
+            );
+        }
+        // Derivatives of the electronic state with the highest order
+        for (const auto& state: states_) {
+            SYMENGINE_ASSERT(SymEngine::is_a_sub<const ElectronicState>(*state))
+            auto derivatives
+                = SymEngine::down_cast<const ElectronicState&>(*state).get_derivatives();
+            if (derivatives.size()>derivatives_.size()) derivatives_ = std::move(derivatives);
+        }
+        has_metadata_ = true;
+    }
+
     SymEngine::hash_t ExchCorrPotential::__hash__() const
     {
         SymEngine::hash_t seed = SymEngine::MatrixSymbol::__hash__();
@@ -0,0 +1,74 @@
+#include <symengine/add.h>
+#include <symengine/mul.h>
+#include <symengine/pow.h>
+#include <symengine/subs.h>
+#include <symengine/symengine_assert.h>
+#include <symengine/symengine_casts.h>
+
+#include "Tinned/FrequencyBinding.hpp"
+
+namespace Tinned
+{
+    FrequencyPlaceholder::FrequencyPlaceholder(
+        const SymEngine::RCP<const Perturbation>& perturbation
+    ) : SymEngine::Symbol("omega_" + perturbation->get_name()),
+        perturbation_(perturbation)
+    {
+        SYMENGINE_ASSIGN_TYPEID()
+    }
+
+    SymEngine::hash_t FrequencyPlaceholder::__hash__() const
+    {
+        SymEngine::hash_t seed = SymEngine::Symbol::__hash__();
+        SymEngine::hash_combine(seed, *perturbation_);
+        return seed;
+    }
+
+    bool FrequencyPlaceholder::__eq__(const SymEngine::Basic& o) const
+    {
+        if (SymEngine::is_a<const FrequencyPlaceholder>(o)) {
+            auto& s = SymEngine::down_cast<const FrequencyPlaceholder&>(o);
+            return perturbation_->__eq__(*s.perturbation_);
+        }
+        return false;
+    }
+
+    int FrequencyPlaceholder::compare(const SymEngine::Basic& o) const
+    {
+        // Only called for objects of the same type code
+        SYMENGINE_ASSERT(SymEngine::is_a<const FrequencyPlaceholder>(o))
+        auto& s = SymEngine::down_cast<const FrequencyPlaceholder&>(o);
+        return perturbation_->compare(*s.perturbation_);
+    }
+
+    void FrequencyBinding::bind(
+        const SymEngine::RCP<const Perturbation>& perturbation,
+        const SymEngine::RCP<const SymEngine::Number>& frequency
+    )
+    {
+        frequencies_[make_frequency_placeholder(perturbation)] = frequency;
+    }
+
+    SymEngine::RCP<const SymEngine::Number> FrequencyBinding::get_frequency(
+        const SymEngine::RCP<const Perturbation>& perturbation
+    ) const
+    {
+        auto frequency = frequencies_.find(make_frequency_placeholder(perturbation));
+        if (frequency==frequencies_.end()) return perturbation->get_frequency();
+        return SymEngine::rcp_dynamic_cast<const SymEngine::Number>(frequency->second);
+    }
+
+    SymEngine::RCP<const SymEngine::Number> FrequencyBinding::apply(
+        const SymEngine::RCP<const SymEngine::Basic>& x
+    ) const
+    {
+        if (SymEngine::is_a_Number(*x))
+            return SymEngine::rcp_dynamic_cast<const SymEngine::Number>(x);
+        if (frequencies_.empty() || !is_frequency_expression(*x))
+            return SymEngine::RCP<const SymEngine::Number>();
+        auto result = SymEngine::expand(x->subs(frequencies_));
+        if (SymEngine::is_a_Number(*result))
+            return SymEngine::rcp_dynamic_cast<const SymEngine::Number>(result);
+        return SymEngine::RCP<const SymEngine::Number>();
+    }
+}
@@ -0,0 +1,212 @@
+#include <utility>
+
+#include <symengine/pow.h>
+#include <symengine/symengine_casts.h>
+#include <symengine/symengine_exception.h>
+
+#include "Tinned/PerturbedParameter.hpp"
+#include "Tinned/ConjugateTranspose.hpp"
+
+#include "Tinned/OneElecDensity.hpp"
+#include "Tinned/OneElecOperator.hpp"
+#include "Tinned/TwoElecEnergy.hpp"
+#include "Tinned/TwoElecOperator.hpp"
+#include "Tinned/CompositeFunction.hpp"
+#include "Tinned/ExchCorrEnergy.hpp"
+#include "Tinned/ExchCorrPotential.hpp"
+#include "Tinned/NonElecFunction.hpp"
+#include "Tinned/TemporumOperator.hpp"
+#include "Tinned/TemporumOverlap.hpp"
+
+#include "Tinned/AdjointMap.hpp"
+#include "Tinned/ClusterConjHamiltonian.hpp"
+
+#include "Tinned/StringifyVisitor.hpp"
+
+#include "Tinned/ManifestVisitor.hpp"
+
+namespace Tinned
+{
+    LeafManifest ManifestVisitor::apply(const SymEngine::RCP<const SymEngine::Basic>& x)
+    {
+        leaves_.clear();
+        counts_.clear();
+        x->accept(*this);
+        LeafManifest result;
+        for (const auto& leaf: leaves_) {
+            LeafKind kind;
+            std::string name;
+            std::size_t order;
+            if (SymEngine::is_a_sub<const OneElecOperator>(*leaf)) {
+                auto& op = SymEngine::down_cast<const OneElecOperator&>(*leaf);
+                kind = LeafKind::OneElecOperator;
+                name = op.get_name();
+                order = op.get_derivatives().size();
+            }
+            else if (SymEngine::is_a_sub<const TwoElecOperator>(*leaf)) {
+                auto& op = SymEngine::down_cast<const TwoElecOperator&>(*leaf);
+                kind = LeafKind::TwoElecOperator;
+                name = op.get_name();
+                order = op.get_derivatives().size()
+                      + op.get_state()->get_derivatives().size();
+            }
+            else if (SymEngine::is_a_sub<const ExchCorrEnergy>(*leaf)) {
+                auto& op = SymEngine::down_cast<const ExchCorrEnergy&>(*leaf);
+                kind = LeafKind::ExchCorrEnergy;
+                name = op.get_name();
+                order = op.get_derivatives().size();
+            }
+            else if (SymEngine::is_a_sub<const ExchCorrPotential>(*leaf)) {
+                auto& op = SymEngine::down_cast<const ExchCorrPotential&>(*leaf);
+                kind = LeafKind::ExchCorrPotential;
+                name = op.get_name();
+                order = op.get_derivatives().size();
+            }
+            else if (SymEngine::is_a_sub<const NonElecFunction>(*leaf)) {
+                auto& op = SymEngine::down_cast<const NonElecFunction&>(*leaf);
+                kind = LeafKind::NonElecFunction;
+                name = op.get_name();
+                order = op.get_derivatives().size();
+            }
+            else {
+                auto& op = SymEngine::down_cast<const TemporumOverlap&>(*leaf);
+                kind = LeafKind::TemporumOverlap;
+                name = op.get_name();
+                order = op.get_derivatives().size();
+            }
+            result[std::make_pair(kind, name)][order].push_back(
+                ManifestLeaf{leaf, counts_.at(leaf)}
+            );
+        }
+        return result;
+    }
+
+    void ManifestVisitor::bvisit(const SymEngine::Basic& x)
+    {
+        throw SymEngine::NotImplementedError(
+            "ManifestVisitor::bvisit() not implemented for " + stringify(x)
+        );
+    }
+
+    void ManifestVisitor::bvisit(const SymEngine::Symbol& x)
+    {
+    }
+
+    void ManifestVisitor::bvisit(const SymEngine::Number& x)
+    {
+    }
+
+    void ManifestVisitor::bvisit(const SymEngine::Add& x)
+    {
+        for (const auto& p: x.get_dict()) apply_(p.first);
+    }
+
+    void ManifestVisitor::bvisit(const SymEngine::Mul& x)
+    {
+        for (const auto& p: x.get_dict()) {
+            apply_(p.first);
+            apply_(p.second);
+        }
+    }
+
+    void ManifestVisitor::bvisit(const SymEngine::Constant& x)
+    {
+    }
+
+    void ManifestVisitor::bvisit(const SymEngine::FunctionSymbol& x)
+    {
+        if (SymEngine::is_a_sub<const NonElecFunction>(x)) {
+            add_leaf(x.rcp_from_this());
+        }
+        else if (SymEngine::is_a_sub<const TwoElecEnergy>(x)) {
+            auto& op = SymEngine::down_cast<const TwoElecEnergy&>(x);
+            add_leaf(op.get_2el_operator());
+        }
+        else if (SymEngine::is_a_sub<const CompositeFunction>(x)) {
+            auto& op = SymEngine::down_cast<const CompositeFunction&>(x);
+            apply_(op.get_inner());
+        }
+        else if (SymEngine::is_a_sub<const ExchCorrEnergy>(x)) {
+            add_leaf(x.rcp_from_this());
+        }
+        else {
+            throw SymEngine::NotImplementedError(
+                "ManifestVisitor::bvisit() not implemented for FunctionSymbol " + stringify(x)
+            );
+        }
+    }
+
+    void ManifestVisitor::bvisit(const SymEngine::ZeroMatrix& x)
+    {
+    }
+
+    void ManifestVisitor::bvisit(const SymEngine::MatrixSymbol& x)
+    {
+        // Response parameters are not leaves
+        if (SymEngine::is_a_sub<const PerturbedParameter>(x) ||
+            SymEngine::is_a_sub<const OneElecDensity>(x)) {
+            return;
+        }
+        else if (SymEngine::is_a_sub<const ConjugateTranspose>(x)) {
+            auto& op = SymEngine::down_cast<const ConjugateTranspose&>(x);
+            apply_(op.get_arg());
+        }
+        else if (SymEngine::is_a_sub<const OneElecOperator>(x) ||
+                 SymEngine::is_a_sub<const TwoElecOperator>(x) ||
+                 SymEngine::is_a_sub<const ExchCorrPotential>(x) ||
+                 SymEngine::is_a_sub<const TemporumOverlap>(x)) {
+            add_leaf(x.rcp_from_this());
+        }
+        else if (SymEngine::is_a_sub<const TemporumOperator>(x)) {
+            auto& op = SymEngine::down_cast<const TemporumOperator&>(x);
+            apply_(op.get_target());
+        }
+        else if (SymEngine::is_a_sub<const AdjointMap>(x)) {
+            auto& op = SymEngine::down_cast<const AdjointMap&>(x);
+            for (auto arg: op.get_x()) apply_(arg);
+            apply_(op.get_y());
+        }
+        else if (SymEngine::is_a_sub<const ClusterConjHamiltonian>(x)) {
+            auto& op = SymEngine::down_cast<const ClusterConjHamiltonian&>(x);
+            apply_(op.get_cluster_operator());
+            apply_(op.get_hamiltonian());
+        }
+        else {
+            throw SymEngine::NotImplementedError(
+                "ManifestVisitor::bvisit() not implemented for MatrixSymbol " + stringify(x)
+            );
+        }
+    }
+
+    void ManifestVisitor::bvisit(const SymEngine::Trace& x)
+    {
+        apply_(x.get_args()[0]);
+    }
+
+    void ManifestVisitor::bvisit(const SymEngine::ConjugateMatrix& x)
+    {
+        apply_(x.get_arg());
+    }
+
+    void ManifestVisitor::bvisit(const SymEngine::Transpose& x)
+    {
+        apply_(x.get_arg());
+    }
+
+    void ManifestVisitor::bvisit(const SymEngine::MatrixAdd& x)
+    {
+        for (auto arg: x.get_args()) apply_(arg);
+    }
+
+    void ManifestVisitor::bvisit(const SymEngine::MatrixMul& x)
+    {
+        for (auto arg: x.get_args()) apply_(arg);
+    }
+
+    void ManifestVisitor::bvisit(const SymEngine::MatrixDerivative& x)
+    {
+        throw SymEngine::NotImplementedError(
+            "ManifestVisitor::bvisit() not implemented for MatrixDerivative " + stringify(x)
+        );
+    }
+}
@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <thread>
+
+#include <symengine/symengine_exception.h>
+
+#include "Tinned/StringifyVisitor.hpp"
+
+#include "Tinned/NLevelAtom.hpp"
+
+namespace Tinned
+{
+    NLevelOperator::NLevelOperator(
+        const std::pair<SymEngine::RCP<const OneElecOperator>, DenseMatrix>& H0,
+        const std::map<SymEngine::RCP<const OneElecOperator>,
+                       DenseMatrix,
+                       SymEngine::RCPBasicKeyLess>& V,
+        const std::pair<SymEngine::RCP<const OneElecDensity>, DenseMatrix>& rho0,
+        const unsigned int numThreads
+    ) : H0_(H0), rho0_(rho0), V_(V)
+    {
+        const double threshold = 1.0e-10;
+        const auto dimension = H0_.second.nrows();
+        // Unperturbed Hamiltonian should be diagonal
+        if (H0_.second.ncols()!=dimension) throw SymEngine::SymEngineException(
+            "Unperturbed Hamiltonian isn't square: " + stringify(H0_.first)
+        );
+        for (std::size_t i=0; i<dimension; ++i)
+            for (std::size_t j=0; j<dimension; ++j)
+                if (i!=j && std::abs(H0_.second(i, j))>threshold)
+                    throw SymEngine::SymEngineException(
+                        "Unperturbed Hamiltonian isn't diagonal: " + stringify(H0_.first)
+                    );
+        // Density matrix should be idempotent
+        if (!rho0_.second.has_same_shape(H0_.second)) throw SymEngine::SymEngineException(
+            "Density matrix has an invalid shape: " + stringify(rho0_.first)
+        );
+        auto Z = dense_multiply(rho0_.second, rho0_.second);
+        dense_axpy(-1.0, rho0_.second, Z);
+        for (std::size_t i=0; i<Z.size(); ++i)
+            if (std::abs(Z.data()[i])>threshold) throw SymEngine::SymEngineException(
+                "Density matrix isn't idempotent: " + stringify(rho0_.first)
+            );
+        // Occupation numbers are used for resonant elements of density
+        // matrix derivatives
+        bool diagonal = true;
+        for (std::size_t i=0; i<dimension; ++i)
+            for (std::size_t j=0; j<dimension; ++j)
+                if (i!=j && std::abs(rho0_.second(i, j))>threshold) diagonal = false;
+        if (diagonal)
+            for (std::size_t i=0; i<dimension; ++i)
+                occupations_.push_back(rho0_.second(i, i).real());
+        omega_ = DenseMatrix(dimension, dimension);
+        for (std::size_t i=0; i<dimension; ++i)
+            for (std::size_t j=0; j<dimension; ++j)
+                omega_(i, j) = H0_.second(i, i)-H0_.second(j, j);
+        for (const auto& oper: V_) {
+            auto dependencies = oper.first->get_dependencies();
+            if (dependencies.size()!=1) throw SymEngine::SymEngineException(
+                "Each field operator should only depend on one perturbation: " + stringify(oper.first)
+            );
+            if (!oper.second.has_same_shape(H0_.second)) throw SymEngine::SymEngineException(
+                "Field operator has an invalid shape: " + stringify(oper.first)
+            );
+            if (!field_indices_.insert(
+                std::make_pair(dependencies.begin()->first, field_values_.size())
+            ).second) throw SymEngine::SymEngineException(
+                "Field operators should depend on different perturbations: " + stringify(oper.first)
+            );
+            field_values_.push_back(oper.second);
+        }
+        num_threads_ = numThreads>0
+                     ? numThreads : std::max(1u, std::thread::hardware_concurrency());
+        rho_derivatives_.emplace(SymEngine::multiset_basic(), rho0_.second);
+    }
+
+    const DenseMatrix& NLevelOperator::get_rho_derivative(
+        const SymEngine::multiset_basic& derivatives
+    )
+    {
+        auto rho = rho_derivatives_.find(derivatives);
+        if (rho!=rho_derivatives_.end()) return rho->second;
+        // Distinct perturbations and their multiplicities, identical
+        // perturbations are adjacent in `derivatives`
+        SymEngine::vec_basic perturbations;
+        std::vector<std::size_t> multiplicities;
+        std::vector<std::size_t> idx_fields;
+        for (const auto& p: derivatives) {
+            if (perturbations.empty() || SymEngine::neq(*perturbations.back(), *p)) {
+                auto field = field_indices_.find(p);
+                if (field==field_indices_.end()) throw SymEngine::SymEngineException(
+                    "Invalid perturbation for the external field " + stringify(p)
+                );
+                perturbations.push_back(p);
+                multiplicities.push_back(1);
+                idx_fields.push_back(field->second);
+            }
+            else {
+                ++multiplicities.back();
+            }
+        }
+        // All sub-multisets of `derivatives` grouped by their orders, each
+        // sub-multiset is represented by multiplicities of the distinct
+        // perturbations
+        std::vector<std::vector<std::vector<std::size_t>>> sub_multisets(derivatives.size()+1);
+        std::vector<std::size_t> counts(perturbations.size(), 0);
+        while (true) {
+            std::size_t order = 0;
+            for (const auto& c: counts) order += c;
+            sub_multisets[order].push_back(counts);
+            std::size_t k = 0;
+            while (k<counts.size() && counts[k]==multiplicities[k]) {
+                counts[k] = 0;
+                ++k;
+            }
+            if (k==counts.size()) break;
+            ++counts[k];
+        }
+        auto make_key = [&](const std::vector<std::size_t>& subCounts)
+        {
+            SymEngine::multiset_basic key;
+            for (std::size_t k=0; k<perturbations.size(); ++k)
+                for (std::size_t n=0; n<subCounts[k]; ++n)
+                    key.insert(perturbations[k]);
+            return key;
+        };
+        // Term `n_x [V_x, rho^{S\x}]`
+        struct Commutator
+        {
+            double multiplicity;
+            const DenseMatrix* field;
+            const DenseMatrix* rho;
+        };
+        // Term `c_A rho^{A}*rho^{S\A}` from the idempotency
+        struct Product
+        {
+            double coefficient;
+            const DenseMatrix* left;
+            const DenseMatrix* right;
+        };
+        const double threshold = 1.0e-10;
+        const auto dimension = omega_.nrows();
+        for (std::size_t order=1; order<=derivatives.size(); ++order) {
+            // Density matrix derivatives of this order to be computed, all
+            // the work touching SymEngine objects is done here so that
+            // threads work only on dense matrices
+            std::vector<SymEngine::multiset_basic> keys;
+            std::vector<std::complex<double>> freq_sums;
+            std::vector<std::vector<Commutator>> commutators;
+            // Resonant elements (as p*N+q) and the idempotency terms
+            // determining them
+            std::vector<std::vector<std::size_t>> resonances;
+            std::vector<std::vector<Product>> products;
+            for (const auto& sub_counts: sub_multisets[order]) {
+                auto key = make_key(sub_counts);
+                if (rho_derivatives_.find(key)!=rho_derivatives_.end()) continue;
+                std::vector<Commutator> terms;
+                for (std::size_t k=0; k<perturbations.size(); ++k) {
+                    if (sub_counts[k]==0) continue;
+                    auto lower_key = key;
+                    lower_key.erase(lower_key.find(perturbations[k]));
+                    terms.push_back({
+                        double(sub_counts[k]),
+                        &field_values_[idx_fields[k]],
+                        &rho_derivatives_.at(lower_key)
+                    });
+                }
+                // Bound frequencies are used if available
+                auto freq_sum = get_frequency_sum_value(key);
+                std::vector<std::size_t> resonant_elements;
+                for (std::size_t p=0; p<dimension; ++p)
+                    for (std::size_t q=0; q<dimension; ++q) {
+                        if (std::abs(freq_sum-omega_(p, q))>threshold) continue;
+                        if (occupations_.empty() ||
+                            std::abs(1.0-occupations_[p]-occupations_[q])<threshold) {
+                            std::string str_derivatives;
+                            for (const auto& pert: key) str_derivatives += stringify(pert) + ",";
+                            throw SymEngine::SymEngineException(
+                                "Resonant element (" + std::to_string(p) + ", "
+                                + std::to_string(q) + ") of density matrix derivative: "
+                                + str_derivatives
+                            );
+                        }
+                        resonant_elements.push_back(p*dimension+q);
+                    }
+                // rho^{A} and rho^{S\A} are of lower orders and have been
+                // computed
+                std::vector<Product> idempotency;
+                if (!resonant_elements.empty()) {
+                    for (std::size_t lower_order=1; lower_order<order; ++lower_order)
+                        for (const auto& lower_counts: sub_multisets[lower_order]) {
+                            double coefficient = 1.0;
+                            std::vector<std::size_t> remaining_counts(sub_counts);
+                            for (std::size_t k=0; k<sub_counts.size(); ++k) {
+                                if (lower_counts[k]>sub_counts[k]) {
+                                    coefficient = 0.0;
+                                    break;
+                                }
+                                remaining_counts[k] -= lower_counts[k];
+                                for (std::size_t n=0; n<lower_counts[k]; ++n)
+                                    coefficient *= double(sub_counts[k]-n)/double(n+1);
+                            }
+                            if (coefficient==0.0) continue;
+                            idempotency.push_back({
+                                coefficient,
+                                &rho_derivatives_.at(make_key(lower_counts)),
+                                &rho_derivatives_.at(make_key(remaining_counts))
+                            });
+                        }
+                }
+                freq_sums.push_back(freq_sum);
+                commutators.push_back(terms);
+                resonances.push_back(resonant_elements);
+                products.push_back(idempotency);
+                keys.push_back(key);
+            }
+            std::vector<DenseMatrix> values(keys.size(), DenseMatrix(dimension, dimension));
+            auto eval_rho = [&](const std::size_t idx_thread, const std::size_t num_threads)
+            {
+                for (std::size_t i=idx_thread; i<keys.size(); i+=num_threads) {
+                    auto& rho = values[i];
+                    for (const auto& term: commutators[i]) {
+                        dense_gemm(term.multiplicity, *term.field, *term.rho, 1.0, rho);
+                        dense_gemm(-term.multiplicity, *term.rho, *term.field, 1.0, rho);
+                    }
+                    for (std::size_t p=0; p<dimension; ++p)
+                        for (std::size_t q=0; q<dimension; ++q) {
+                            auto denominator = freq_sums[i]-omega_(p, q);
+                            if (std::abs(denominator)>threshold) rho(p, q) /= denominator;
+                        }
+                    for (const auto pq: resonances[i]) {
+                        const auto p = pq/dimension;
+                        const auto q = pq%dimension;
+                        std::complex<double> value = 0.0;
+                        for (const auto& term: products[i])
+                            for (std::size_t l=0; l<dimension; ++l)
+                                value += term.coefficient*(*term.left)(p, l)*(*term.right)(l, q);
+                        rho(p, q) = value/(1.0-occupations_[p]-occupations_[q]);
+                    }
+                }
+            };
+            const std::size_t num_threads = std::min(std::size_t(num_threads_), keys.size());
+            if (num_threads>1) {
+                std::vector<std::thread> threads;
+                for (std::size_t t=1; t<num_threads; ++t)
+                    threads.push_back(std::thread(eval_rho, t, num_threads));
+                eval_rho(0, num_threads);
+                for (auto& thread: threads) thread.join();
+            }
+            else {
+                eval_rho(0, 1);
+            }
+            for (std::size_t i=0; i<keys.size(); ++i)
+                rho_derivatives_.emplace(keys[i], std::move(values[i]));
+        }
+        return rho_derivatives_.at(derivatives);
+    }
+
+    void NLevelOperator::set_frequency_binding(const FrequencyBinding& binding)
+    {
+        DenseOperatorEvaluator::set_frequency_binding(binding);
+        rho_derivatives_.clear();
+        rho_derivatives_.emplace(SymEngine::multiset_basic(), rho0_.second);
+    }
+
+    DenseMatrix NLevelOperator::eval_1el_density(const OneElecDensity& x)
+    {
+        if (x.get_name()==rho0_.first->get_name())
+            return get_rho_derivative(x.get_derivatives());
+        return DenseOperatorEvaluator::eval_1el_density(x);
+    }
+
+    DenseMatrix NLevelOperator::eval_1el_operator(const OneElecOperator& x)
+    {
+        const auto dimension = omega_.nrows();
+        if (x.get_name()==H0_.first->get_name()) {
+            if (x.get_derivatives().empty()) return H0_.second;
+            return DenseMatrix(dimension, dimension);
+        }
+        for (const auto& oper: V_) {
+            if (x.get_name()==oper.first->get_name()) {
+                // Field strengths vanish for the unperturbed system, and field
+                // operators are linear in their perturbations
+                if (x.get_derivatives().size()==1) return oper.second;
+                return DenseMatrix(dimension, dimension);
+            }
+        }
+        return DenseOperatorEvaluator::eval_1el_operator(x);
+    }
+}
@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <string>
+#include <utility>
+
+#include <symengine/symengine_exception.h>
+
+#include "Tinned/StringifyVisitor.hpp"
+
+#include "Tinned/NLevelFrequencyScan.hpp"
+
+namespace Tinned
+{
+    void NLevelFrequencyScan::scan(
+        const SymEngine::vec_basic& perturbations,
+        const std::vector<std::vector<std::complex<double>>>& frequencies
+    )
+    {
+        const auto num_perts = perturbations.size();
+        if (frequencies.size()!=num_perts) throw SymEngine::SymEngineException(
+            "NLevelFrequencyScan::scan() gets inconsistent numbers of perturbations and frequencies"
+        );
+        if (num_perts>=sizeof(std::size_t)*CHAR_BIT) throw SymEngine::SymEngineException(
+            "NLevelFrequencyScan::scan() gets too many perturbations "
+            + std::to_string(num_perts)
+        );
+        num_points_ = num_perts>0 ? frequencies.front().size() : 0;
+        // Field operators and frequencies (as real and imaginary parts) of
+        // perturbations
+        std::vector<const DenseMatrix*> fields;
+        std::vector<std::vector<double>> freq_real(num_perts, std::vector<double>(num_points_));
+        std::vector<std::vector<double>> freq_imag(num_perts, std::vector<double>(num_points_));
+        for (std::size_t k=0; k<num_perts; ++k) {
+            auto field = field_indices_.find(perturbations[k]);
+            if (field==field_indices_.end()) throw SymEngine::SymEngineException(
+                "Invalid perturbation for the external field " + stringify(perturbations[k])
+            );
+            fields.push_back(&field_values_[field->second]);
+            if (frequencies[k].size()!=num_points_) throw SymEngine::SymEngineException(
+                "NLevelFrequencyScan::scan() gets inconsistent numbers of frequency points for "
+                + stringify(perturbations[k])
+            );
+            for (std::size_t p=0; p<num_points_; ++p) {
+                freq_real[k][p] = frequencies[k][p].real();
+                freq_imag[k][p] = frequencies[k][p].imag();
+            }
+        }
+
+        const double threshold = 1.0e-10;
+        const auto dimension = omega_.nrows();
+        const auto size = dimension*dimension*num_points_;
+        const std::size_t num_subsets = std::size_t(1)<<num_perts;
+        rho_real_.assign(num_subsets, std::vector<double>());
+        rho_imag_.assign(num_subsets, std::vector<double>());
+        // Unperturbed density matrix is the same for all points
+        rho_real_[0].resize(size);
+        rho_imag_[0].resize(size);
+        for (std::size_t ij=0; ij<dimension*dimension; ++ij) {
+            auto val_rho = rho0_.data()[ij];
+            for (std::size_t p=0; p<num_points_; ++p) {
+                rho_real_[0][ij*num_points_+p] = val_rho.real();
+                rho_imag_[0][ij*num_points_+p] = val_rho.imag();
+            }
+        }
+
+        // Each subset S only needs its subsets S\x, which have smaller bit
+        // masks and have been computed
+        std::vector<double> w_real(num_points_);
+        std::vector<double> w_imag(num_points_);
+        for (std::size_t mask=1; mask<num_subsets; ++mask) {
+            std::vector<double> val_real(size, 0.0);
+            std::vector<double> val_imag(size, 0.0);
+            std::fill(w_real.begin(), w_real.end(), 0.0);
+            std::fill(w_imag.begin(), w_imag.end(), 0.0);
+            for (std::size_t k=0; k<num_perts; ++k) {
+                if (!(mask&(std::size_t(1)<<k))) continue;
+                for (std::size_t p=0; p<num_points_; ++p) {
+                    w_real[p] += freq_real[k][p];
+                    w_imag[p] += freq_imag[k][p];
+                }
+                // [V_x, rho^{S\x}]_ij = \sum_l V_il*rho_lj - rho_il*V_lj
+                const auto& V = *fields[k];
+                const auto& lower_real = rho_real_[mask^(std::size_t(1)<<k)];
+                const auto& lower_imag = rho_imag_[mask^(std::size_t(1)<<k)];
+                for (std::size_t i=0; i<dimension; ++i)
+                    for (std::size_t j=0; j<dimension; ++j) {
+                        double* out_real = &val_real[(i*dimension+j)*num_points_];
+                        double* out_imag = &val_imag[(i*dimension+j)*num_points_];
+                        for (std::size_t l=0; l<dimension; ++l) {
+                            const double v_il_real = V(i, l).real();
+                            const double v_il_imag = V(i, l).imag();
+                            const double v_lj_real = V(l, j).real();
+                            const double v_lj_imag = V(l, j).imag();
+                            const double* rho_lj_real = &lower_real[(l*dimension+j)*num_points_];
+                            const double* rho_lj_imag = &lower_imag[(l*dimension+j)*num_points_];
+                            const double* rho_il_real = &lower_real[(i*dimension+l)*num_points_];
+                            const double* rho_il_imag = &lower_imag[(i*dimension+l)*num_points_];
+                            for (std::size_t p=0; p<num_points_; ++p) {
+                                out_real[p] += v_il_real*rho_lj_real[p]
+                                             - v_il_imag*rho_lj_imag[p]
+                                             - rho_il_real[p]*v_lj_real
+                                             + rho_il_imag[p]*v_lj_imag;
+                                out_imag[p] += v_il_real*rho_lj_imag[p]
+                                             + v_il_imag*rho_lj_real[p]
+                                             - rho_il_real[p]*v_lj_imag
+                                             - rho_il_imag[p]*v_lj_real;
+                            }
+                        }
+                    }
+            }
+            // Resonant elements (w_S = W_ij) at different points, which are
+            // determined by the idempotency as in `NLevelOperator`
+            std::vector<std::pair<std::size_t, std::size_t>> resonances;
+            for (std::size_t ij=0; ij<dimension*dimension; ++ij) {
+                const auto i = ij/dimension;
+                const auto j = ij%dimension;
+                for (std::size_t p=0; p<num_points_; ++p) {
+                    if (std::abs(std::complex<double>(w_real[p], w_imag[p])-omega_.data()[ij])>threshold)
+                        continue;
+                    if (occupations_.empty() ||
+                        std::abs(1.0-occupations_[i]-occupations_[j])<threshold)
+                        throw SymEngine::SymEngineException(
+                            "NLevelFrequencyScan::scan() gets resonant element ("
+                            + std::to_string(i) + ", " + std::to_string(j)
+                            + ") at point " + std::to_string(p)
+                        );
+                    resonances.push_back(std::make_pair(ij, p));
+                }
+            }
+            // Divide by (w_S-W_ij), resonant elements are overwritten below
+            for (std::size_t ij=0; ij<dimension*dimension; ++ij) {
+                const double omega_real = omega_.data()[ij].real();
+                const double omega_imag = omega_.data()[ij].imag();
+                double* out_real = &val_real[ij*num_points_];
+                double* out_imag = &val_imag[ij*num_points_];
+                for (std::size_t p=0; p<num_points_; ++p) {
+                    const double den_real = w_real[p]-omega_real;
+                    const double den_imag = w_imag[p]-omega_imag;
+                    const double den_norm = den_real*den_real+den_imag*den_imag;
+                    const double inv_norm = den_norm>0.0 ? 1.0/den_norm : 0.0;
+                    const double num_real = out_real[p];
+                    const double num_imag = out_imag[p];
+                    out_real[p] = (num_real*den_real+num_imag*den_imag)*inv_norm;
+                    out_imag[p] = (num_imag*den_real-num_real*den_imag)*inv_norm;
+                }
+            }
+            // (1-n_i-n_j) rho^{S}_ij = \sum_{A} (rho^{A}*rho^{S\A})_ij, where A
+            // runs over proper non-empty subsets of S
+            for (const auto& resonance: resonances) {
+                const auto i = resonance.first/dimension;
+                const auto j = resonance.first%dimension;
+                const auto p = resonance.second;
+                double sum_real = 0.0;
+                double sum_imag = 0.0;
+                for (std::size_t sub=(mask-1)&mask; sub>0; sub=(sub-1)&mask) {
+                    const auto& left_real = rho_real_[sub];
+                    const auto& left_imag = rho_imag_[sub];
+                    const auto& right_real = rho_real_[mask^sub];
+                    const auto& right_imag = rho_imag_[mask^sub];
+                    for (std::size_t l=0; l<dimension; ++l) {
+                        const auto il = (i*dimension+l)*num_points_+p;
+                        const auto lj = (l*dimension+j)*num_points_+p;
+                        sum_real += left_real[il]*right_real[lj]-left_imag[il]*right_imag[lj];
+                        sum_imag += left_real[il]*right_imag[lj]+left_imag[il]*right_real[lj];
+                    }
+                }
+                const double coefficient = 1.0-occupations_[i]-occupations_[j];
+                val_real[resonance.first*num_points_+p] = sum_real/coefficient;
+                val_imag[resonance.first*num_points_+p] = sum_imag/coefficient;
+            }
+            rho_real_[mask] = std::move(val_real);
+            rho_imag_[mask] = std::move(val_imag);
+        }
+    }
+
+    DenseMatrix NLevelFrequencyScan::get_rho_derivative(const std::size_t idxPoint) const
+    {
+        if (idxPoint>=num_points_) throw SymEngine::SymEngineException(
+            "NLevelFrequencyScan::get_rho_derivative() gets an invalid point "
+            + std::to_string(idxPoint)
+        );
+        const auto& val_real = rho_real_.back();
+        const auto& val_imag = rho_imag_.back();
+        DenseMatrix result(omega_.nrows(), omega_.ncols());
+        for (std::size_t ij=0; ij<result.size(); ++ij)
+            result.data()[ij] = std::complex<double>(
+                val_real[ij*num_points_+idxPoint], val_imag[ij*num_points_+idxPoint]
+            );
+        return result;
+    }
+
+    std::vector<std::complex<double>> NLevelFrequencyScan::get_response(
+        const DenseMatrix& A
+    ) const
+    {
+        if (!A.has_same_shape(omega_)) throw SymEngine::SymEngineException(
+            "NLevelFrequencyScan::get_response() gets an operator with invalid shape"
+        );
+        std::vector<double> result_real(num_points_, 0.0);
+        std::vector<double> result_imag(num_points_, 0.0);
+        if (!rho_real_.empty()) {
+            const auto dimension = omega_.nrows();
+            const auto& val_real = rho_real_.back();
+            const auto& val_imag = rho_imag_.back();
+            // tr(A*rho) = \sum_ij A_ji*rho_ij
+            for (std::size_t i=0; i<dimension; ++i)
+                for (std::size_t j=0; j<dimension; ++j) {
+                    const double a_real = A(j, i).real();
+                    const double a_imag = A(j, i).imag();
+                    const double* rho_real = &val_real[(i*dimension+j)*num_points_];
+                    const double* rho_imag = &val_imag[(i*dimension+j)*num_points_];
+                    for (std::size_t p=0; p<num_points_; ++p) {
+                        result_real[p] += a_real*rho_real[p]-a_imag*rho_imag[p];
+                        result_imag[p] += a_real*rho_imag[p]+a_imag*rho_real[p];
+                    }
+                }
+        }
+        std::vector<std::complex<double>> result(num_points_);
+        for (std::size_t p=0; p<num_points_; ++p)
+            result[p] = std::complex<double>(result_real[p], result_imag[p]);
+        return result;
+    }
+}
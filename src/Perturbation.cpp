@@ -1,4 +1,5 @@
 #include <symengine/complex.h>
+#include <symengine/eval_double.h>
 //#include <symengine/complex_double.h>
 //#include <symengine/complex_mpc.h>
 #include <symengine/symengine_assert.h>
@@ -14,6 +15,7 @@ namespace Tinned
         const std::set<std::size_t>& components
     ) : SymEngine::Symbol(name),
         frequency_(frequency),
+        frequency_value_(SymEngine::eval_complex_double(*frequency)),
         components_(components)
     {
         SYMENGINE_ASSIGN_TYPEID()
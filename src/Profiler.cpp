@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include <symengine/symengine_exception.h>
+
+#include "Tinned/Profiler.hpp"
+
+namespace Tinned
+{
+    // Escape a string for JSON
+    static std::string escape_json(const std::string& str)
+    {
+        std::string result;
+        result.reserve(str.size());
+        for (auto c: str) {
+            switch (c) {
+                case '"':
+                    result += "\\\"";
+                    break;
+                case '\\':
+                    result += "\\\\";
+                    break;
+                case '\n':
+                    result += "\\n";
+                    break;
+                case '\t':
+                    result += "\\t";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(c)<0x20) {
+                        char code[8];
+                        std::snprintf(
+                            code, sizeof(code), "\\u%04x",
+                            static_cast<unsigned int>(static_cast<unsigned char>(c))
+                        );
+                        result += code;
+                    }
+                    else {
+                        result += c;
+                    }
+            }
+        }
+        return result;
+    }
+
+    Profiler& Profiler::instance()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    void Profiler::add_call(
+        const std::string& name,
+        const Clock::time_point& start,
+        const Clock::time_point& end
+    )
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& record = records_[name];
+        ++record.num_calls;
+        record.wall_time += std::chrono::duration<double>(end-start).count();
+        if (trace_) {
+            if (events_.size()>=max_events_) {
+                ++num_dropped_events_;
+                return;
+            }
+            auto thread = threads_.insert(
+                std::make_pair(std::this_thread::get_id(), threads_.size())
+            ).first->second;
+            events_.push_back(TraceEvent({name, start, end, thread}));
+        }
+    }
+
+    void Profiler::add_flops(const std::string& name, const double flops)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        records_[name].flops += flops;
+    }
+
+    void Profiler::set_trace(const bool trace, const std::size_t maxEvents)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        trace_ = trace;
+        max_events_ = maxEvents;
+    }
+
+    std::size_t Profiler::get_num_events() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return events_.size();
+    }
+
+    std::size_t Profiler::get_num_dropped_events() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return num_dropped_events_;
+    }
+
+    void Profiler::reset()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        origin_ = Clock::now();
+        records_.clear();
+        events_.clear();
+        num_dropped_events_ = 0;
+        threads_.clear();
+    }
+
+    std::map<std::string, ProfileRecord> Profiler::get_records() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return records_;
+    }
+
+    std::string Profiler::get_summary() const
+    {
+        auto records = get_records();
+        std::vector<std::pair<std::string, ProfileRecord>> sorted_records(
+            records.begin(), records.end()
+        );
+        std::stable_sort(
+            sorted_records.begin(),
+            sorted_records.end(),
+            [](const std::pair<std::string, ProfileRecord>& a,
+               const std::pair<std::string, ProfileRecord>& b) -> bool
+            {
+                return a.second.wall_time>b.second.wall_time;
+            }
+        );
+        std::size_t width = 6;
+        for (const auto& record: sorted_records)
+            width = std::max(width, record.first.size());
+        std::ostringstream summary;
+        char line[128];
+        summary << "Region" << std::string(width-6, ' ');
+        std::snprintf(
+            line, sizeof(line), " %12s %14s %14s %14s %12s\n",
+            "Calls", "Time (s)", "Average (us)", "FLOPs", "GFLOP/s"
+        );
+        summary << line;
+        for (const auto& record: sorted_records) {
+            auto num_calls = record.second.num_calls;
+            auto wall_time = record.second.wall_time;
+            auto flops = record.second.flops;
+            summary << record.first << std::string(width-record.first.size(), ' ');
+            std::snprintf(
+                line, sizeof(line), " %12zu %14.6f %14.3f %14.6e %12.3f\n",
+                num_calls,
+                wall_time,
+                num_calls>0 ? 1.0e6*wall_time/num_calls : 0.0,
+                flops,
+                wall_time>0.0 ? 1.0e-9*flops/wall_time : 0.0
+            );
+            summary << line;
+        }
+        return summary.str();
+    }
+
+    void Profiler::write_chrome_trace(const std::string& filename) const
+    {
+        std::ofstream file(filename);
+        if (!file) throw SymEngine::SymEngineException(
+            "Profiler::write_chrome_trace() could not open " + filename
+        );
+        std::lock_guard<std::mutex> lock(mutex_);
+        file << "{\"traceEvents\":[";
+        bool first = true;
+        for (const auto& event: events_) {
+            if (!first) file << ",";
+            first = false;
+            auto start = std::chrono::duration<double, std::micro>(
+                event.start-origin_
+            ).count();
+            auto duration = std::chrono::duration<double, std::micro>(
+                event.end-event.start
+            ).count();
+            file << "\n{\"name\":\"" << escape_json(event.name)
+                 << "\",\"cat\":\"tinned\",\"ph\":\"X\",\"ts\":" << start
+                 << ",\"dur\":" << duration
+                 << ",\"pid\":0,\"tid\":" << event.thread << "}";
+        }
+        file << "\n],\"displayTimeUnit\":\"ms\""
+             << ",\"otherData\":{\"droppedEvents\":" << num_dropped_events_ << "}}\n";
+    }
+}
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <utility>
+
+#include <symengine/symengine_casts.h>
+#include <symengine/symengine_exception.h>
+
+#include "Tinned/ElectronicState.hpp"
+#include "Tinned/PerturbedParameter.hpp"
+#include "Tinned/PertTuple.hpp"
+#include "Tinned/FindAllVisitor.hpp"
+#include "Tinned/StringifyVisitor.hpp"
+
+#include "Tinned/ResponseSchedule.hpp"
+
+namespace Tinned
+{
+    SymEngine::multiset_basic ResponseSchedule::get_parameter_derivatives(
+        const SymEngine::RCP<const SymEngine::Basic>& x
+    )
+    {
+        if (SymEngine::is_a_sub<const ElectronicState>(*x)) {
+            return SymEngine::down_cast<const ElectronicState&>(*x).get_derivatives();
+        }
+        else if (SymEngine::is_a_sub<const PerturbedParameter>(*x)) {
+            return SymEngine::down_cast<const PerturbedParameter&>(*x).get_derivatives();
+        }
+        else {
+            throw SymEngine::SymEngineException(
+                "ResponseSchedule() gets an invalid response parameter " + stringify(x)
+            );
+        }
+    }
+
+    bool ResponseSchedule::is_sub_multiset(
+        const SymEngine::multiset_basic& x, const SymEngine::multiset_basic& y
+    )
+    {
+        if (x.size()>y.size()) return false;
+        for (auto iter=x.begin(); iter!=x.end(); iter=x.upper_bound(*iter))
+            if (x.count(*iter)>y.count(*iter)) return false;
+        return true;
+    }
+
+    void ResponseSchedule::add_solve(
+        const SymEngine::vec_basic& parameters,
+        const std::size_t idxParameter,
+        const SymEngine::multiset_basic& derivatives,
+        std::vector<ResponseSolve>& solves
+    )
+    {
+        for (const auto& solve: solves)
+            if (solve.idx_parameter==idxParameter &&
+                SymEngine::unified_eq(solve.derivatives, derivatives)) return;
+        ResponseSolve solve;
+        solve.parameter = differentiate(parameters[idxParameter], derivatives);
+        solve.idx_parameter = idxParameter;
+        solve.derivatives = derivatives;
+        solve.frequency = get_frequency_sum(derivatives);
+        solve.level = 0;
+        solves.push_back(std::move(solve));
+        // Enumerate non-empty sub-multisets by the numbers of distinct
+        // perturbations
+        SymEngine::vec_basic perturbations;
+        std::vector<std::size_t> max_counts;
+        for (auto iter=derivatives.begin(); iter!=derivatives.end();
+             iter=derivatives.upper_bound(*iter)) {
+            perturbations.push_back(*iter);
+            max_counts.push_back(derivatives.count(*iter));
+        }
+        std::vector<std::size_t> counts(perturbations.size(), 0);
+        while (true) {
+            std::size_t k = 0;
+            for (; k<counts.size() && counts[k]==max_counts[k]; ++k) counts[k] = 0;
+            if (k==counts.size()) break;
+            ++counts[k];
+            SymEngine::multiset_basic sub_derivatives;
+            for (std::size_t i=0; i<counts.size(); ++i)
+                for (std::size_t n=0; n<counts[i]; ++n)
+                    sub_derivatives.insert(perturbations[i]);
+            if (sub_derivatives.size()<derivatives.size())
+                add_solve(parameters, idxParameter, sub_derivatives, solves);
+            for (std::size_t j=0; j<idxParameter; ++j)
+                add_solve(parameters, j, sub_derivatives, solves);
+        }
+    }
+
+    ResponseSchedule::ResponseSchedule(
+        const SymEngine::RCP<const SymEngine::Basic>& expr,
+        const SymEngine::vec_basic& parameters
+    )
+    {
+        std::vector<ResponseSolve> solves;
+        for (std::size_t i=0; i<parameters.size(); ++i) {
+            if (!get_parameter_derivatives(parameters[i]).empty())
+                throw SymEngine::SymEngineException(
+                    "ResponseSchedule() gets a perturbed response parameter "
+                    + stringify(parameters[i])
+                );
+            for (const auto& x: find_all(expr, parameters[i])) {
+                auto derivatives = get_parameter_derivatives(x);
+                if (!derivatives.empty()) add_solve(parameters, i, derivatives, solves);
+            }
+        }
+        // Lower order derivatives and previous parameters first
+        std::sort(solves.begin(), solves.end(),
+            [](const ResponseSolve& x, const ResponseSolve& y) -> bool {
+                if (x.derivatives.size()!=y.derivatives.size())
+                    return x.derivatives.size()<y.derivatives.size();
+                if (x.idx_parameter!=y.idx_parameter)
+                    return x.idx_parameter<y.idx_parameter;
+                return std::lexicographical_compare(
+                    x.derivatives.begin(), x.derivatives.end(),
+                    y.derivatives.begin(), y.derivatives.end(),
+                    SymEngine::RCPBasicKeyLess()
+                );
+            }
+        );
+        for (std::size_t i=0; i<solves.size(); ++i) {
+            auto& solve = solves[i];
+            for (std::size_t j=0; j<i; ++j) {
+                const auto& prev = solves[j];
+                if ((prev.idx_parameter==solve.idx_parameter &&
+                     prev.derivatives.size()<solve.derivatives.size()) ||
+                    prev.idx_parameter<solve.idx_parameter) {
+                    if (is_sub_multiset(prev.derivatives, solve.derivatives)) {
+                        solve.prerequisites.push_back(j);
+                        solve.level = std::max(solve.level, prev.level+1);
+                    }
+                }
+            }
+        }
+        // Group solves by levels and frequencies
+        for (std::size_t i=0; i<solves.size(); ++i) {
+            bool not_found = true;
+            for (auto& group: groups_) {
+                const auto& first = solves[group.front()];
+                if (first.level==solves[i].level &&
+                    SymEngine::eq(*first.frequency, *solves[i].frequency)) {
+                    group.push_back(i);
+                    not_found = false;
+                    break;
+                }
+            }
+            if (not_found) groups_.push_back(std::vector<std::size_t>({i}));
+        }
+        std::stable_sort(groups_.begin(), groups_.end(),
+            [&](const std::vector<std::size_t>& x, const std::vector<std::size_t>& y) -> bool {
+                return solves[x.front()].level<solves[y.front()].level;
+            }
+        );
+        solves_ = std::move(solves);
+    }
+}
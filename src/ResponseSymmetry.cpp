@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "Tinned/StringifyVisitor.hpp"
+
+#include "Tinned/ResponseSymmetry.hpp"
+
+namespace Tinned
+{
+    ResponseSymmetry::ResponseSymmetry(
+        const std::vector<SymEngine::RCP<const Perturbation>>& perturbations
+    ): perturbations_(perturbations),
+       layout_(SymEngine::multiset_basic(perturbations.begin(), perturbations.end()))
+    {
+        std::size_t size = 1;
+        for (const auto& p: perturbations_) {
+            auto components = p->get_components();
+            std::vector<std::size_t> candidates(components.begin(), components.end());
+            if (candidates.empty()) candidates.push_back(0);
+            size *= candidates.size();
+            components_.push_back(std::move(candidates));
+        }
+        // Group positions of equivalent perturbations following the order
+        // of distinct perturbations in the layout
+        for (const auto& q: layout_.get_perturbations())
+            for (std::size_t i=0; i<perturbations_.size(); ++i)
+                if (perturbations_[i]->__eq__(*q)) positions_.push_back(i);
+        // Map components of the full tensor to unique ones
+        idx_unique_.reserve(size);
+        representatives_.assign(layout_.size(), size);
+        multiplicities_.assign(layout_.size(), 0);
+        std::vector<std::size_t> grouped(perturbations_.size());
+        for (std::size_t index=0; index<size; ++index) {
+            auto components = get_components(index);
+            for (std::size_t i=0; i<positions_.size(); ++i)
+                grouped[i] = components[positions_[i]];
+            auto idx_unique = layout_.get_index(grouped);
+            if (multiplicities_[idx_unique]==0) representatives_[idx_unique] = index;
+            ++multiplicities_[idx_unique];
+            idx_unique_.push_back(idx_unique);
+        }
+    }
+
+    std::vector<std::size_t> ResponseSymmetry::get_components(std::size_t index) const
+    {
+        std::vector<std::size_t> components(perturbations_.size(), 0);
+        for (std::size_t p=perturbations_.size(); p-->0;) {
+            components[p] = components_[p][index%components_[p].size()];
+            index /= components_[p].size();
+        }
+        if (index>0) throw SymEngine::SymEngineException(
+            "ResponseSymmetry::get_components() gets an invalid index"
+        );
+        return components;
+    }
+
+    std::size_t ResponseSymmetry::get_index(const std::vector<std::size_t>& components) const
+    {
+        if (components.size()!=perturbations_.size()) throw SymEngine::SymEngineException(
+            "ResponseSymmetry::get_index() gets "
+            + std::to_string(components.size())
+            + " components instead of "
+            + std::to_string(perturbations_.size())
+        );
+        std::size_t index = 0;
+        for (std::size_t p=0; p<perturbations_.size(); ++p) {
+            auto iter = std::lower_bound(
+                components_[p].begin(), components_[p].end(), components[p]
+            );
+            if (iter==components_[p].end() || *iter!=components[p])
+                throw SymEngine::SymEngineException(
+                    "ResponseSymmetry::get_index() gets an invalid component of "
+                    + stringify(perturbations_[p])
+                );
+            index = index*components_[p].size() + (iter-components_[p].begin());
+        }
+        return index;
+    }
+}
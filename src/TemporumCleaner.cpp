@@ -81,6 +81,17 @@ namespace Tinned
         }
         else if (SymEngine::is_a_sub<const TemporumOperator>(x)) {
             auto& op = SymEngine::down_cast<const TemporumOperator&>(x);
+            if (symbolic_) {
+                if (op.get_derivatives().empty()) {
+                    result_ = make_zero_operator();
+                }
+                else {
+                    result_ = SymEngine::matrix_mul(
+                        {op.get_frequency_placeholder(), op.get_target()}
+                    );
+                }
+                return;
+            }
             // For unperturbed `TemporumOperator` objects, the function
             // `get_frequency()` will return zero frequency
             auto frequency = op.get_frequency();
@@ -96,7 +107,14 @@ namespace Tinned
             // `TemporumOverlap` will disappear if it is unperturbed or all
             // perturbations have zero frequencies
             for (std::size_t i=0; i<op.size(); ++i) {
-                if (!is_zero_number(op.get_frequency(i), threshold_)) {
+                if (symbolic_) {
+                    auto derivatives = op.get_derivatives(i);
+                    if (!derivatives.first.empty() || !derivatives.second.empty()) {
+                        result_ = x.rcp_from_this();
+                        return;
+                    }
+                }
+                else if (!is_zero_number(op.get_frequency(i), threshold_)) {
                     result_ = x.rcp_from_this();
                     return;
                 }
@@ -25,6 +25,15 @@ namespace Tinned
             SymEngine::is_a_sub<const ElectronicState>(*target) ||
             SymEngine::is_a_sub<const OneElecOperator>(*target)
         )
+        // Derivatives of the target do not change, so the frequency factor
+        // is computed only once
+        auto derivatives = get_derivatives();
+        frequency_ = get_frequency_sum(derivatives);
+        frequency_value_ = get_frequency_sum_value(derivatives);
+        if (type_==TemporumType::Bra) {
+            frequency_ = SymEngine::subnum(SymEngine::zero, frequency_);
+            frequency_value_ = -frequency_value_;
+        }
     }
 
     SymEngine::hash_t TemporumOperator::__hash__() const
@@ -1,6 +1,7 @@
 #include <string>
 
 #include <symengine/constants.h>
+#include <symengine/eval_double.h>
 
 #include "Tinned/TemporumOverlap.hpp"
 #include "Tinned/ZeroOperator.hpp"
@@ -24,6 +25,7 @@ namespace Tinned
         );
         braket_ = SymEngine::matrix_mul({bra, ket});
         SYMENGINE_ASSIGN_TYPEID()
+        find_frequencies();
     }
 
     TemporumOverlap::TemporumOverlap(const SymEngine::RCP<const SymEngine::Basic>& braket)
@@ -38,6 +40,33 @@ namespace Tinned
             SymEngine::is_a<const SymEngine::MatrixAdd>(*braket) ||
             SymEngine::is_a<const SymEngine::MatrixMul>(*braket)
         )
+        find_frequencies();
+    }
+
+    void TemporumOverlap::find_frequencies()
+    {
+        const auto num_products = size();
+        frequencies_.reserve(num_products);
+        frequency_values_.reserve(num_products);
+        for (std::size_t i=0; i<num_products; ++i) {
+            auto term = get_braket_product(i);
+            frequencies_.push_back(SymEngine::divnum(
+                SymEngine::mulnum(
+                    SymEngine::addnum(
+                        std::get<1>(term)->get_frequency(),
+                        std::get<2>(term)->get_frequency()
+                    ),
+                    std::get<0>(term)
+                ),
+                SymEngine::integer(-2)
+            ));
+            frequency_values_.push_back(
+                (std::get<1>(term)->get_frequency_value()
+                    + std::get<2>(term)->get_frequency_value())
+                * SymEngine::eval_complex_double(*std::get<0>(term))
+                / -2.0
+            );
+        }
     }
 
     SymEngine::hash_t TemporumOverlap::__hash__() const
@@ -28,6 +28,9 @@ namespace Tinned
                 "Density matrix doesn't have purity one: " + stringify(rho0.second)
             );
         rho0_ = rho0;
+        rho_all_derivatives_[0] = DensityDerivative({
+            std::make_pair(SymEngine::multiset_basic(), rho0.second)
+        });
         SymEngine::vec_basic values;
         auto op = SymEngine::rcp_dynamic_cast<const SymEngine::ImmutableDenseMatrix>(H0.second);
         for (std::size_t i=0; i<op->nrows(); ++i)
@@ -98,17 +101,20 @@ namespace Tinned
             case 0:
                 return rho0_.second;
             default:
-                if (derivatives.size()>rho_all_derivatives_.size()) {
-                    for (unsigned int order=rho_all_derivatives_.size();
+                // Derivatives are cached from the zeroth order
+                if (derivatives.size()>=rho_all_derivatives_.size()) {
+                    for (unsigned int order=rho_all_derivatives_.size()-1;
                          order<derivatives.size();
                          ++order) {
                         DensityDerivative rho_derivatives;
+                        // Frequency sums of `rho_derivatives`, computed once
+                        // for each multiset instead of each permutation
+                        std::vector<SymEngine::RCP<const SymEngine::Number>> freq_sums;
                         auto pert_permutation = PertPermutation(order+1, perturbations_);
                         bool remaining = true;
                         do {
                             auto permut_derivatives
                                 = pert_permutation.get_derivatives(remaining);
-                            auto freq_sum = get_frequency_sum(permut_derivatives);
                             // The last perturbation is the one for the
                             // external field, and we need to find the value of
                             // its corresponding operator
@@ -139,6 +145,9 @@ namespace Tinned
                                     idx_higher = i;
                                     break;
                                 }
+                            auto freq_sum = idx_higher>=0
+                                          ? freq_sums[idx_higher]
+                                          : get_frequency_sum(higher_derivatives);
                             // Try to find the matched lower order derivatives
                             // of density matrix
                             not_found = true;
@@ -194,6 +203,7 @@ namespace Tinned
                                                 )
                                             )
                                         );
+                                        freq_sums.push_back(freq_sum);
                                     }
                                     not_found = false;
                                     break;
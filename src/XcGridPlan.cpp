@@ -0,0 +1,50 @@
+#include "Tinned/XcGridPlan.hpp"
+
+namespace Tinned
+{
+    constexpr std::size_t XcGridPlan::npos;
+
+    std::size_t XcGridPlan::add_weight(const SymEngine::RCP<const NonElecFunction>& weight)
+    {
+        auto iter = idx_weights_.find(weight);
+        if (iter!=idx_weights_.end()) return iter->second;
+        idx_weights_.emplace(weight, weights_.size());
+        weights_.push_back(weight);
+        return weights_.size()-1;
+    }
+
+    void XcGridPlan::add_energy_map(
+        const ExcContractionMap& energyMap, const std::size_t idxOverlap
+    )
+    {
+        // Ordered entries so that indices do not depend on hashing
+        for (const auto term: get_ordered_entries(energyMap)) {
+            auto idx_weight = add_weight(term->first);
+            for (const auto contr: get_ordered_entries(term->second)) {
+                XcContractionRecipe recipe;
+                recipe.idx_weight = idx_weight;
+                recipe.exc_order = contr->first->get_order();
+                recipe.idx_exc_density = table_.add_density_vector(contr->first->get_inner());
+                recipe.idx_overlap = idxOverlap;
+                recipe.products = table_.add_density_products(contr->second);
+                exc_orders_.insert(recipe.exc_order);
+                recipes_.push_back(std::move(recipe));
+            }
+        }
+    }
+
+    XcGridPlan::XcGridPlan(
+        const ExcContractionMap& energyMap, const DensityVectorTable& table
+    ): table_(table)
+    {
+        add_energy_map(energyMap, npos);
+    }
+
+    XcGridPlan::XcGridPlan(
+        const VxcContractionMap& potentialMap, const DensityVectorTable& table
+    ): table_(table)
+    {
+        for (const auto energy_map: get_ordered_entries(potentialMap))
+            add_energy_map(energy_map->second, table_.add_overlap(energy_map->first));
+    }
+}
@@ -0,0 +1,1257 @@
+#define CATCH_CONFIG_MAIN
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <symengine/basic.h>
+#include <symengine/complex_double.h>
+#include <symengine/constants.h>
+#include <symengine/add.h>
+#include <symengine/mul.h>
+#include <symengine/eval_double.h>
+#include <symengine/integer.h>
+#include <symengine/matrices/conjugate_matrix.h>
+#include <symengine/matrices/immutable_dense_matrix.h>
+#include <symengine/matrices/matrix_add.h>
+#include <symengine/matrices/matrix_mul.h>
+#include <symengine/matrices/trace.h>
+#include <symengine/matrices/transpose.h>
+#include <symengine/real_double.h>
+#include <symengine/symengine_exception.h>
+#include <symengine/symbol.h>
+#include <symengine/symengine_rcp.h>
+
+#include "Tinned.hpp"
+#include "Tinned/EvaluationPlanner.hpp"
+#include "Tinned/DenseMatrix.hpp"
+#include "Tinned/DenseEvaluator.hpp"
+#include "Tinned/AsyncOperatorEvaluator.hpp"
+#include "Tinned/AsyncFunctionEvaluator.hpp"
+#include "Tinned/NLevelAtom.hpp"
+#include "Tinned/NLevelFrequencyScan.hpp"
+#include "Tinned/TwoLevelAtom.hpp"
+#include "Tinned/LdaXcGridDriver.hpp"
+#include "Tinned/Profiler.hpp"
+
+using namespace Tinned;
+
+// Make a matrix with distinct complex elements
+inline DenseMatrix make_test_matrix(const std::size_t dimension, const double seed)
+{
+    DenseMatrix A(dimension, dimension);
+    for (std::size_t i=0; i<dimension; ++i)
+        for (std::size_t j=0; j<dimension; ++j)
+            A(i, j) = std::complex<double>(seed+0.1*i-0.2*j, 0.05*seed*(i+1)-0.3*j);
+    return A;
+}
+
+// Model grid with batches of 4 points, where values of a generalized density
+// vector depend on the orders of its electronic state and overlap
+// distribution, and exc^{(n)}(rho) = (n+1)*rho
+class ModelLdaXcGridDriver: public LdaXcGridDriver<DenseMatrix>
+{
+    protected:
+        // Orders of electronic states and overlap distributions set up
+        // before threads start
+        std::map<const SymEngine::Basic*, std::size_t> orders_;
+
+        std::size_t get_num_batches() const override
+        {
+            return 3;
+        }
+
+        void prepare(const XcGridPlan& plan) override
+        {
+            for (const auto& state: plan.get_states())
+                orders_[state.get()] = state->get_derivatives().size();
+            for (const auto& Omega: plan.get_overlap_distributions())
+                orders_[Omega.get()] = Omega->get_derivatives().size();
+        }
+
+        std::vector<double> eval_density_vector(
+            const std::size_t idxBatch,
+            const ElectronicState& state,
+            const OneElecOperator& Omega
+        ) override
+        {
+            std::vector<double> values;
+            for (std::size_t p=4*idxBatch; p<4*idxBatch+4; ++p)
+                values.push_back(
+                    get_model_density(orders_.at(&state), orders_.at(&Omega), p)
+                );
+            return values;
+        }
+
+        std::vector<double> eval_weight(
+            const std::size_t idxBatch,
+            const NonElecFunction& weight
+        ) override
+        {
+            std::vector<double> values;
+            for (std::size_t p=4*idxBatch; p<4*idxBatch+4; ++p)
+                values.push_back(get_model_weight(p));
+            return values;
+        }
+
+        std::vector<double> eval_exc_derivative(
+            const std::size_t idxBatch,
+            const unsigned int order,
+            const std::vector<double>& density
+        ) override
+        {
+            std::vector<double> values;
+            for (const auto& rho: density) values.push_back((order+1)*rho);
+            return values;
+        }
+
+        // Values of Omega^{x} are taken as 1+|x|
+        DenseMatrix eval_overlap_integration(
+            const std::size_t idxBatch,
+            const OneElecOperator& Omega,
+            const std::vector<double>& values
+        ) override
+        {
+            DenseMatrix result(1, 1);
+            for (const auto& val: values) result(0, 0) += val*(1.0+orders_.at(&Omega));
+            return result;
+        }
+
+        void eval_oper_addition(DenseMatrix& A, const DenseMatrix& B) override
+        {
+            dense_axpy(1.0, B, A);
+        }
+
+    public:
+        explicit ModelLdaXcGridDriver(const unsigned int numThreads):
+            LdaXcGridDriver<DenseMatrix>(numThreads) {}
+
+        static double get_model_density(
+            const std::size_t orderState, const std::size_t orderOmega, const std::size_t p
+        )
+        {
+            return 0.3*(1+orderState)+0.07*(1+orderOmega)+0.001*p;
+        }
+
+        static double get_model_weight(const std::size_t p)
+        {
+            return 0.5+0.01*p;
+        }
+};
+
+// Asynchronous operator evaluator using dense complex matrices, whose leaf
+// callbacks dispatch values to other threads as a host program would do, and
+// the values are ready only after `gate` is ready
+class AsyncDenseOperator: public AsyncOperatorEvaluator<DenseMatrix>
+{
+    protected:
+        DenseOperatorMap values_;
+        std::shared_future<void> gate_;
+
+        // Values are looked up by the traversing thread, so that other
+        // threads do not touch SymEngine objects
+        FutureOperator dispatch(const SymEngine::Basic& x)
+        {
+            auto value = values_.find(x.rcp_from_this());
+            if (value==values_.end()) {
+                std::promise<DenseMatrix> promise;
+                promise.set_exception(std::make_exception_ptr(
+                    SymEngine::SymEngineException("No value for " + stringify(x))
+                ));
+                return promise.get_future().share();
+            }
+            auto matrix = value->second;
+            auto gate = gate_;
+            return std::async(std::launch::async, [matrix, gate]() {
+                if (gate.valid()) gate.wait();
+                return matrix;
+            }).share();
+        }
+
+        FutureOperator eval_1el_density(const OneElecDensity& x) override
+        {
+            return dispatch(x);
+        }
+
+        FutureOperator eval_1el_operator(const OneElecOperator& x) override
+        {
+            return dispatch(x);
+        }
+
+        DenseMatrix eval_hermitian_transpose(const DenseMatrix& A) override
+        {
+            return dense_adjoint(A);
+        }
+
+        DenseMatrix eval_conjugate_matrix(const DenseMatrix& A) override
+        {
+            return dense_conjugate(A);
+        }
+
+        DenseMatrix eval_transpose(const DenseMatrix& A) override
+        {
+            return dense_transpose(A);
+        }
+
+        void eval_oper_addition(DenseMatrix& A, const DenseMatrix& B) override
+        {
+            dense_axpy(1.0, B, A);
+        }
+
+        DenseMatrix eval_oper_multiplication(const DenseMatrix& A, const DenseMatrix& B) override
+        {
+            return dense_multiply(A, B);
+        }
+
+        void eval_oper_scale(
+            const SymEngine::RCP<const SymEngine::Number>& scalar,
+            DenseMatrix& A
+        ) override
+        {
+            dense_scal(SymEngine::eval_complex_double(*scalar), A);
+        }
+
+    public:
+        explicit AsyncDenseOperator(
+            const DenseOperatorMap& values,
+            const unsigned int numThreads,
+            const std::shared_future<void>& gate = std::shared_future<void>()
+        ): AsyncOperatorEvaluator<DenseMatrix>(numThreads), values_(values), gate_(gate) {}
+};
+
+// Asynchronous function evaluator using dense complex matrices
+class AsyncDenseFunction: public AsyncFunctionEvaluator<std::complex<double>, DenseMatrix>
+{
+    protected:
+        DenseFunctionMap values_;
+
+        FutureFunction eval_nonel_function(const NonElecFunction& x) override
+        {
+            return make_ready_future(values_.at(x.rcp_from_this()));
+        }
+
+        std::complex<double> eval_trace(const DenseMatrix& A) override
+        {
+            return dense_trace(A);
+        }
+
+        void eval_fun_addition(std::complex<double>& f, const std::complex<double>& g) override
+        {
+            f += g;
+        }
+
+        void eval_fun_scale(
+            const SymEngine::RCP<const SymEngine::Number>& scalar,
+            std::complex<double>& f
+        ) override
+        {
+            f *= SymEngine::eval_complex_double(*scalar);
+        }
+
+    public:
+        explicit AsyncDenseFunction(
+            const std::shared_ptr<AsyncDenseOperator>& operEvaluator,
+            const DenseFunctionMap& values
+        ): AsyncFunctionEvaluator<std::complex<double>, DenseMatrix>(operEvaluator),
+           values_(values) {}
+};
+
+// Model grid without the integration of generalized overlap distributions,
+// whose kernel throws in threads
+class IncompleteLdaXcGridDriver: public ModelLdaXcGridDriver
+{
+    protected:
+        DenseMatrix eval_overlap_integration(
+            const std::size_t idxBatch,
+            const OneElecOperator& Omega,
+            const std::vector<double>& values
+        ) override
+        {
+            return LdaXcGridDriver<DenseMatrix>::eval_overlap_integration(
+                idxBatch, Omega, values
+            );
+        }
+
+    public:
+        explicit IncompleteLdaXcGridDriver(const unsigned int numThreads):
+            ModelLdaXcGridDriver(numThreads) {}
+};
+
+// Dense operator evaluator recording layouts of components seen by the leaf
+// callback `eval_1el_operator()`
+class LayoutDenseOperator: public DenseOperatorEvaluator
+{
+    protected:
+        std::vector<std::size_t> layout_sizes_;
+
+        DenseMatrix eval_1el_operator(const OneElecOperator& x) override
+        {
+            layout_sizes_.push_back(get_component_layout().size());
+            return DenseOperatorEvaluator::eval_1el_operator(x);
+        }
+
+    public:
+        explicit LayoutDenseOperator(const DenseOperatorMap& values):
+            DenseOperatorEvaluator(values) {}
+
+        inline const std::vector<std::size_t>& get_layout_sizes() const noexcept
+        {
+            return layout_sizes_;
+        }
+};
+
+// Dense operator evaluator using either fused callbacks, or the default ones
+// composed of multiplication, scale and addition
+class FusionDenseOperator: public DenseOperatorEvaluator
+{
+    protected:
+        bool fused_;
+        std::size_t num_fused_calls_;
+
+        void eval_oper_gemm(
+            DenseMatrix& C,
+            const SymEngine::RCP<const SymEngine::Number>& alpha,
+            const DenseMatrix& A,
+            const DenseMatrix& B
+        ) override
+        {
+            if (fused_) {
+                ++num_fused_calls_;
+                DenseOperatorEvaluator::eval_oper_gemm(C, alpha, A, B);
+            }
+            else {
+                OperatorEvaluator<DenseMatrix>::eval_oper_gemm(C, alpha, A, B);
+            }
+        }
+
+        void eval_oper_axpy(
+            DenseMatrix& A,
+            const SymEngine::RCP<const SymEngine::Number>& alpha,
+            const DenseMatrix& B
+        ) override
+        {
+            if (fused_) {
+                ++num_fused_calls_;
+                DenseOperatorEvaluator::eval_oper_axpy(A, alpha, B);
+            }
+            else {
+                OperatorEvaluator<DenseMatrix>::eval_oper_axpy(A, alpha, B);
+            }
+        }
+
+        bool has_fused_callbacks() const noexcept override
+        {
+            return fused_;
+        }
+
+    public:
+        explicit FusionDenseOperator(const DenseOperatorMap& values, const bool fused):
+            DenseOperatorEvaluator(values), fused_(fused), num_fused_calls_(0) {}
+
+        inline bool is_fused() const noexcept
+        {
+            return has_fused_callbacks();
+        }
+
+        inline std::size_t get_num_fused_calls() const noexcept
+        {
+            return num_fused_calls_;
+        }
+
+        inline bool has_plan() const noexcept
+        {
+            return !plan_.empty();
+        }
+};
+
+// Dense function evaluator counting calls of `eval_trace()` and
+// `eval_trace_product()`
+class CountingDenseFunction: public DenseFunctionEvaluator
+{
+    protected:
+        std::size_t num_traces_;
+        std::size_t num_trace_products_;
+
+        std::complex<double> eval_trace(const DenseMatrix& A) override
+        {
+            ++num_traces_;
+            return DenseFunctionEvaluator::eval_trace(A);
+        }
+
+        std::complex<double> eval_trace_product(
+            const DenseMatrix& A, const DenseMatrix& B
+        ) override
+        {
+            ++num_trace_products_;
+            return DenseFunctionEvaluator::eval_trace_product(A, B);
+        }
+
+    public:
+        explicit CountingDenseFunction(
+            const std::shared_ptr<DenseOperatorEvaluator>& operEvaluator
+        ): DenseFunctionEvaluator(operEvaluator), num_traces_(0), num_trace_products_(0) {}
+
+        inline std::size_t get_num_traces() const noexcept
+        {
+            return num_traces_;
+        }
+
+        inline std::size_t get_num_trace_products() const noexcept
+        {
+            return num_trace_products_;
+        }
+};
+
+inline double get_max_error(const DenseMatrix& A, const DenseMatrix& B)
+{
+    double error = 0.0;
+    for (std::size_t i=0; i<A.nrows(); ++i)
+        for (std::size_t j=0; j<A.ncols(); ++j)
+            error = std::max(error, std::abs(A(i, j)-B(i, j)));
+    return error;
+}
+
+// [V, rho] divided elementwise by (w-W_ij)
+inline DenseMatrix make_nlevel_rho(const std::complex<double>& w,
+                                   const DenseMatrix& omega,
+                                   const DenseMatrix& V,
+                                   const DenseMatrix& rho)
+{
+    auto result = dense_multiply(V, rho);
+    dense_axpy(-1.0, dense_multiply(rho, V), result);
+    for (std::size_t i=0; i<result.nrows(); ++i)
+        for (std::size_t j=0; j<result.ncols(); ++j)
+            result(i, j) /= w-omega(i, j);
+    return result;
+}
+
+// Conversions between dense and SymEngine matrices
+inline SymEngine::RCP<const SymEngine::MatrixExpr> make_symengine_matrix(const DenseMatrix& A)
+{
+    SymEngine::vec_basic values;
+    for (std::size_t i=0; i<A.size(); ++i)
+        values.push_back(SymEngine::complex_double(A.data()[i]));
+    return SymEngine::immutable_dense_matrix(A.nrows(), A.ncols(), values);
+}
+
+inline DenseMatrix make_dense_matrix(const SymEngine::RCP<const SymEngine::MatrixExpr>& A)
+{
+    auto op = SymEngine::rcp_dynamic_cast<const SymEngine::ImmutableDenseMatrix>(A);
+    DenseMatrix result(op->nrows(), op->ncols());
+    for (std::size_t i=0; i<op->nrows(); ++i)
+        for (std::size_t j=0; j<op->ncols(); ++j)
+            result(i, j) = SymEngine::eval_complex_double(*op->get(i, j));
+    return result;
+}
+
+// Ground state density matrix of a two-level system with Hamiltonian H,
+// (I-(H-mI)/r)/2 with m and +/-r the mean and half difference of energies
+inline DenseMatrix make_two_level_ground_state(const DenseMatrix& H)
+{
+    auto mean = 0.5*(H(0, 0)+H(1, 1));
+    auto radius = std::sqrt(std::norm(0.5*(H(0, 0)-H(1, 1)))+std::norm(H(0, 1)));
+    auto result = make_identity_matrix(2);
+    dense_axpy(-0.5/radius, H, result);
+    for (std::size_t i=0; i<2; ++i) result(i, i) += 0.5*mean/radius-0.5;
+    return result;
+}
+
+TEST_CASE("Test DenseMatrix and its kernels", "[DenseMatrix]")
+{
+    const std::size_t dimension = 5;
+    auto A = make_test_matrix(dimension, 0.7);
+    auto B = make_test_matrix(dimension, -1.3);
+    auto AB = dense_multiply(A, B);
+    for (std::size_t i=0; i<dimension; ++i)
+        for (std::size_t j=0; j<dimension; ++j) {
+            std::complex<double> val = 0.0;
+            for (std::size_t k=0; k<dimension; ++k) val += A(i, k)*B(k, j);
+            REQUIRE(std::abs(AB(i, j)-val)<1.0e-12);
+        }
+    REQUIRE(std::abs(dense_trace_product(A, B)-dense_trace(AB))<1.0e-12);
+
+    // C = 2*C + (0.5-i)*A*B
+    auto C = make_test_matrix(dimension, 2.1);
+    auto C_ref = C;
+    dense_scal(2.0, C_ref);
+    dense_axpy(std::complex<double>(0.5, -1.0), AB, C_ref);
+    dense_gemm(std::complex<double>(0.5, -1.0), A, B, 2.0, C);
+    REQUIRE(get_max_error(C, C_ref)<1.0e-12);
+
+    auto A_dagger = dense_adjoint(A);
+    auto A_star = dense_conjugate(A);
+    auto A_T = dense_transpose(A);
+    REQUIRE(get_max_error(dense_conjugate(A_T), A_dagger)<1.0e-15);
+    REQUIRE(A_star(1, 3)==std::conj(A(1, 3)));
+    REQUIRE(A_T(1, 3)==A(3, 1));
+}
+
+TEST_CASE("Test DenseOperatorEvaluator and DenseFunctionEvaluator", "[OperatorEvaluator]")
+{
+    const std::size_t dimension = 4;
+    auto a = make_perturbation(std::string("a"), SymEngine::two);
+    auto dependencies = PertDependency({std::make_pair(a, 99)});
+    auto D = make_1el_density(std::string("D"));
+    auto h = make_1el_operator(std::string("h"), dependencies);
+    auto S = make_1el_operator(std::string("S"), dependencies);
+    auto hnuc = make_nonel_function(std::string("hnuc"), dependencies);
+
+    auto val_D = make_test_matrix(dimension, 0.3);
+    auto val_D_a = make_test_matrix(dimension, -0.4);
+    auto val_h = make_test_matrix(dimension, 1.1);
+    auto val_h_a = make_test_matrix(dimension, 0.9);
+    auto val_S = make_test_matrix(dimension, -0.8);
+    auto oper_evaluator = std::make_shared<DenseOperatorEvaluator>(
+        DenseOperatorMap({
+            {D, val_D},
+            {D->diff(a), val_D_a},
+            {h, val_h},
+            {h->diff(a), val_h_a},
+            {S, val_S}
+        })
+    );
+
+    // F = h + 2*h*D*S - S*D*h^{\dagger}
+    auto F = SymEngine::matrix_add({
+        h,
+        SymEngine::matrix_mul({SymEngine::two, h, D, S}),
+        SymEngine::matrix_mul({
+            SymEngine::minus_one, S, D, make_conjugate_transpose(h)
+        })
+    });
+    auto F_ref = val_h;
+    dense_axpy(2.0, dense_multiply(dense_multiply(val_h, val_D), val_S), F_ref);
+    dense_axpy(
+        -1.0,
+        dense_multiply(dense_multiply(val_S, val_D), dense_adjoint(val_h)),
+        F_ref
+    );
+    REQUIRE(get_max_error(oper_evaluator->apply(F), F_ref)<1.0e-12);
+    // Evaluation with a bounded number of live operators
+    REQUIRE(get_max_error(oper_evaluator->apply(F, 4), F_ref)<1.0e-12);
+    REQUIRE_THROWS(oper_evaluator->apply(F, 2));
+
+    // Time differentiated density matrix scaled by the frequency of `a`
+    auto Dt_a = make_dt_operator(D)->diff(a);
+    auto Dt_a_ref = val_D_a;
+    dense_scal(2.0, Dt_a_ref);
+    REQUIRE(get_max_error(oper_evaluator->apply(Dt_a), Dt_a_ref)<1.0e-12);
+
+    auto fun_evaluator = std::make_shared<DenseFunctionEvaluator>(
+        oper_evaluator,
+        DenseFunctionMap({{hnuc, 0.25}, {hnuc->diff(a), -0.5}})
+    );
+    auto E = SymEngine::add({
+        SymEngine::trace(SymEngine::matrix_mul({h, D})),
+        SymEngine::mul(SymEngine::two, SymEngine::trace(SymEngine::matrix_add({h, D}))),
+        hnuc
+    });
+    auto E_ref = dense_trace_product(val_h, val_D)
+        + 2.0*(dense_trace(val_h)+dense_trace(val_D)) + 0.25;
+    REQUIRE(std::abs(fun_evaluator->apply(E)-E_ref)<1.0e-12);
+    // E^{a} = tr(h^{a}D) + tr(hD^{a}) + 2*tr(h^{a}+D^{a}) + hnuc^{a}
+    auto E_a = differentiate(E, PertTuple({a}));
+    auto E_a_ref = dense_trace_product(val_h_a, val_D)
+        + dense_trace_product(val_h, val_D_a)
+        + 2.0*(dense_trace(val_h_a)+dense_trace(val_D_a)) - 0.5;
+    REQUIRE(std::abs(fun_evaluator->apply(E_a)-E_a_ref)<1.0e-12);
+}
+
+TEST_CASE("Test fused callbacks of OperatorEvaluator", "[OperatorEvaluator]")
+{
+    const std::size_t dimension = 4;
+    auto D = make_1el_density(std::string("D"));
+    auto h = make_1el_operator(std::string("h"));
+    auto S = make_1el_operator(std::string("S"));
+    auto values = DenseOperatorMap({
+        {D, make_test_matrix(dimension, 0.3)},
+        {h, make_test_matrix(dimension, 1.1)},
+        {S, make_test_matrix(dimension, -0.8)}
+    });
+    FusionDenseOperator fused(values, true);
+    FusionDenseOperator unfused(values, false);
+    REQUIRE(fused.is_fused());
+    REQUIRE(!unfused.is_fused());
+
+    // Terms of the addition are accumulated by `eval_oper_gemm()` (scaled
+    // products) and `eval_oper_axpy()` (scaled operators)
+    auto F = SymEngine::matrix_add({
+        h,
+        SymEngine::matrix_mul({SymEngine::two, h, D, S}),
+        SymEngine::matrix_mul({SymEngine::minus_one, S, D, make_conjugate_transpose(h)}),
+        SymEngine::matrix_mul({SymEngine::div(SymEngine::one, SymEngine::two), S}),
+        SymEngine::matrix_mul({D, S})
+    });
+    auto F_unfused = unfused.apply(F);
+    REQUIRE(unfused.get_num_fused_calls()==0);
+    auto F_fused = fused.apply(F);
+    // At most one term is evaluated first instead of being accumulated
+    REQUIRE(fused.get_num_fused_calls()>=3);
+    REQUIRE(get_max_error(F_fused, F_unfused)<1.0e-12);
+
+    // Planned evaluation, where fused callbacks need fewer live operators
+    auto fused_peak = get_peak_live_operators(F, true);
+    auto unfused_peak = get_peak_live_operators(F);
+    REQUIRE(fused_peak<=unfused_peak);
+    REQUIRE(get_max_error(fused.apply(F, fused_peak), F_unfused)<1.0e-12);
+    REQUIRE(get_max_error(unfused.apply(F, unfused_peak), F_unfused)<1.0e-12);
+    REQUIRE(unfused.get_num_fused_calls()==0);
+    REQUIRE(!fused.has_plan());
+
+    // The plan is cleared when a callback throws
+    FusionDenseOperator incomplete(DenseOperatorMap({{h, values.at(h)}}), true);
+    REQUIRE_THROWS(incomplete.apply(F, fused_peak));
+    REQUIRE(!incomplete.has_plan());
+}
+
+TEST_CASE("Test traces of matrix multiplications and additions", "[FunctionEvaluator]")
+{
+    const std::size_t dimension = 4;
+    auto a = make_perturbation(std::string("a"));
+    auto dependencies = PertDependency({std::make_pair(a, 99)});
+    auto D = make_1el_density(std::string("D"));
+    auto h = make_1el_operator(std::string("h"), dependencies);
+    auto S = make_1el_operator(std::string("S"), dependencies);
+    auto val_D = make_test_matrix(dimension, 0.3);
+    auto val_h = make_test_matrix(dimension, 1.1);
+    auto val_h_a = make_test_matrix(dimension, 0.9);
+    auto val_S = make_test_matrix(dimension, -0.8);
+    auto val_S_a = make_test_matrix(dimension, 0.6);
+    auto oper_evaluator = std::make_shared<DenseOperatorEvaluator>(
+        DenseOperatorMap({
+            {D, val_D},
+            {h, val_h},
+            {h->diff(a), val_h_a},
+            {S, val_S},
+            {S->diff(a), val_S_a}
+        })
+    );
+
+    // tr(2*h*D*S*D) = 2*tr((h*D*S)*D)
+    auto fun_evaluator = std::make_shared<CountingDenseFunction>(oper_evaluator);
+    auto E = SymEngine::trace(SymEngine::matrix_mul({SymEngine::two, h, D, S, D}));
+    auto E_ref = 2.0*dense_trace_product(
+        dense_multiply(dense_multiply(val_h, val_D), val_S), val_D
+    );
+    REQUIRE(std::abs(fun_evaluator->apply(E)-E_ref)<1.0e-12);
+    REQUIRE(fun_evaluator->get_num_trace_products()==1);
+    REQUIRE(fun_evaluator->get_num_traces()==0);
+
+    // Derivatives of all factors are kept for the trace product
+    // tr(h^{a}*D*S*D) + tr(h*D*S^{a}*D)
+    auto E_a = SymEngine::add(
+        SymEngine::trace(SymEngine::matrix_mul({h->diff(a), D, S, D})),
+        SymEngine::trace(SymEngine::matrix_mul({h, D, S->diff(a), D}))
+    );
+    auto E_a_ref = dense_trace_product(
+        dense_multiply(dense_multiply(val_h_a, val_D), val_S), val_D
+    ) + dense_trace_product(
+        dense_multiply(dense_multiply(val_h, val_D), val_S_a), val_D
+    );
+    REQUIRE(std::abs(fun_evaluator->apply(E_a)-E_a_ref)<1.0e-12);
+    REQUIRE(fun_evaluator->get_num_trace_products()==3);
+
+    // The trace of a matrix addition is distributed over its arguments,
+    // tr(h+D*S-3*S*h*D) = tr(h) + tr(D*S) - 3*tr((S*h)*D)
+    auto G = SymEngine::make_rcp<const SymEngine::Trace>(SymEngine::matrix_add({
+        h,
+        SymEngine::matrix_mul({D, S}),
+        SymEngine::matrix_mul({SymEngine::integer(-3), S, h, D})
+    }));
+    auto G_ref = dense_trace(val_h)
+        + dense_trace_product(val_D, val_S)
+        - 3.0*dense_trace_product(dense_multiply(val_S, val_h), val_D);
+    REQUIRE(std::abs(fun_evaluator->apply(G)-G_ref)<1.0e-12);
+    REQUIRE(fun_evaluator->get_num_trace_products()==5);
+    REQUIRE(fun_evaluator->get_num_traces()==1);
+
+    // Arguments of the matrix addition have different derivatives
+    auto G_invalid = SymEngine::make_rcp<const SymEngine::Trace>(
+        SymEngine::matrix_add({h, h->diff(a)})
+    );
+    REQUIRE_THROWS_AS(fun_evaluator->apply(G_invalid), SymEngine::NotImplementedError);
+}
+
+TEST_CASE("Test component layouts of leaves in a product", "[OperatorEvaluator]")
+{
+    const std::size_t dimension = 3;
+    auto el = make_perturbation(
+        std::string("EL"), SymEngine::zero, std::set<std::size_t>({0, 1, 2})
+    );
+    auto dependencies = PertDependency({std::make_pair(el, 99)});
+    auto A = make_1el_operator(std::string("A"), dependencies);
+    auto B = make_1el_operator(std::string("B"), dependencies);
+    auto val_A_el = make_test_matrix(dimension, 0.4);
+    auto val_B_el = make_test_matrix(dimension, -1.2);
+    LayoutDenseOperator oper_evaluator(
+        DenseOperatorMap({{A->diff(el), val_A_el}, {B->diff(el), val_B_el}})
+    );
+
+    // The term 2*A^{el}*B^{el} of (A*B)^{el,el}
+    auto P = SymEngine::matrix_mul({SymEngine::two, A->diff(el), B->diff(el)});
+    auto P_ref = dense_multiply(val_A_el, val_B_el);
+    dense_scal(2.0, P_ref);
+    REQUIRE(get_max_error(oper_evaluator.apply(P), P_ref)<1.0e-12);
+    // Leaf callbacks see the layouts of their own leaves
+    REQUIRE(oper_evaluator.get_layout_sizes() == std::vector<std::size_t>({3, 3}));
+    REQUIRE(SymEngine::unified_eq(
+        oper_evaluator.get_derivatives().back(), SymEngine::multiset_basic({el, el})
+    ));
+
+    // Combining batches of A^{el} and B^{el} into the layout of the merged
+    // derivatives needs symmetrization, A^{i}*B^{j}+A^{j}*B^{i}
+    const std::vector<double> val_a = {1.0, 2.0, -3.0};
+    const std::vector<double> val_b = {0.5, -1.0, 4.0};
+    auto layout = ComponentLayout(SymEngine::multiset_basic({el, el}));
+    REQUIRE(layout.size() == 6);
+    std::vector<double> product(layout.size(), 0.0);
+    for (std::size_t i=0; i<3; ++i)
+        for (std::size_t j=0; j<3; ++j)
+            product[layout.get_index(std::vector<std::size_t>({i, j}))]
+                += val_a[i]*val_b[j];
+    for (std::size_t k=0; k<layout.size(); ++k) {
+        auto components = layout.get_components(k);
+        auto i = components[0];
+        auto j = components[1];
+        // Diagonal components are counted once by the derivative but twice
+        // by the sum over all tuples
+        REQUIRE(std::abs(
+            (i==j ? 2.0 : 1.0)*product[k]
+            - (val_a[i]*val_b[j]+val_a[j]*val_b[i])
+        )<1.0e-12);
+    }
+}
+
+TEST_CASE("Test frequency placeholders and FrequencyBinding", "[OperatorEvaluator]")
+{
+    const std::size_t dimension = 3;
+    // Frequency of the perturbation is irrelevant for the template
+    auto a = make_perturbation(std::string("a"));
+    auto D = make_1el_density(std::string("D"));
+    auto h = make_1el_operator(
+        std::string("h"), PertDependency({std::make_pair(a, 99)})
+    );
+    auto val_D_a = make_test_matrix(dimension, -0.4);
+    auto val_h = make_test_matrix(dimension, 1.1);
+    auto oper_evaluator = std::make_shared<DenseOperatorEvaluator>(
+        DenseOperatorMap({{D->diff(a), val_D_a}, {h, val_h}})
+    );
+    auto fun_evaluator = std::make_shared<DenseFunctionEvaluator>(oper_evaluator);
+
+    auto Dt_a = make_dt_operator(D)->diff(a);
+    REQUIRE(SymEngine::is_a_sub<const ZeroOperator>(*clean_temporum(Dt_a)));
+    auto X = clean_temporum(Dt_a, true);
+    auto X_ref = SymEngine::matrix_mul({make_frequency_placeholder(a), D->diff(a)});
+    REQUIRE(SymEngine::eq(*X, *X_ref));
+    auto E = SymEngine::trace(SymEngine::matrix_mul({h, X}));
+    // Unbound frequency placeholders cannot be evaluated
+    REQUIRE_THROWS(oper_evaluator->apply(X));
+
+    FrequencyBinding binding;
+    for (const auto frequency: {0.5, -1.25}) {
+        binding.bind(a, SymEngine::real_double(frequency));
+        fun_evaluator->set_frequency_binding(binding);
+        auto X_val = val_D_a;
+        dense_scal(frequency, X_val);
+        REQUIRE(get_max_error(oper_evaluator->apply(X), X_val)<1.0e-12);
+        // Bound frequencies are used for `TemporumOperator` objects
+        REQUIRE(get_max_error(oper_evaluator->apply(Dt_a), X_val)<1.0e-12);
+        REQUIRE(std::abs(fun_evaluator->apply(E)-dense_trace_product(val_h, X_val))<1.0e-12);
+    }
+
+    // Perturbations with the same name but different frequencies have
+    // different placeholders
+    auto el_w = make_perturbation(std::string("el"), SymEngine::real_double(0.5));
+    auto el_2w = make_perturbation(std::string("el"), SymEngine::real_double(1.0));
+    REQUIRE(SymEngine::neq(
+        *make_frequency_placeholder(el_w), *make_frequency_placeholder(el_2w)
+    ));
+    REQUIRE(SymEngine::eq(
+        *make_frequency_placeholder(el_w),
+        *make_frequency_placeholder(
+            make_perturbation(std::string("el"), SymEngine::real_double(0.5))
+        )
+    ));
+    // Placeholders differ from symbols and perturbations of the same name,
+    // from both sides of the comparison
+    auto omega_el = make_frequency_placeholder(el_w);
+    auto symbol_el = SymEngine::symbol("omega_el");
+    auto pert_el = make_perturbation(std::string("omega_el"), SymEngine::real_double(0.5));
+    REQUIRE(SymEngine::neq(*omega_el, *symbol_el));
+    REQUIRE(SymEngine::neq(*symbol_el, *omega_el));
+    REQUIRE(SymEngine::neq(*omega_el, *pert_el));
+    REQUIRE(SymEngine::neq(*pert_el, *omega_el));
+    REQUIRE(omega_el->__cmp__(*symbol_el)==-symbol_el->__cmp__(*omega_el));
+    REQUIRE(omega_el->__cmp__(*symbol_el)!=0);
+    REQUIRE(omega_el->__cmp__(*pert_el)==-pert_el->__cmp__(*omega_el));
+    REQUIRE(omega_el->__cmp__(*pert_el)!=0);
+    REQUIRE(SymEngine::is_a<const SymEngine::Add>(*SymEngine::add(omega_el, symbol_el)));
+    auto w_sum = get_frequency_placeholder_sum(SymEngine::multiset_basic({el_w, el_2w}));
+    REQUIRE(SymEngine::is_a<const SymEngine::Add>(*w_sum));
+    REQUIRE(is_frequency_expression(*w_sum));
+    // Only frequency placeholders are accepted
+    REQUIRE(!is_frequency_expression(*SymEngine::symbol("omega_el")));
+    REQUIRE(!is_frequency_expression(
+        *SymEngine::add(w_sum, SymEngine::symbol("x"))
+    ));
+    FrequencyBinding el_binding;
+    el_binding.bind(el_w, SymEngine::real_double(0.25));
+    // Unbound placeholders cannot be evaluated, but unbound perturbations
+    // keep their own frequencies in sums of frequencies
+    REQUIRE(el_binding.apply(w_sum).is_null());
+    REQUIRE(SymEngine::eq(
+        *el_binding.get_frequency_sum(SymEngine::multiset_basic({el_w, el_2w})),
+        *SymEngine::real_double(1.25)
+    ));
+    el_binding.bind(el_2w, SymEngine::real_double(-0.75));
+    REQUIRE(SymEngine::eq(*el_binding.apply(w_sum), *SymEngine::real_double(-0.5)));
+
+    // Bound frequencies are used for frequency factors of `TemporumOverlap`
+    // objects
+    auto g = make_perturbation(std::string("g"), SymEngine::real_double(1.5));
+    auto T = make_t_matrix(PertDependency({std::make_pair(g, 99)}));
+    auto Tgg = SymEngine::rcp_dynamic_cast<const TemporumOverlap>(T->diff(g)->diff(g));
+    auto overlap_evaluator = std::make_shared<DenseOperatorEvaluator>();
+    for (std::size_t i=0; i<Tgg->size(); ++i)
+        REQUIRE(overlap_evaluator->get_frequency_value(*Tgg, i)==Tgg->get_frequency_value(i));
+    FrequencyBinding g_binding;
+    g_binding.bind(g, SymEngine::real_double(0.5));
+    overlap_evaluator->set_frequency_binding(g_binding);
+    for (std::size_t i=0; i<Tgg->size(); ++i)
+        REQUIRE(std::abs(
+            overlap_evaluator->get_frequency_value(*Tgg, i)-Tgg->get_frequency_value(i)/3.0
+        )<1.0e-12);
+}
+
+TEST_CASE("Test AsyncOperatorEvaluator and AsyncFunctionEvaluator", "[AsyncOperatorEvaluator]")
+{
+    const std::size_t dimension = 4;
+    auto a = make_perturbation(std::string("a"), SymEngine::two);
+    auto dependencies = PertDependency({std::make_pair(a, 99)});
+    auto D = make_1el_density(std::string("D"));
+    auto h = make_1el_operator(std::string("h"), dependencies);
+    auto S = make_1el_operator(std::string("S"), dependencies);
+    auto hnuc = make_nonel_function(std::string("hnuc"), dependencies);
+
+    auto oper_values = DenseOperatorMap({
+        {D, make_test_matrix(dimension, 0.3)},
+        {D->diff(a), make_test_matrix(dimension, -0.4)},
+        {h, make_test_matrix(dimension, 1.1)},
+        {h->diff(a), make_test_matrix(dimension, 0.9)},
+        {S, make_test_matrix(dimension, -0.8)}
+    });
+    auto fun_values = DenseFunctionMap({{hnuc, 0.25}, {hnuc->diff(a), -0.5}});
+    auto oper_evaluator = std::make_shared<DenseOperatorEvaluator>(oper_values);
+    auto fun_evaluator = std::make_shared<DenseFunctionEvaluator>(oper_evaluator, fun_values);
+
+    // F = h + 2*h*D*S - S*D*h^{\dagger}
+    auto F = SymEngine::matrix_add({
+        h,
+        SymEngine::matrix_mul({SymEngine::two, h, D, S}),
+        SymEngine::matrix_mul({
+            SymEngine::minus_one, S, D, make_conjugate_transpose(h)
+        })
+    });
+    auto G = SymEngine::matrix_add({
+        SymEngine::transpose(F),
+        SymEngine::conjugate_matrix(SymEngine::matrix_mul({D, S}))
+    });
+    auto E = SymEngine::add({
+        SymEngine::trace(SymEngine::matrix_mul({h, D})),
+        SymEngine::mul(SymEngine::two, SymEngine::trace(SymEngine::matrix_add({h, D}))),
+        hnuc
+    });
+    auto E_a = differentiate(E, PertTuple({a}));
+    auto F_ref = oper_evaluator->apply(F);
+    auto G_ref = oper_evaluator->apply(G);
+    auto E_ref = fun_evaluator->apply(E);
+    auto E_a_ref = fun_evaluator->apply(E_a);
+
+    // Continuations run by one thread or several threads
+    for (unsigned int num_threads: {1, 4}) {
+        auto async_oper = std::make_shared<AsyncDenseOperator>(oper_values, num_threads);
+        auto async_fun = std::make_shared<AsyncDenseFunction>(async_oper, fun_values);
+        // A new traversal does not invalidate handles of previous ones
+        auto val_F = async_oper->apply(F);
+        auto val_G = async_oper->apply(G);
+        REQUIRE(get_max_error(val_F.get(), F_ref)<1.0e-12);
+        REQUIRE(get_max_error(val_G.get(), G_ref)<1.0e-12);
+        // Leaf handles are forwarded
+        REQUIRE(get_max_error(async_oper->apply(h).get(), oper_values.at(h))<1.0e-15);
+        auto val_E = async_fun->apply(E);
+        auto val_E_a = async_fun->apply(E_a);
+        REQUIRE(std::abs(val_E.get()-E_ref)<1.0e-12);
+        REQUIRE(std::abs(val_E_a.get()-E_a_ref)<1.0e-12);
+        // Exceptions of leaves reach the handle of the result
+        auto val_X = async_oper->apply(SymEngine::matrix_mul({h, S->diff(a)}));
+        REQUIRE_THROWS_AS(val_X.get(), SymEngine::SymEngineException&);
+        REQUIRE(get_max_error(async_oper->apply(F).get(), F_ref)<1.0e-12);
+        // Expressions traversed into one graph
+        auto val_FG = async_oper->apply(SymEngine::vec_basic({F, G}));
+        REQUIRE(val_FG.size()==2);
+        REQUIRE(get_max_error(val_FG[0].get(), F_ref)<1.0e-12);
+        REQUIRE(get_max_error(val_FG[1].get(), G_ref)<1.0e-12);
+        auto val_EE_a = async_fun->apply(SymEngine::vec_basic({E, E_a}));
+        REQUIRE(std::abs(val_EE_a[0].get()-E_ref)<1.0e-12);
+        REQUIRE(std::abs(val_EE_a[1].get()-E_a_ref)<1.0e-12);
+    }
+
+    // New traversals do not wait for leaves of earlier ones, which are
+    // released only after all expressions have been traversed
+    for (unsigned int num_threads: {1, 4}) {
+        std::promise<void> gate;
+        auto async_oper = std::make_shared<AsyncDenseOperator>(
+            oper_values, num_threads, gate.get_future().share()
+        );
+        auto async_fun = std::make_shared<AsyncDenseFunction>(async_oper, fun_values);
+        auto val_F = async_oper->apply(F);
+        auto val_E = async_fun->apply(E);
+        auto val_G = async_oper->apply(G);
+        REQUIRE(val_F.wait_for(std::chrono::seconds(0))!=std::future_status::ready);
+        gate.set_value();
+        REQUIRE(get_max_error(val_F.get(), F_ref)<1.0e-12);
+        REQUIRE(get_max_error(val_G.get(), G_ref)<1.0e-12);
+        REQUIRE(std::abs(val_E.get()-E_ref)<1.0e-12);
+    }
+}
+
+TEST_CASE("Test NLevelOperator and NLevelFunction", "[OperatorEvaluator]")
+{
+    const std::size_t dimension = 3;
+    const double energies[] = {0.0, 1.0, 2.5};
+    auto a = make_perturbation(std::string("a"), SymEngine::real_double(0.3));
+    auto b = make_perturbation(std::string("b"), SymEngine::real_double(-0.7));
+    auto H0 = make_1el_operator(std::string("H0"));
+    auto Va = make_1el_operator(
+        std::string("Va"), PertDependency({std::make_pair(a, 1)})
+    );
+    auto Vb = make_1el_operator(
+        std::string("Vb"), PertDependency({std::make_pair(b, 1)})
+    );
+    auto D = make_1el_density(std::string("D"));
+
+    DenseMatrix val_H0(dimension, dimension);
+    DenseMatrix val_D(dimension, dimension);
+    DenseMatrix omega(dimension, dimension);
+    for (std::size_t i=0; i<dimension; ++i) {
+        val_H0(i, i) = energies[i];
+        for (std::size_t j=0; j<dimension; ++j) omega(i, j) = energies[i]-energies[j];
+    }
+    val_D(0, 0) = 1.0;
+    // Hermitian field operators
+    auto val_Va = make_test_matrix(dimension, 0.6);
+    dense_axpy(1.0, dense_adjoint(make_test_matrix(dimension, 0.6)), val_Va);
+    auto val_Vb = make_test_matrix(dimension, -0.9);
+    dense_axpy(1.0, dense_adjoint(make_test_matrix(dimension, -0.9)), val_Vb);
+
+    auto oper_evaluator = std::make_shared<NLevelOperator>(
+        std::make_pair(H0, val_H0),
+        std::map<SymEngine::RCP<const OneElecOperator>,
+                 DenseMatrix,
+                 SymEngine::RCPBasicKeyLess>({{Va, val_Va}, {Vb, val_Vb}}),
+        std::make_pair(D, val_D),
+        2
+    );
+    REQUIRE(get_max_error(oper_evaluator->apply(D), val_D)<1.0e-15);
+    REQUIRE(get_max_error(oper_evaluator->apply(H0), val_H0)<1.0e-15);
+    REQUIRE(get_max_error(oper_evaluator->apply(Va->diff(a)), val_Va)<1.0e-15);
+
+    auto D_a_ref = make_nlevel_rho(0.3, omega, val_Va, val_D);
+    auto D_b_ref = make_nlevel_rho(-0.7, omega, val_Vb, val_D);
+    // D^{aa} = 2[Va, D^{a}]/(2w_a-W)
+    auto D_aa_ref = make_nlevel_rho(0.6, omega, val_Va, D_a_ref);
+    dense_scal(2.0, D_aa_ref);
+    // D^{ab} = ([Va, D^{b}]+[Vb, D^{a}])/(w_a+w_b-W)
+    auto D_ab_ref = make_nlevel_rho(-0.4, omega, val_Va, D_b_ref);
+    dense_axpy(1.0, make_nlevel_rho(-0.4, omega, val_Vb, D_a_ref), D_ab_ref);
+    auto D_ab = D->diff(a)->diff(b);
+    REQUIRE(get_max_error(oper_evaluator->apply(D_ab), D_ab_ref)<1.0e-12);
+    // Lower order derivatives are cached
+    REQUIRE(oper_evaluator->get_rho_derivatives().size()==4);
+    REQUIRE(get_max_error(oper_evaluator->apply(D->diff(a)), D_a_ref)<1.0e-12);
+    REQUIRE(get_max_error(oper_evaluator->apply(D->diff(b)), D_b_ref)<1.0e-12);
+    REQUIRE(get_max_error(oper_evaluator->apply(D->diff(a)->diff(a)), D_aa_ref)<1.0e-12);
+    REQUIRE(oper_evaluator->get_rho_derivatives().size()==5);
+
+    auto fun_evaluator = std::make_shared<NLevelFunction>(
+        std::make_pair(H0, val_H0),
+        std::map<SymEngine::RCP<const OneElecOperator>,
+                 DenseMatrix,
+                 SymEngine::RCPBasicKeyLess>({{Va, val_Va}, {Vb, val_Vb}}),
+        std::make_pair(D, val_D)
+    );
+    // <<Va; Vb>> = tr(Va D^{b})
+    auto E = SymEngine::trace(SymEngine::matrix_mul({Va, D}));
+    auto E_b = differentiate(E, PertTuple({b}));
+    REQUIRE(std::abs(fun_evaluator->apply(E_b)-dense_trace_product(val_Va, D_b_ref))<1.0e-12);
+
+    // Unperturbed Hamiltonian should be diagonal
+    auto invalid_H0 = val_H0;
+    invalid_H0(0, 1) = 0.1;
+    REQUIRE_THROWS(NLevelOperator(
+        std::make_pair(H0, invalid_H0),
+        std::map<SymEngine::RCP<const OneElecOperator>,
+                 DenseMatrix,
+                 SymEngine::RCPBasicKeyLess>({{Va, val_Va}}),
+        std::make_pair(D, val_D)
+    ));
+
+    // Frequency scan of D^{ab} and <<Va; Va, Vb>>
+    NLevelFrequencyScan scanner(*oper_evaluator);
+    const std::vector<std::complex<double>> freq_a = {0.3, 0.45, std::complex<double>(0.8, 0.01)};
+    const std::vector<std::complex<double>> freq_b = {-0.7, 0.1, 1.2};
+    scanner.scan(SymEngine::vec_basic({a, b}), {freq_a, freq_b});
+    REQUIRE(scanner.get_num_points()==3);
+    auto responses = scanner.get_response(val_Va);
+    for (std::size_t p=0; p<scanner.get_num_points(); ++p) {
+        auto D_a_p = make_nlevel_rho(freq_a[p], omega, val_Va, val_D);
+        auto D_b_p = make_nlevel_rho(freq_b[p], omega, val_Vb, val_D);
+        auto D_ab_p = make_nlevel_rho(freq_a[p]+freq_b[p], omega, val_Va, D_b_p);
+        dense_axpy(1.0, make_nlevel_rho(freq_a[p]+freq_b[p], omega, val_Vb, D_a_p), D_ab_p);
+        REQUIRE(get_max_error(scanner.get_rho_derivative(p), D_ab_p)<1.0e-12);
+        REQUIRE(std::abs(responses[p]-dense_trace_product(val_Va, D_ab_p))<1.0e-12);
+    }
+    REQUIRE(get_max_error(scanner.get_rho_derivative(0), D_ab_ref)<1.0e-12);
+    REQUIRE_THROWS(scanner.get_rho_derivative(3));
+
+    // Bound frequencies replace those of perturbations, and cached density
+    // matrix derivatives are dropped when binding
+    FrequencyBinding binding;
+    binding.bind(a, SymEngine::real_double(0.45));
+    oper_evaluator->set_frequency_binding(binding);
+    REQUIRE(oper_evaluator->get_rho_derivatives().size()==1);
+    auto D_a_bound = make_nlevel_rho(0.45, omega, val_Va, val_D);
+    auto D_ab_bound = make_nlevel_rho(-0.25, omega, val_Va, D_b_ref);
+    dense_axpy(1.0, make_nlevel_rho(-0.25, omega, val_Vb, D_a_bound), D_ab_bound);
+    REQUIRE(get_max_error(oper_evaluator->apply(D_ab), D_ab_bound)<1.0e-12);
+    REQUIRE(get_max_error(oper_evaluator->apply(D->diff(a)), D_a_bound)<1.0e-12);
+    REQUIRE(get_max_error(oper_evaluator->apply(D->diff(b)), D_b_ref)<1.0e-12);
+    oper_evaluator->set_frequency_binding(FrequencyBinding());
+    REQUIRE(get_max_error(oper_evaluator->apply(D_ab), D_ab_ref)<1.0e-12);
+
+    // Diagonal elements of D^{ab} are resonant at a grid point with
+    // w_a+w_b = 0, and are determined as by NLevelOperator
+    scanner.scan(SymEngine::vec_basic({a, b}), {{0.5, 0.3}, {-0.5, -0.7}});
+    binding.bind(a, SymEngine::real_double(0.5));
+    binding.bind(b, SymEngine::real_double(-0.5));
+    oper_evaluator->set_frequency_binding(binding);
+    REQUIRE(get_max_error(scanner.get_rho_derivative(0), oper_evaluator->apply(D_ab))<1.0e-12);
+    REQUIRE(get_max_error(scanner.get_rho_derivative(1), D_ab_ref)<1.0e-12);
+    oper_evaluator->set_frequency_binding(FrequencyBinding());
+    // Resonance at the transition frequency W_10 can't be determined
+    REQUIRE_THROWS_AS(
+        scanner.scan(SymEngine::vec_basic({a}), {{0.3, 1.0}}), SymEngine::SymEngineException
+    );
+}
+
+TEST_CASE("Test NLevelOperator against TwoLevelOperator", "[OperatorEvaluator]")
+{
+    auto a = make_perturbation(std::string("a"), SymEngine::real_double(0.3));
+    auto b = make_perturbation(std::string("b"), SymEngine::real_double(-0.7));
+    auto c = make_perturbation(std::string("c"), SymEngine::real_double(0.55));
+    auto H0 = make_1el_operator(std::string("H0"));
+    auto Va = make_1el_operator(
+        std::string("Va"), PertDependency({std::make_pair(a, 1)})
+    );
+    auto Vb = make_1el_operator(
+        std::string("Vb"), PertDependency({std::make_pair(b, 1)})
+    );
+    auto Vc = make_1el_operator(
+        std::string("Vc"), PertDependency({std::make_pair(c, 1)})
+    );
+    auto D = make_1el_density(std::string("D"));
+
+    DenseMatrix val_H0(2, 2);
+    val_H0(1, 1) = 1.2;
+    DenseMatrix val_D(2, 2);
+    val_D(0, 0) = 1.0;
+    // Field operators of TwoLevelOperator should commute, and their elements
+    // are exact binary fractions so that commutators vanish exactly
+    DenseMatrix val_Va(2, 2, std::vector<std::complex<double>>({
+        0.5, std::complex<double>(0.25, -0.5), std::complex<double>(0.25, 0.5), -0.25
+    }));
+    auto val_Vb = make_identity_matrix(2);
+    dense_scal(0.25, val_Vb);
+    dense_axpy(0.5, val_Va, val_Vb);
+    auto val_Vc = make_identity_matrix(2);
+    dense_scal(0.5, val_Vc);
+    dense_axpy(-0.25, val_Va, val_Vc);
+
+    NLevelOperator nlevel_evaluator(
+        std::make_pair(H0, val_H0),
+        std::map<SymEngine::RCP<const OneElecOperator>,
+                 DenseMatrix,
+                 SymEngine::RCPBasicKeyLess>({{Va, val_Va}, {Vb, val_Vb}, {Vc, val_Vc}}),
+        std::make_pair(D, val_D)
+    );
+    TwoLevelOperator two_level_evaluator(
+        std::make_pair(H0, make_symengine_matrix(val_H0)),
+        std::map<SymEngine::RCP<const OneElecOperator>,
+                 SymEngine::RCP<const SymEngine::MatrixExpr>,
+                 SymEngine::RCPBasicKeyLess>({
+            {Va, make_symengine_matrix(val_Va)},
+            {Vb, make_symengine_matrix(val_Vb)},
+            {Vc, make_symengine_matrix(val_Vc)}
+        }),
+        std::make_pair(make_1el_operator(std::string("rho0")), make_symengine_matrix(val_D))
+    );
+    // Frequency sums of all multisets up to the second order differ from the
+    // transition frequencies 0 and +/-1.2
+    for (const auto& x: SymEngine::vec_basic({
+        D->diff(a), D->diff(b), D->diff(a)->diff(a), D->diff(a)->diff(b), D->diff(b)->diff(c)
+    }))
+        REQUIRE(get_max_error(
+            nlevel_evaluator.apply(x), make_dense_matrix(two_level_evaluator.apply(x))
+        )<1.0e-12);
+
+    // Diagonal elements of D^{aa} are resonant for a static field and are
+    // determined by the idempotency, compared with finite differences of
+    // the ground state density matrix of H0+F*Va
+    FrequencyBinding binding;
+    binding.bind(a, SymEngine::real_double(0.0));
+    nlevel_evaluator.set_frequency_binding(binding);
+    const double strength = 1.0e-3;
+    auto H_plus = val_H0;
+    dense_axpy(strength, val_Va, H_plus);
+    auto H_minus = val_H0;
+    dense_axpy(-strength, val_Va, H_minus);
+    auto D_plus = make_two_level_ground_state(H_plus);
+    auto D_minus = make_two_level_ground_state(H_minus);
+    auto D_a_static = D_plus;
+    dense_axpy(-1.0, D_minus, D_a_static);
+    dense_scal(0.5/strength, D_a_static);
+    auto D_aa_static = D_plus;
+    dense_axpy(1.0, D_minus, D_aa_static);
+    dense_axpy(-2.0, make_two_level_ground_state(val_H0), D_aa_static);
+    dense_scal(1.0/(strength*strength), D_aa_static);
+    REQUIRE(get_max_error(make_two_level_ground_state(val_H0), val_D)<1.0e-15);
+    REQUIRE(get_max_error(nlevel_evaluator.apply(D->diff(a)), D_a_static)<1.0e-5);
+    REQUIRE(get_max_error(nlevel_evaluator.apply(D->diff(a)->diff(a)), D_aa_static)<1.0e-5);
+
+    // Resonance at a transition frequency can't be determined
+    binding.bind(a, SymEngine::real_double(1.2));
+    nlevel_evaluator.set_frequency_binding(binding);
+    REQUIRE_THROWS_AS(nlevel_evaluator.apply(D->diff(a)), SymEngine::SymEngineException);
+}
+
+TEST_CASE("Test LdaXcGridDriver", "[LdaXcGridDriver]")
+{
+    auto D = make_1el_density(std::string("D"));
+    auto a = make_perturbation(std::string("a"));
+    auto b = make_perturbation(std::string("b"));
+    auto weight = make_nonel_function(std::string("weight"));
+    auto Omega = make_1el_operator(
+        std::string("Omega"),
+        PertDependency({std::make_pair(a, 99), std::make_pair(b, 99)})
+    );
+    auto rho = [](const std::size_t orderState, const std::size_t orderOmega, const std::size_t p)
+    {
+        return ModelLdaXcGridDriver::get_model_density(orderState, orderOmega, p);
+    };
+
+    // E^{ab} = w*exc^{(1)}*rho^{ab} + w*exc^{(2)}*rho^{a}*rho^{b}
+    auto Exc = make_xc_energy(std::string("Exc"), D, Omega, weight);
+    auto Exc_ab = SymEngine::rcp_dynamic_cast<const ExchCorrEnergy>(
+        Exc->diff(a)->diff(b)
+    );
+    auto energy_plan = XcGridPlan(Exc_ab->get_energy_map());
+    double E_ab_ref = 0.0;
+    for (std::size_t p=0; p<12; ++p) {
+        auto rho_a = rho(0, 1, p)+rho(1, 0, p);
+        auto rho_ab = rho(0, 2, p)+2.0*rho(1, 1, p)+rho(2, 0, p);
+        E_ab_ref += ModelLdaXcGridDriver::get_model_weight(p)
+            *(2.0*rho(0, 0, p)*rho_ab+3.0*rho(0, 0, p)*rho_a*rho_a);
+    }
+    auto serial_driver = ModelLdaXcGridDriver(1);
+    auto parallel_driver = ModelLdaXcGridDriver(4);
+    auto E_ab = serial_driver.eval_energy(energy_plan);
+    REQUIRE(std::abs(E_ab-E_ab_ref)<1.0e-12);
+    // Deterministic reduction over batches
+    REQUIRE(parallel_driver.eval_energy(energy_plan) == E_ab);
+
+    // Vxc^{a} = w*exc^{(2)}*rho^{a}*Omega + w*exc^{(1)}*Omega^{a}
+    auto Vxc = make_xc_potential(std::string("Vxc"), D, Omega, weight);
+    auto Vxc_a = SymEngine::rcp_dynamic_cast<const ExchCorrPotential>(Vxc->diff(a));
+    auto potential_plan = XcGridPlan(Vxc_a->get_potential_map());
+    DenseMatrix Vxc_a_ref(1, 1);
+    for (std::size_t p=0; p<12; ++p) {
+        auto rho_a = rho(0, 1, p)+rho(1, 0, p);
+        Vxc_a_ref(0, 0) += ModelLdaXcGridDriver::get_model_weight(p)
+            *(3.0*rho(0, 0, p)*rho_a+2.0*rho(0, 0, p)*2.0);
+    }
+    auto val_Vxc_a = serial_driver.eval_potential(potential_plan);
+    REQUIRE(get_max_error(val_Vxc_a, Vxc_a_ref)<1.0e-12);
+    REQUIRE(parallel_driver.eval_potential(potential_plan)(0, 0) == val_Vxc_a(0, 0));
+    REQUIRE_THROWS(serial_driver.eval_potential(energy_plan));
+    REQUIRE_THROWS_AS(serial_driver.eval_energy(potential_plan), SymEngine::SymEngineException);
+
+    // Exceptions of kernels in threads are rethrown on the calling thread
+    IncompleteLdaXcGridDriver incomplete_driver(4);
+    REQUIRE(incomplete_driver.eval_energy(energy_plan) == E_ab);
+    REQUIRE_THROWS_AS(
+        incomplete_driver.eval_potential(potential_plan), SymEngine::NotImplementedError
+    );
+}
+
+TEST_CASE("Test Profiler", "[Profiler]")
+{
+    auto& profiler = Profiler::instance();
+    profiler.reset();
+    auto start = Profiler::Clock::now();
+    auto end = start+std::chrono::milliseconds(2);
+    // Events are not kept by default
+    profiler.add_call("OperatorEvaluator::eval_1el_operator", start, end);
+    REQUIRE(profiler.get_num_events()==0);
+
+    profiler.set_trace(true, 3);
+    profiler.add_call("OperatorEvaluator::eval_1el_operator", start, end);
+    profiler.add_call("user \"region\" in C:\\path", start, end);
+    profiler.add_call("OperatorEvaluator::eval_1el_operator", start, end);
+    profiler.add_call("OperatorEvaluator::eval_1el_operator", start, end);
+    profiler.add_flops("OperatorEvaluator::eval_1el_operator", 1.0e6);
+    REQUIRE(profiler.get_num_events()==3);
+    REQUIRE(profiler.get_num_dropped_events()==1);
+
+    // Records aggregate all calls, including those of dropped events
+    auto records = profiler.get_records();
+    REQUIRE(records.size()==2);
+    auto& record = records.at("OperatorEvaluator::eval_1el_operator");
+    REQUIRE(record.num_calls==4);
+    REQUIRE(std::abs(record.wall_time-0.008)<1.0e-9);
+    REQUIRE(record.flops==1.0e6);
+    REQUIRE(records.at("user \"region\" in C:\\path").num_calls==1);
+    REQUIRE(profiler.get_summary().find("OperatorEvaluator::eval_1el_operator")!=std::string::npos);
+
+    std::string filename("test_profiler_trace.json");
+    profiler.write_chrome_trace(filename);
+    std::ifstream file(filename);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    file.close();
+    std::remove(filename.c_str());
+    auto trace = buffer.str();
+    REQUIRE(trace.find("{\"traceEvents\":[")==0);
+    REQUIRE(trace.find("\"name\":\"user \\\"region\\\" in C:\\\\path\"")!=std::string::npos);
+    REQUIRE(trace.find("\"name\":\"OperatorEvaluator::eval_1el_operator\"")!=std::string::npos);
+    REQUIRE(trace.find("\"droppedEvents\":1")!=std::string::npos);
+
+    profiler.set_trace(false);
+    profiler.reset();
+    REQUIRE(profiler.get_records().empty());
+    REQUIRE(profiler.get_num_dropped_events()==0);
+}
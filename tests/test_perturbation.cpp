@@ -2,6 +2,8 @@
 
 #include <iostream>
 
+#include <algorithm>
+#include <complex>
 #include <cstddef>
 #include <set>
 #include <string>
@@ -17,6 +19,7 @@
 #include <symengine/rational.h>
 #include <symengine/real_double.h>
 #include <symengine/complex.h>
+#include <symengine/eval_double.h>
 #include <symengine/symbol.h>
 #include <symengine/symengine_rcp.h>
 
@@ -68,6 +71,15 @@ TEST_CASE("Test Perturbation, make_perturbation() and PertDependency", "[Perturb
     REQUIRE(SymEngine::eq(*freq, *real_freq));
     freq = el3->get_frequency();
     REQUIRE(SymEngine::eq(*freq, *cmplx_freq));
+    REQUIRE(el0->get_frequency_value() == std::complex<double>(0.0, 0.0));
+    REQUIRE(el2->get_frequency_value() == std::complex<double>(0.5, 0.0));
+    REQUIRE(std::abs(el3->get_frequency_value()-std::complex<double>(1.0/3.0, 1.0/3.0)) < 1e-15);
+    REQUIRE(std::abs(
+        get_frequency_sum_value(SymEngine::multiset_basic({el1, el2, el3}))
+        - SymEngine::eval_complex_double(
+              *get_frequency_sum(SymEngine::multiset_basic({el1, el2, el3}))
+          )
+    ) < 1e-15);
 
     REQUIRE(el0->get_components() == std::set<std::size_t>({}));
     REQUIRE(el4->get_components() == components);
@@ -269,4 +281,197 @@ TEST_CASE("Test PertPermutation", "[PertPermutation]")
         REQUIRE(SymEngine::unified_eq(derivatives, *iter_ref));
         ++iter_ref;
     } while (remaining);
+
+    // Ranking and unranking, which follow the sequences generated above
+    pert_permutation = PertPermutation(order, SymEngine::set_basic({a, b, c}));
+    REQUIRE(pert_permutation.get_num_pert_tuples() == 10);
+    REQUIRE(pert_permutation.get_num_derivatives() == 60);
+    auto sequential = PertPermutation(order, SymEngine::set_basic({a, b, c}));
+    std::size_t index = 0;
+    do {
+        auto pert_tuple = sequential.get_pert_tuple(remaining);
+        REQUIRE(SymEngine::unified_eq(pert_permutation.unrank_pert_tuple(index), pert_tuple));
+        REQUIRE(pert_permutation.rank_pert_tuple(pert_tuple) == index);
+        ++index;
+    } while (remaining);
+    REQUIRE(index == pert_permutation.get_num_pert_tuples());
+    REQUIRE(pert_permutation.rank_pert_tuple(SymEngine::vec_basic({c, a, b})) == 4);
+    sequential = PertPermutation(order, SymEngine::set_basic({a, b, c}));
+    index = 0;
+    do {
+        auto derivatives = sequential.get_derivatives(remaining);
+        REQUIRE(SymEngine::unified_eq(pert_permutation.unrank_derivatives(index), derivatives));
+        ++index;
+    } while (remaining);
+    REQUIRE(index == pert_permutation.get_num_derivatives());
+    for (std::size_t i=0; i<pert_permutation.get_factorial(order); ++i)
+        REQUIRE(pert_permutation.rank_positions(pert_permutation.unrank_positions(i)) == i);
+    // {a, c, b} from the tuple abc
+    REQUIRE(pert_permutation.rank_derivatives(
+        SymEngine::vec_basic({a, b, c}), std::vector<unsigned int>({0, 2, 1})
+    ) == 25);
+    // Workers taking slices of derivatives
+    std::vector<SymEngine::vec_basic> slices;
+    for (std::size_t first=0; first<60; first+=7)
+        pert_permutation.for_each_derivatives(
+            first,
+            std::min<std::size_t>(first+7, 60),
+            [&](const std::size_t idx, const SymEngine::vec_basic& derivatives) {
+                REQUIRE(idx == slices.size());
+                slices.push_back(derivatives);
+            }
+        );
+    REQUIRE(slices.size() == 60);
+    for (std::size_t i=0; i<slices.size(); ++i)
+        REQUIRE(SymEngine::unified_eq(slices[i], pert_permutation.unrank_derivatives(i)));
+    REQUIRE_THROWS_AS(pert_permutation.unrank_derivatives(60), SymEngine::SymEngineException&);
+    REQUIRE_THROWS_AS(
+        pert_permutation.rank_pert_tuple(SymEngine::vec_basic({a, a})),
+        SymEngine::SymEngineException&
+    );
+
+    // Distinct multisets of derivatives, in the order of perturbation tuples
+    auto multisets = pert_permutation.get_derivative_multisets();
+    REQUIRE(multisets.size() == pert_permutation.get_num_pert_tuples());
+    std::size_t num_derivatives = 0;
+    for (std::size_t i=0; i<multisets.size(); ++i) {
+        auto pert_tuple = pert_permutation.unrank_pert_tuple(i);
+        REQUIRE(SymEngine::unified_eq(
+            multisets[i].first,
+            SymEngine::multiset_basic(pert_tuple.begin(), pert_tuple.end())
+        ));
+        num_derivatives += multisets[i].second;
+    }
+    // 3^3 distinct permuting derivatives
+    REQUIRE(num_derivatives == 27);
+    REQUIRE(multisets[0].second == 1);  // aaa
+    REQUIRE(multisets[1].second == 3);  // aab
+    REQUIRE(multisets[4].second == 6);  // abc
+    REQUIRE(PertPermutation::get_multiplicity(std::vector<unsigned int>({2, 2, 1})) == 30);
+    // Bounded by dependencies, `c` is not a dependency
+    auto bounded = pert_permutation.get_derivative_multisets(
+        PertDependency({std::make_pair(a, 2), std::make_pair(b, 1)})
+    );
+    REQUIRE(bounded.size() == 1);
+    REQUIRE(SymEngine::unified_eq(bounded[0].first, SymEngine::multiset_basic({a, a, b})));
+    REQUIRE(bounded[0].second == 3);
+    bounded = pert_permutation.get_derivative_multisets(
+        PertDependency({std::make_pair(a, 3), std::make_pair(b, 3), std::make_pair(c, 3)})
+    );
+    REQUIRE(bounded.size() == multisets.size());
+    REQUIRE(pert_permutation.get_derivative_multisets(
+        PertDependency({std::make_pair(a, 1), std::make_pair(b, 1)})
+    ).empty());
+}
+
+TEST_CASE("Test ComponentLayout", "[ComponentLayout]")
+{
+    auto el = make_perturbation(std::string("EL"), SymEngine::zero, std::set<std::size_t>({0, 1, 2}));
+    auto geo = make_perturbation(std::string("GEO"), SymEngine::zero, std::set<std::size_t>({0, 1, 2, 3}));
+    auto a = make_perturbation(std::string("a"));
+
+    // First hyperpolarizability, 10 distinct components out of 27
+    auto layout = ComponentLayout(SymEngine::multiset_basic({el, el, el}));
+    REQUIRE(layout.size() == 10);
+    REQUIRE(layout.get_orders() == std::vector<unsigned int>({3}));
+    REQUIRE(layout.get_components(0) == std::vector<std::size_t>({0, 0, 0}));
+    REQUIRE(layout.get_components(1) == std::vector<std::size_t>({0, 0, 1}));
+    REQUIRE(layout.get_components(9) == std::vector<std::size_t>({2, 2, 2}));
+    for (std::size_t i=0; i<layout.size(); ++i)
+        REQUIRE(layout.get_index(layout.get_components(i)) == i);
+    REQUIRE(layout.get_index(std::vector<std::size_t>({2, 0, 1}))
+        == layout.get_index(std::vector<std::size_t>({0, 1, 2})));
+
+    // Mixed perturbations, the last one runs fastest
+    layout = ComponentLayout(SymEngine::multiset_basic({el, geo, geo, a}));
+    REQUIRE(layout.get_perturbations().size() == 3);
+    REQUIRE(layout.size() == 3*10);
+    std::size_t idx_el = 0;
+    std::size_t idx_geo = 0;
+    for (std::size_t i=0; i<layout.get_perturbations().size(); ++i) {
+        if (SymEngine::eq(*layout.get_perturbations()[i], *el)) idx_el = i;
+        if (SymEngine::eq(*layout.get_perturbations()[i], *geo)) idx_geo = i;
+    }
+    REQUIRE(layout.get_orders()[idx_el] == 1);
+    REQUIRE(layout.get_orders()[idx_geo] == 2);
+    for (std::size_t i=0; i<layout.size(); ++i) {
+        auto components = layout.get_components(i);
+        REQUIRE(components.size() == 4);
+        REQUIRE(layout.get_index(components) == i);
+    }
+    REQUIRE_THROWS_AS(layout.get_components(30), SymEngine::SymEngineException&);
+    REQUIRE_THROWS_AS(
+        layout.get_index(std::vector<std::size_t>({0, 0})), SymEngine::SymEngineException&
+    );
+
+    // Unperturbed quantities have a single component
+    layout = ComponentLayout(SymEngine::multiset_basic({}));
+    REQUIRE(layout.size() == 1);
+    REQUIRE(layout.get_components(0).empty());
+}
+
+TEST_CASE("Test ResponseSymmetry", "[ResponseSymmetry]")
+{
+    auto xyz = std::set<std::size_t>({0, 1, 2});
+    auto el = make_perturbation(std::string("EL"), SymEngine::zero, xyz);
+
+    // Static second hyperpolarizability, 15 unique components out of 81
+    auto gamma = ResponseSymmetry(
+        std::vector<SymEngine::RCP<const Perturbation>>({el, el, el, el})
+    );
+    REQUIRE(gamma.size() == 81);
+    REQUIRE(gamma.get_num_unique() == 15);
+    REQUIRE(gamma.get_layout().size() == 15);
+    REQUIRE(SymEngine::unified_eq(
+        gamma.get_derivatives(), SymEngine::multiset_basic({el, el, el, el})
+    ));
+    // xxyz, xyxz and zyxx are equivalent
+    auto idx_xxyz = gamma.get_index(std::vector<std::size_t>({0, 0, 1, 2}));
+    REQUIRE(gamma.get_unique_index(idx_xxyz)
+        == gamma.get_unique_index(gamma.get_index(std::vector<std::size_t>({0, 1, 0, 2}))));
+    REQUIRE(gamma.get_unique_index(idx_xxyz)
+        == gamma.get_unique_index(gamma.get_index(std::vector<std::size_t>({2, 1, 0, 0}))));
+    REQUIRE(gamma.get_multiplicity(gamma.get_unique_index(idx_xxyz)) == 12);
+    std::size_t num_components = 0;
+    for (std::size_t i=0; i<gamma.get_num_unique(); ++i) {
+        num_components += gamma.get_multiplicity(i);
+        REQUIRE(gamma.get_unique_index(gamma.get_representative(i)) == i);
+    }
+    REQUIRE(num_components == 81);
+    for (std::size_t i=0; i<gamma.size(); ++i)
+        REQUIRE(gamma.get_index(gamma.get_components(i)) == i);
+
+    // Second harmonic generation, only the two perturbations of the same
+    // frequency are equivalent
+    auto w = SymEngine::real_double(0.1);
+    auto el_w = make_perturbation(std::string("EL"), w, xyz);
+    auto el_2w = make_perturbation(std::string("EL"), SymEngine::mulnum(SymEngine::integer(-2), w), xyz);
+    auto beta = ResponseSymmetry(
+        std::vector<SymEngine::RCP<const Perturbation>>({el_2w, el_w, el_w})
+    );
+    REQUIRE(beta.size() == 27);
+    REQUIRE(beta.get_num_unique() == 18);
+    // Values of unique components, which depend only on the sorted
+    // components of equivalent perturbations
+    std::vector<std::size_t> unique_values(beta.get_num_unique());
+    for (std::size_t i=0; i<beta.get_num_unique(); ++i) {
+        auto components = beta.get_components(beta.get_representative(i));
+        unique_values[i] = 100*components[0]
+            + 10*std::min(components[1], components[2])
+            + std::max(components[1], components[2]);
+    }
+    auto values = beta.scatter(unique_values);
+    REQUIRE(values.size() == 27);
+    for (std::size_t i=0; i<values.size(); ++i) {
+        auto components = beta.get_components(i);
+        REQUIRE(values[i] == 100*components[0]
+            + 10*std::min(components[1], components[2])
+            + std::max(components[1], components[2]));
+    }
+    REQUIRE_THROWS_AS(
+        beta.scatter(std::vector<std::size_t>(27, 0)), SymEngine::SymEngineException&
+    );
+    REQUIRE_THROWS_AS(
+        beta.get_index(std::vector<std::size_t>({0, 3, 0})), SymEngine::SymEngineException&
+    );
 }
@@ -1,3 +1,4 @@
+#include <complex>
 #include <cstddef>
 #include <map>
 #include <string>
@@ -8,6 +9,7 @@
 #include <symengine/basic.h>
 #include <symengine/dict.h>
 #include <symengine/constants.h>
+#include <symengine/eval_double.h>
 #include <symengine/real_double.h>
 #include <symengine/symengine_rcp.h>
 
@@ -43,6 +45,7 @@ TEST_CASE("Test TemporumOperator and make_dt_operator()", "[TemporumOperator]")
         *Dp->get_frequency(),
         *SymEngine::subnum(SymEngine::real_double(0), sum_freq)
     ));
+    REQUIRE(Dp->get_frequency_value() == std::complex<double>(-2.0, 0.0));
     REQUIRE(SymEngine::unified_eq(
         Dp->get_derivatives(), SymEngine::multiset_basic({el, geo, mag})
     ));
@@ -50,6 +53,7 @@ TEST_CASE("Test TemporumOperator and make_dt_operator()", "[TemporumOperator]")
         ((Dket->diff(el))->diff(geo))->diff(mag)
     );
     REQUIRE(SymEngine::eq(*Dp->get_frequency(), *sum_freq));
+    REQUIRE(Dp->get_frequency_value() == std::complex<double>(2.0, 0.0));
     REQUIRE(SymEngine::unified_eq(
         Dp->get_derivatives(), SymEngine::multiset_basic({el, geo, mag})
     ));
@@ -97,6 +101,11 @@ TEST_CASE("Test TemporumOverlap and make_t_matrix()", "[TemporumOverlap]")
         {std::string("0|gg"), false}
     });
     REQUIRE(Tgg->size() == 3);
+    for (std::size_t i = 0; i < Tgg->size(); ++i)
+        REQUIRE(std::abs(
+            Tgg->get_frequency_value(i)
+            - SymEngine::eval_complex_double(*Tgg->get_frequency(i))
+        ) < 1e-15);
     for (std::size_t i = 0; i < Tgg->size(); ++i) {
         derivatives = Tgg->get_derivatives(i);
         if (
@@ -1,11 +1,14 @@
 #define CATCH_CONFIG_MAIN
 
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <catch2/catch.hpp>
 
 #include <symengine/dict.h>
 #include <symengine/constants.h>
+#include <symengine/real_double.h>
 #include <symengine/add.h>
 #include <symengine/mul.h>
 #include <symengine/matrices/matrix_add.h>
@@ -14,6 +17,7 @@
 #include <symengine/symengine_rcp.h>
 
 #include "Tinned.hpp"
+#include "Tinned/EvaluationPlanner.hpp"
 
 using namespace Tinned;
 
@@ -800,6 +804,254 @@ TEST_CASE("Test FindAllVisitor and find_all()", "[FindAllVisitor]")
     ));
 }
 
+TEST_CASE("Test EvaluationPlanner and get_peak_live_operators()", "[EvaluationPlanner]")
+{
+    auto D = make_1el_density(std::string("D"));
+    auto h = make_1el_operator(std::string("h"));
+    auto S = make_1el_operator(std::string("S"));
+
+    REQUIRE(get_peak_live_operators(h)==1);
+    REQUIRE(get_peak_live_operators(SymEngine::matrix_add({h, S}))==2);
+    // The product, its two operands
+    REQUIRE(get_peak_live_operators(SymEngine::matrix_mul({h, D}))==3);
+    REQUIRE(get_peak_live_operators(SymEngine::matrix_mul({h, D, S}))==3);
+
+    // The product should be evaluated first, otherwise the partial sum `h`
+    // is alive during the multiplication
+    auto hDS = SymEngine::matrix_mul({h, D, S});
+    auto F = SymEngine::matrix_add({h, hDS});
+    EvaluationPlanner planner;
+    REQUIRE(planner.apply(F)==3);
+    auto plan = planner.get_plan();
+    REQUIRE(plan.size()==1);
+    REQUIRE(SymEngine::eq(*F->get_args()[plan.begin()->second], *hDS));
+    // A product added to a partial sum needs at least four operators if not
+    // fused
+    auto F2 = SymEngine::matrix_add({F, SymEngine::matrix_mul({S, D, h})});
+    REQUIRE(get_peak_live_operators(F2)==4);
+    REQUIRE(get_peak_live_operators(F2, true)==4);
+    auto F3 = SymEngine::matrix_add({hDS, SymEngine::matrix_mul({S, D})});
+    REQUIRE(get_peak_live_operators(F3)==4);
+    REQUIRE(get_peak_live_operators(F3, true)==3);
+}
+
+TEST_CASE("Test differentiate() with elimination", "[EliminationVisitor]")
+{
+    auto a = make_perturbation(std::string("a"));
+    auto b = make_perturbation(std::string("b"));
+    auto c = make_perturbation(std::string("c"));
+    auto dependencies = PertDependency({
+        std::make_pair(a, 99), std::make_pair(b, 99), std::make_pair(c, 99)
+    });
+    auto D = make_1el_density(std::string("D"));
+    auto h = make_1el_operator(std::string("h"), dependencies);
+    auto V = make_1el_operator(std::string("V"), dependencies);
+    auto S = make_1el_operator(std::string("S"), dependencies);
+    auto G = make_2el_operator(std::string("G"), D, dependencies);
+    auto weight = make_nonel_function(std::string("weight"));
+    auto Omega = make_1el_operator(std::string("Omega"), dependencies);
+    auto Exc = make_xc_energy(std::string("Exc"), D, Omega, weight);
+    auto hnuc = make_nonel_function(std::string("hnuc"), dependencies);
+    auto E = make_ks_energy(h, V, G, D, Exc, hnuc);
+    auto F = SymEngine::matrix_add({h, G, V});
+    auto Y = make_tdscf_equation(F, D, S);
+
+    // Derivatives of D with order greater than the floor of half length of
+    // perturbations are eliminated
+    auto perturbations = PertTuple({a, b, c});
+    auto rules = std::vector<EliminationRule>({std::make_pair(D, 2)});
+    REQUIRE(SymEngine::eq(
+        *differentiate(E, perturbations, rules),
+        *eliminate(differentiate(E, perturbations), D, perturbations, 2)
+    ));
+    REQUIRE(SymEngine::eq(
+        *differentiate(Y, SymEngine::vec_basic({a, b, c}), rules),
+        *eliminate(differentiate(Y, SymEngine::vec_basic({a, b, c})), D, perturbations, 2)
+    ));
+    // Without rules, the same as `differentiate()`
+    REQUIRE(SymEngine::eq(
+        *differentiate(E, perturbations, std::vector<EliminationRule>()),
+        *differentiate(E, perturbations)
+    ));
+    // Expressions that are eliminated completely
+    REQUIRE(SymEngine::eq(
+        *differentiate(
+            D,
+            SymEngine::multiset_basic({a}),
+            std::vector<EliminationRule>({std::make_pair(D, 1)})
+        ),
+        *make_zero_operator()
+    ));
+    REQUIRE(SymEngine::eq(
+        *differentiate(
+            SymEngine::trace(SymEngine::matrix_mul({D, D})),
+            SymEngine::multiset_basic({a, b}),
+            std::vector<EliminationRule>({std::make_pair(D, 1)})
+        ),
+        *SymEngine::zero
+    ));
+}
+
+TEST_CASE("Test ResponseSchedule", "[ResponseSchedule]")
+{
+    auto a = make_perturbation(std::string("a"), SymEngine::real_double(0.1));
+    auto b = make_perturbation(std::string("b"), SymEngine::real_double(0.2));
+    auto dependencies = PertDependency({std::make_pair(a, 99), std::make_pair(b, 99)});
+    auto D = make_1el_density(std::string("D"));
+    auto lambda = make_perturbed_parameter(std::string("lambda"));
+    auto h = make_1el_operator(std::string("h"), dependencies);
+    auto S = make_1el_operator(std::string("S"), dependencies);
+    auto D_ab = make_1el_density(std::string("D"), SymEngine::multiset_basic({a, b}));
+    auto lambda_b = make_perturbed_parameter(std::string("lambda"), SymEngine::multiset_basic({b}));
+    auto E = SymEngine::add(
+        SymEngine::trace(SymEngine::matrix_mul({h, D_ab})),
+        SymEngine::trace(SymEngine::matrix_mul({S, lambda_b}))
+    );
+
+    // D^{a}, D^{b}, lambda^{b} and D^{ab}
+    auto schedule = ResponseSchedule(E, SymEngine::vec_basic({D, lambda}));
+    REQUIRE(schedule.size() == 4);
+    const auto& solves = schedule.get_solves();
+    auto find_solve = [&](const std::size_t idxParameter, const SymEngine::multiset_basic& derivatives)
+    {
+        for (std::size_t i=0; i<solves.size(); ++i)
+            if (solves[i].idx_parameter==idxParameter &&
+                SymEngine::unified_eq(solves[i].derivatives, derivatives)) return i;
+        return solves.size();
+    };
+    auto idx_a = find_solve(0, SymEngine::multiset_basic({a}));
+    auto idx_b = find_solve(0, SymEngine::multiset_basic({b}));
+    auto idx_ab = find_solve(0, SymEngine::multiset_basic({a, b}));
+    auto idx_lambda_b = find_solve(1, SymEngine::multiset_basic({b}));
+    REQUIRE(idx_a < 2);
+    REQUIRE(idx_b < 2);
+    REQUIRE(idx_lambda_b == 2);
+    REQUIRE(idx_ab == 3);
+    REQUIRE(SymEngine::eq(*solves[idx_ab].parameter, *D_ab));
+    REQUIRE(SymEngine::eq(*solves[idx_lambda_b].parameter, *lambda_b));
+    REQUIRE(SymEngine::eq(
+        *solves[idx_ab].frequency,
+        *SymEngine::addnum(a->get_frequency(), b->get_frequency())
+    ));
+    REQUIRE(solves[idx_a].prerequisites.empty());
+    REQUIRE(solves[idx_a].level == 0);
+    REQUIRE(solves[idx_lambda_b].prerequisites == std::vector<std::size_t>({idx_b}));
+    REQUIRE(solves[idx_lambda_b].level == 1);
+    REQUIRE(solves[idx_ab].prerequisites.size() == 2);
+    REQUIRE(solves[idx_ab].level == 1);
+    // Prerequisites are scheduled before
+    for (std::size_t i=0; i<solves.size(); ++i)
+        for (const auto& j: solves[i].prerequisites) REQUIRE(j < i);
+    REQUIRE(schedule.get_frequency_groups().size() == 4);
+
+    // Static perturbations, solves of the same level are batched
+    auto a0 = make_perturbation(std::string("a"));
+    auto b0 = make_perturbation(std::string("b"));
+    auto E0 = SymEngine::add(
+        SymEngine::trace(SymEngine::matrix_mul({
+            h, make_1el_density(std::string("D"), SymEngine::multiset_basic({a0, b0}))
+        })),
+        SymEngine::trace(SymEngine::matrix_mul({
+            S, make_perturbed_parameter(std::string("lambda"), SymEngine::multiset_basic({b0}))
+        }))
+    );
+    schedule = ResponseSchedule(E0, SymEngine::vec_basic({D, lambda}));
+    REQUIRE(schedule.size() == 4);
+    auto groups = schedule.get_frequency_groups();
+    REQUIRE(groups.size() == 2);
+    REQUIRE(groups[0].size() == 2);
+    REQUIRE(groups[1].size() == 2);
+    for (const auto& i: groups[0]) REQUIRE(schedule.get_solves()[i].level == 0);
+
+    REQUIRE_THROWS_AS(
+        ResponseSchedule(E, SymEngine::vec_basic({D_ab})), SymEngine::SymEngineException&
+    );
+}
+
+TEST_CASE("Test ManifestVisitor and make_manifest()", "[ManifestVisitor]")
+{
+    auto a = make_perturbation(std::string("a"));
+    auto b = make_perturbation(std::string("b"));
+    auto dependencies = PertDependency({std::make_pair(a, 99), std::make_pair(b, 99)});
+    auto D = make_1el_density(std::string("D"));
+    auto h = make_1el_operator(std::string("h"), dependencies);
+    auto V = make_1el_operator(std::string("V"), dependencies);
+    auto G = make_2el_operator(std::string("G"), D, dependencies);
+    auto weight = make_nonel_function(std::string("weight"));
+    auto Omega = make_1el_operator(std::string("Omega"), dependencies);
+    auto Exc = make_xc_energy(std::string("Exc"), D, Omega, weight);
+    auto hnuc = make_nonel_function(std::string("hnuc"), dependencies);
+    auto E = make_ks_energy(h, V, G, D, Exc, hnuc);
+
+    const auto key_h = std::make_pair(LeafKind::OneElecOperator, std::string("h"));
+    const auto key_G = std::make_pair(LeafKind::TwoElecOperator, std::string("G"));
+    const auto key_hnuc = std::make_pair(LeafKind::NonElecFunction, std::string("hnuc"));
+    auto manifest = make_manifest(E);
+    REQUIRE(manifest.size() == 5);
+    REQUIRE(manifest.at(key_h).at(0).size() == 1);
+    REQUIRE(SymEngine::eq(*manifest.at(key_h).at(0)[0].leaf, *h));
+    REQUIRE(manifest.at(key_h).at(0)[0].count == 1);
+    REQUIRE(manifest.at(key_G).at(0).size() == 1);
+    REQUIRE(manifest.at(key_hnuc).at(0).size() == 1);
+    REQUIRE(manifest.at(std::make_pair(LeafKind::ExchCorrEnergy, std::string("Exc"))).at(0).size() == 1);
+    // Density matrices are not leaves
+    for (const auto& leaves: manifest) REQUIRE(leaves.first.second != std::string("D"));
+
+    // First order derivatives, the two-electron operator is differentiated
+    // on itself, or contracted with the perturbed density matrix
+    auto E_a = differentiate(E, SymEngine::multiset_basic({a}));
+    manifest = make_manifest(E_a);
+    REQUIRE(manifest.at(key_h).at(0).size() == 1);
+    REQUIRE(manifest.at(key_h).at(1).size() == 1);
+    REQUIRE(SymEngine::eq(*manifest.at(key_h).at(1)[0].leaf, *h->diff(a)));
+    std::size_t num_fock = 0;
+    for (const auto& leaves: manifest.at(key_G)) num_fock += leaves.second.size();
+    REQUIRE(num_fock == 2);
+    REQUIRE(manifest.at(key_G).at(1).size() >= 1);
+    REQUIRE(manifest.at(key_hnuc).at(1).size() == 1);
+    REQUIRE(manifest.at(key_hnuc).find(0) == manifest.at(key_hnuc).end());
+
+    // Occurrences of a same leaf are counted
+    auto S = make_1el_operator(std::string("S"), dependencies);
+    auto S_a = SymEngine::rcp_dynamic_cast<const SymEngine::MatrixExpr>(S->diff(a));
+    manifest = make_manifest(SymEngine::add(
+        SymEngine::trace(SymEngine::matrix_mul({S_a, D, S})),
+        SymEngine::trace(SymEngine::matrix_mul({S, D, S_a, D}))
+    ));
+    const auto key_S = std::make_pair(LeafKind::OneElecOperator, std::string("S"));
+    REQUIRE(manifest.size() == 1);
+    REQUIRE(manifest.at(key_S).at(0)[0].count == 2);
+    REQUIRE(manifest.at(key_S).at(1)[0].count == 2);
+    REQUIRE(SymEngine::eq(*manifest.at(key_S).at(1)[0].leaf, *S_a));
+
+    // Leaves of different kinds sharing a name are not mixed, like an XC
+    // energy and an XC potential of a same functional, or a one-electron
+    // operator named as the T matrix
+    auto Exc_gga = make_xc_energy(std::string("GGA"), D, Omega, weight);
+    auto Vxc_gga = make_xc_potential(std::string("GGA"), D, Omega, weight);
+    auto T = make_t_matrix(dependencies);
+    auto T_oper = make_1el_operator(T->get_name(), dependencies);
+    manifest = make_manifest(SymEngine::add(
+        Exc_gga,
+        SymEngine::trace(SymEngine::matrix_add({
+            SymEngine::matrix_mul({Vxc_gga, D}),
+            SymEngine::matrix_mul({T, D}),
+            SymEngine::matrix_mul({T_oper, D})
+        }))
+    ));
+    REQUIRE(manifest.size() == 4);
+    auto& leaves_Exc = manifest.at(std::make_pair(LeafKind::ExchCorrEnergy, std::string("GGA")));
+    REQUIRE(leaves_Exc.at(0).size() == 1);
+    REQUIRE(SymEngine::eq(*leaves_Exc.at(0)[0].leaf, *Exc_gga));
+    auto& leaves_Vxc = manifest.at(std::make_pair(LeafKind::ExchCorrPotential, std::string("GGA")));
+    REQUIRE(leaves_Vxc.at(0).size() == 1);
+    REQUIRE(SymEngine::eq(*leaves_Vxc.at(0)[0].leaf, *Vxc_gga));
+    auto& leaves_T = manifest.at(std::make_pair(LeafKind::TemporumOverlap, T->get_name()));
+    REQUIRE(SymEngine::eq(*leaves_T.at(0)[0].leaf, *T));
+    auto& leaves_T_oper = manifest.at(std::make_pair(LeafKind::OneElecOperator, T->get_name()));
+    REQUIRE(SymEngine::eq(*leaves_T_oper.at(0)[0].leaf, *T_oper));
+}
+
 //TEST_CASE("Test StringifyVisitor and stringify()", "[StringifyVisitor]")
 //{
 //}
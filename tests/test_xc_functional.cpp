@@ -11,6 +11,9 @@
 #include <symengine/real_double.h>
 #include <symengine/add.h>
 #include <symengine/mul.h>
+#include <symengine/matrices/matrix_mul.h>
+#include <symengine/matrices/trace.h>
+#include <symengine/symengine_config.h>
 #include <symengine/symengine_rcp.h>
 
 #include "Tinned.hpp"
@@ -1327,3 +1330,199 @@ TEST_CASE("Test ExchCorrPotential and make_xc_potential()", "[ExchCorrPotential]
     // Last example is when the generalized overlap distributions do not depend
     // on all perturbations
 }
+
+TEST_CASE("Test XcGridPlan", "[XcGridPlan]")
+{
+    auto D = make_1el_density(std::string("D"));
+    auto a = make_perturbation(std::string("a"));
+    auto b = make_perturbation(std::string("b"));
+    auto weight = make_nonel_function(std::string("weight"));
+    auto Omega = make_1el_operator(
+        std::string("Omega"),
+        PertDependency({std::make_pair(a, 99), std::make_pair(b, 99)})
+    );
+    auto D_a = SymEngine::rcp_dynamic_cast<const ElectronicState>(D->diff(a));
+    auto D_b = SymEngine::rcp_dynamic_cast<const ElectronicState>(D->diff(b));
+    auto D_ab = SymEngine::rcp_dynamic_cast<const ElectronicState>(D_a->diff(b));
+    auto Omega_a = SymEngine::rcp_dynamic_cast<const OneElecOperator>(Omega->diff(a));
+
+    // Second order XC energy derivative w*exc^{(1)}*rho_ab+w*exc^{(2)}*rho_a*rho_b
+    auto Exc = make_xc_energy(std::string("Exc"), D, Omega, weight);
+    auto Exc_ab = SymEngine::rcp_dynamic_cast<const ExchCorrEnergy>(
+        Exc->diff(a)->diff(b)
+    );
+    auto plan = XcGridPlan(Exc_ab->get_energy_map());
+    REQUIRE(plan.get_states().size() == 4);
+    REQUIRE(plan.get_overlap_distributions().size() == 4);
+    // tr(Omega*D), four generalized density vectors of rho_ab, and two of
+    // each rho_a and rho_b
+    REQUIRE(plan.get_density_vectors().size() == 9);
+    REQUIRE(plan.get_weights().size() == 1);
+    REQUIRE(SymEngine::eq(*plan.get_weights()[0], *weight));
+    REQUIRE(plan.get_exc_orders() == std::set<unsigned int>({1, 2}));
+    REQUIRE(plan.get_recipes().size() == 2);
+    for (const auto& recipe: plan.get_recipes()) {
+        REQUIRE(recipe.idx_weight == 0);
+        REQUIRE(recipe.idx_overlap == XcGridPlan::npos);
+        REQUIRE(SymEngine::eq(
+            *plan.get_density_vector(recipe.idx_exc_density),
+            *make_density_vector(D, Omega)
+        ));
+        REQUIRE(recipe.products.size() == 4);
+        for (const auto& product: recipe.products) {
+            REQUIRE(SymEngine::eq(*product.coef, *SymEngine::one));
+            REQUIRE(product.factors.size() == recipe.exc_order);
+            for (const auto& factor: product.factors) {
+                REQUIRE(factor.index < plan.get_density_vectors().size());
+                REQUIRE(factor.exponent == 1);
+            }
+        }
+    }
+
+    // First order XC potential derivative w*exc^{(2)}*rho_a*Omega+w*exc^{(1)}*Omega_a
+    auto Vxc = make_xc_potential(std::string("Vxc"), D, Omega, weight);
+    auto Vxc_a = SymEngine::rcp_dynamic_cast<const ExchCorrPotential>(Vxc->diff(a));
+    plan = XcGridPlan(Vxc_a->get_potential_map());
+    REQUIRE(plan.get_states().size() == 2);
+    REQUIRE(plan.get_overlap_distributions().size() == 2);
+    REQUIRE(plan.get_density_vectors().size() == 3);
+    REQUIRE(plan.get_exc_orders() == std::set<unsigned int>({1, 2}));
+    REQUIRE(plan.get_recipes().size() == 2);
+    for (const auto& recipe: plan.get_recipes()) {
+        auto Omega_recipe = plan.get_overlap_distributions()[recipe.idx_overlap];
+        if (recipe.exc_order == 1) {
+            REQUIRE(SymEngine::eq(*Omega_recipe, *Omega_a));
+            REQUIRE(recipe.products.empty());
+        }
+        else {
+            REQUIRE(SymEngine::eq(*Omega_recipe, *Omega));
+            REQUIRE(recipe.products.size() == 2);
+        }
+    }
+
+    // Invalid generalized density vectors
+    auto Omega_D = SymEngine::trace(SymEngine::matrix_mul({D, Omega}));
+    REQUIRE_THROWS_AS(
+        XcGridPlan(ExcContractionMap({
+            {weight, ExcDensityContractionMap({{make_exc_density(D, Omega, 1), Omega_D}})}
+        })),
+        SymEngine::SymEngineException&
+    );
+}
+
+TEST_CASE("Test DensityVectorTable", "[DensityVectorTable]")
+{
+    auto D = make_1el_density(std::string("D"));
+    auto a = make_perturbation(std::string("a"));
+    auto b = make_perturbation(std::string("b"));
+    auto weight = make_nonel_function(std::string("weight"));
+    auto Omega = make_1el_operator(
+        std::string("Omega"),
+        PertDependency({std::make_pair(a, 99), std::make_pair(b, 99)})
+    );
+    auto D_a = SymEngine::rcp_dynamic_cast<const ElectronicState>(D->diff(a));
+    auto Omega_a = SymEngine::rcp_dynamic_cast<const OneElecOperator>(Omega->diff(a));
+
+    auto table = DensityVectorTable();
+    auto rho_a = make_density_vector(D_a, Omega);
+    auto rho_a_prime = make_density_vector(D, Omega_a);
+    auto idx_rho_a = table.add_density_vector(rho_a);
+    REQUIRE(table.add_density_vector(rho_a) == idx_rho_a);
+    REQUIRE(SymEngine::eq(*table.get_density_vector(idx_rho_a), *rho_a));
+    auto products = table.add_density_products(SymEngine::add(
+        SymEngine::mul(SymEngine::integer(2), SymEngine::pow(rho_a, SymEngine::integer(2))),
+        rho_a_prime
+    ));
+    REQUIRE(table.size() == 2);
+    REQUIRE(products.size() == 2);
+    for (const auto& product: products) {
+        REQUIRE(product.factors.size() == 1);
+        if (product.factors[0].index == idx_rho_a) {
+            REQUIRE(SymEngine::eq(*product.coef, *SymEngine::integer(2)));
+            REQUIRE(product.factors[0].exponent == 2);
+        }
+        else {
+            REQUIRE(SymEngine::eq(*product.coef, *SymEngine::one));
+            REQUIRE(product.factors[0].exponent == 1);
+        }
+    }
+    REQUIRE(table.add_density_products(SymEngine::RCP<const SymEngine::Basic>()).empty());
+
+    // Generalized density vectors shared by XC energy and potential maps
+    auto Exc = make_xc_energy(std::string("Exc"), D, Omega, weight);
+    auto Exc_ab = SymEngine::rcp_dynamic_cast<const ExchCorrEnergy>(
+        Exc->diff(a)->diff(b)
+    );
+    auto Vxc = make_xc_potential(std::string("Vxc"), D, Omega, weight);
+    auto Vxc_a = SymEngine::rcp_dynamic_cast<const ExchCorrPotential>(Vxc->diff(a));
+    table.add_energy_map(Exc_ab->get_energy_map());
+    REQUIRE(table.size() == 9);
+    REQUIRE(SymEngine::eq(*table.get_density_vector(idx_rho_a), *rho_a));
+    table.add_potential_map(Vxc_a->get_potential_map());
+    REQUIRE(table.size() == 9);
+    auto plan = XcGridPlan(Vxc_a->get_potential_map(), table);
+    REQUIRE(plan.get_density_vectors() == table.get_density_vectors());
+    for (const auto& recipe: plan.get_recipes())
+        for (const auto& product: recipe.products)
+            for (const auto& factor: product.factors)
+                REQUIRE((factor.index == idx_rho_a ||
+                         factor.index == table.add_density_vector(rho_a_prime)));
+}
+
+TEST_CASE("Test parallel extraction of ExcContractionMap", "[ExchCorrEnergy]")
+{
+    auto D = make_1el_density(std::string("D"));
+    auto a = make_perturbation(std::string("a"));
+    auto b = make_perturbation(std::string("b"));
+    auto c = make_perturbation(std::string("c"));
+    auto dependencies = PertDependency({
+        std::make_pair(a, 99), std::make_pair(b, 99), std::make_pair(c, 99)
+    });
+    auto weight = make_nonel_function(std::string("weight"), dependencies);
+    auto Omega = make_1el_operator(std::string("Omega"), dependencies);
+    auto Exc = make_xc_energy(std::string("Exc"), D, Omega, weight);
+    auto Exc_abc = SymEngine::rcp_dynamic_cast<const ExchCorrEnergy>(
+        Exc->diff(a)->diff(b)->diff(c)
+    );
+    auto energy = Exc_abc->get_energy();
+    // Serial extraction, and extraction by threads without validating each
+    // term. Threads are only used when SymEngine is built thread-safe,
+    // otherwise `extract_energy_map()` runs serially for any `numThreads`
+#if !defined(WITH_SYMENGINE_THREAD_SAFE)
+    WARN("SymEngine is not thread-safe, extract_energy_map() runs serially");
+#endif
+    auto energy_map = extract_energy_map(energy);
+    REQUIRE(eq_energy_map(energy_map, Exc_abc->get_energy_map()));
+    for (unsigned int num_threads: {2, 3, 8}) {
+        auto parallel_map = extract_energy_map(energy, num_threads, false);
+        REQUIRE(eq_energy_map(parallel_map, energy_map));
+        REQUIRE_NOTHROW(validate_energy_map(parallel_map));
+    }
+
+    // Exceptions thrown while extracting terms reach the caller
+    auto invalid_energy = SymEngine::add(
+        energy,
+        SymEngine::mul({
+            weight,
+            make_nonel_function(std::string("weight2"), dependencies),
+            make_exc_density(D, Omega, 1)
+        })
+    );
+    REQUIRE_THROWS_AS(extract_energy_map(invalid_energy), SymEngine::SymEngineException&);
+    for (unsigned int num_threads: {2, 3, 8}) {
+        REQUIRE_THROWS_AS(
+            extract_energy_map(invalid_energy, num_threads, false),
+            SymEngine::SymEngineException&
+        );
+    }
+
+    // Grid weight in generalized density vectors
+    auto invalid_map = ExcContractionMap({
+        {weight, ExcDensityContractionMap({
+            {make_exc_density(D, Omega, 1), SymEngine::mul(
+                make_density_vector(D, Omega), weight
+            )}
+        })}
+    });
+    REQUIRE_THROWS_AS(validate_energy_map(invalid_map), SymEngine::SymEngineException&);
+}